@@ -0,0 +1,129 @@
+#include "benchmark.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+#include <diw/core/json.h>
+#include <diw/core/options.h>
+#include <diw/logging/async_logger.h>
+#include <diw/profiling/latency_tracker.h>
+#include <diw/profiling/profiler.h>
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+benchmark::benchmark(std::string const& topology, std::uint64_t frames, camera_path const& path)
+  : _topology(topology)
+  , _frames(frames)
+  , _path(path)
+  , _presented(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void benchmark::frame_presented(time_point const& present_time)
+{
+  if (_presented == 0) {
+    _first_present = present_time;
+  }
+  _last_present = present_time;
+  ++_presented;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double benchmark::duration_seconds() const
+{
+  return to_milliseconds(_last_present - _first_present) / 1000.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double benchmark::frames_per_second() const
+{
+  // intervals between the presents, the first frame carries the startup
+  double s = duration_seconds();
+  return _presented > 1 && s > 0.0 ? double(_presented - 1) / s : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void benchmark::write_json(std::ostream& os, profiler const& p, latency_tracker const& l) const
+{
+  os << std::fixed << std::setprecision(4);
+
+  os << "{\n  \"topology\": ";
+  write_json_string(os, _topology);
+  os << ",\n  \"frames\": " << _presented
+     << ",\n  \"duration_s\": " << duration_seconds()
+     << ",\n  \"fps\": " << frames_per_second()
+     << ",\n  \"zones\": [";
+
+  bool first = true;
+  for (auto const& z : p.statistics()) {
+    os << (first ? "\n" : ",\n") << "    { \"name\": ";
+    write_json_string(os, z.name);
+    os << ", \"thread\": ";
+    write_json_string(os, z.thread);
+    os << ", \"gpu\": " << (z.gpu ? "true" : "false")
+       << ", \"count\": " << z.count
+       << ", \"mean_ms\": " << z.mean_ms
+       << ", \"p50_ms\": " << z.p50_ms
+       << ", \"p95_ms\": " << z.p95_ms
+       << ", \"p99_ms\": " << z.p99_ms
+       << ", \"max_ms\": " << z.max_ms << " }";
+    first = false;
+  }
+  os << (first ? "" : "\n  ") << "],\n  \"latency\": [";
+
+  first = true;
+  for (auto const& s : l.statistics()) {
+    os << (first ? "\n" : ",\n") << "    { \"path\": ";
+    write_json_string(os, s.path);
+    os << ", \"count\": " << s.count
+       << ", \"mean_ms\": " << s.mean_ms
+       << ", \"p50_ms\": " << s.p50_ms
+       << ", \"p95_ms\": " << s.p95_ms
+       << ", \"p99_ms\": " << s.p99_ms
+       << ", \"max_ms\": " << s.max_ms << " }";
+    first = false;
+  }
+  os << (first ? "" : "\n  ") << "]\n}\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool benchmark::write_json(std::string const& filename, profiler const& p, latency_tracker const& l) const
+{
+  std::ofstream out(filename);
+  if (!out) {
+    return false;
+  }
+  write_json(out, p, l);
+  return bool(out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<benchmark> benchmark_requested(int argc, char** argv, std::string const& topology)
+{
+  std::string frames = option_value(argc, argv, "--benchmark");
+  if (frames.empty()) {
+    return std::unique_ptr<benchmark>();
+  }
+
+  long long n = std::atoll(frames.c_str());
+  if (n <= 0) {
+    return std::unique_ptr<benchmark>();
+  }
+
+  camera_path path;
+  std::string path_file = option_value(argc, argv, "--camera-path");
+  if (!path_file.empty() && !path.load(path_file)) {
+    DIW_LOG(error, "cannot read camera path %s, falling back to the orbit", path_file.c_str());
+  }
+  if (path.empty()) {
+    path = camera_path::orbit();
+  }
+
+  return std::unique_ptr<benchmark>(new benchmark(topology, std::uint64_t(n), path));
+}
+
+} // namespace diw
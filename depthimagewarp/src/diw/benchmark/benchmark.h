@@ -0,0 +1,57 @@
+#ifndef DIW_BENCHMARK_BENCHMARK_H_INCLUDED
+#define DIW_BENCHMARK_BENCHMARK_H_INCLUDED
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include <diw/benchmark/camera_path.h>
+#include <diw/core/clock.h>
+
+namespace diw {
+
+class latency_tracker;
+class profiler;
+
+// one benchmark run of an example topology: a fixed number of presented
+// frames driven by a camera path, summarized as json together with the
+// profiler zones (per thread frame times) and the motion-to-photon latency.
+class benchmark
+{
+public:
+  benchmark(std::string const& topology, std::uint64_t frames, camera_path const& path);
+
+  std::string const&  topology() const { return _topology; }
+  std::uint64_t       frames() const { return _frames; }
+
+  pointer_sample      input(std::uint64_t frame) const { return _path.sample(frame); }
+
+  // called by the presenting thread after every swap
+  void                frame_presented(time_point const& present_time);
+
+  std::uint64_t       presented_frames() const { return _presented; }
+  double              duration_seconds() const;
+  double              frames_per_second() const;
+
+  void                write_json(std::ostream& os, profiler const& p, latency_tracker const& l) const;
+  bool                write_json(std::string const& filename, profiler const& p, latency_tracker const& l) const;
+
+private:
+  std::string         _topology;
+  std::uint64_t       _frames;
+  camera_path         _path;
+
+  std::uint64_t       _presented;
+  time_point          _first_present;
+  time_point          _last_present;
+
+}; // class benchmark
+
+// --benchmark <frames> [--camera-path <file>], null if not benchmarking. the
+// scripted orbit is used without a camera path.
+std::unique_ptr<benchmark> benchmark_requested(int argc, char** argv, std::string const& topology);
+
+} // namespace diw
+
+#endif // DIW_BENCHMARK_BENCHMARK_H_INCLUDED
@@ -0,0 +1,94 @@
+#include "camera_path.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+char const* const path_header = "# diw camera path 1";
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+camera_path::camera_path()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+camera_path camera_path::orbit(std::size_t period, float radius)
+{
+  camera_path p;
+
+  period = period > 0 ? period : 1;
+  for (std::size_t f = 0; f < period; ++f) {
+    float a = 2.0f * 3.14159265f * float(f) / float(period);
+    p.append(pointer_sample(0.5f + radius * std::cos(a), 0.5f + radius * std::sin(a), pointer_sample::left));
+  }
+
+  return p;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool camera_path::load(std::string const& filename)
+{
+  std::ifstream in(filename);
+  if (!in) {
+    return false;
+  }
+
+  std::vector<pointer_sample> samples;
+
+  std::string line;
+  if (!std::getline(in, line) || line != path_header) {
+    return false;
+  }
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream ls(line);
+    pointer_sample s;
+    if (!(ls >> s.x >> s.y >> s.buttons)) {
+      return false;
+    }
+    samples.push_back(s);
+  }
+
+  _samples.swap(samples);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool camera_path::save(std::string const& filename) const
+{
+  std::ofstream out(filename);
+  if (!out) {
+    return false;
+  }
+
+  out << path_header << "\n# x y buttons, one line per frame\n";
+  for (auto const& s : _samples) {
+    out << s.x << " " << s.y << " " << s.buttons << "\n";
+  }
+
+  return bool(out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+pointer_sample camera_path::sample(std::uint64_t frame) const
+{
+  if (_samples.empty()) {
+    return pointer_sample();
+  }
+
+  pointer_sample s = _samples[frame % _samples.size()];
+  if (frame >= _samples.size() && frame % _samples.size() == 0) {
+    s.buttons = 0;
+  }
+  return s;
+}
+
+} // namespace diw
@@ -0,0 +1,67 @@
+#ifndef DIW_BENCHMARK_CAMERA_PATH_H_INCLUDED
+#define DIW_BENCHMARK_CAMERA_PATH_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace diw {
+
+// pointer state of one frame, position relative to the window in [0, 1]
+// with y pointing down like the glfw cursor
+struct pointer_sample
+{
+  enum button_bits {
+    left    = 0x01,
+    middle  = 0x02,
+    right   = 0x04
+  };
+
+  pointer_sample()
+    : x(0.5f)
+    , y(0.5f)
+    , buttons(0)
+  {}
+
+  pointer_sample(float px, float py, unsigned b)
+    : x(px)
+    , y(py)
+    , buttons(b)
+  {}
+
+  float       x;
+  float       y;
+  unsigned    buttons;
+
+}; // struct pointer_sample
+
+// trackball input indexed by frame, either scripted or recorded from an
+// interactive run. paths loop, the buttons are released for the frame the
+// path wraps around so the loop does not jump the camera.
+class camera_path
+{
+public:
+  camera_path();
+
+  // left drag around the window center, one turn per period frames
+  static camera_path  orbit(std::size_t period = 240, float radius = 0.25f);
+
+  bool                load(std::string const& filename);
+  bool                save(std::string const& filename) const;
+
+  void                append(pointer_sample const& s) { _samples.push_back(s); }
+  void                clear() { _samples.clear(); }
+
+  bool                empty() const { return _samples.empty(); }
+  std::size_t         size() const { return _samples.size(); }
+
+  pointer_sample      sample(std::uint64_t frame) const;
+
+private:
+  std::vector<pointer_sample> _samples;
+
+}; // class camera_path
+
+} // namespace diw
+
+#endif // DIW_BENCHMARK_CAMERA_PATH_H_INCLUDED
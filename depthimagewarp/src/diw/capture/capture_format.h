@@ -0,0 +1,77 @@
+#ifndef DIW_CAPTURE_CAPTURE_FORMAT_H_INCLUDED
+#define DIW_CAPTURE_CAPTURE_FORMAT_H_INCLUDED
+
+#include <cstdint>
+
+namespace diw {
+
+// reference frame capture file, little endian, meant to be mapped:
+//
+//   capture_file_header
+//   frame records, each starting on a page boundary:
+//     capture_frame_header, color plane, depth plane (each 16 byte aligned)
+//   capture_index_entry[frame_count] at index_offset
+//
+// planes are bottom-up like reference_frame: RGBA8 color as packed words and
+// window space float depth. a plane is either raw, so it can be used straight
+// from the mapping, or rle32 coded.
+
+std::uint64_t const capture_page_size     = 4096;
+std::uint32_t const capture_version       = 1;
+
+enum capture_encoding
+{
+  capture_encoding_raw    = 0,
+  capture_encoding_rle32  = 1
+
+}; // enum capture_encoding
+
+struct capture_file_header
+{
+  char            magic[8];         // "DIWCAPT\0"
+  std::uint32_t   version;
+  std::uint32_t   header_size;
+  std::uint64_t   frame_count;
+  std::uint64_t   index_offset;     // 0 while the capture is being written
+  std::uint8_t    reserved[32];
+
+}; // struct capture_file_header
+
+struct capture_frame_header
+{
+  std::uint64_t   frame_id;
+  std::int64_t    timestamp_ns;     // diw::clock, only differences are meaningful
+  std::uint64_t   input_sequence;
+  std::int64_t    input_time_ns;
+
+  std::uint32_t   width;
+  std::uint32_t   height;
+  std::uint32_t   color_encoding;
+  std::uint32_t   depth_encoding;
+
+  std::uint64_t   color_offset;     // relative to the frame header
+  std::uint64_t   color_bytes;
+  std::uint64_t   depth_offset;
+  std::uint64_t   depth_bytes;
+
+  float           projection_matrix[16];
+  float           view_matrix[16];
+
+}; // struct capture_frame_header
+
+struct capture_index_entry
+{
+  std::uint64_t   offset;           // of the frame header from the file start
+  std::uint64_t   size;             // of the whole frame record
+
+}; // struct capture_index_entry
+
+static_assert(sizeof(capture_file_header) == 64, "capture_file_header layout changed");
+static_assert(sizeof(capture_frame_header) == 208, "capture_frame_header layout changed");
+static_assert(sizeof(capture_index_entry) == 16, "capture_index_entry layout changed");
+
+char const capture_magic[8] = { 'D', 'I', 'W', 'C', 'A', 'P', 'T', '\0' };
+
+} // namespace diw
+
+#endif // DIW_CAPTURE_CAPTURE_FORMAT_H_INCLUDED
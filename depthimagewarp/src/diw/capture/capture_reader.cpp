@@ -0,0 +1,240 @@
+#include "capture_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <diw/capture/rle32.h>
+
+namespace {
+
+diw::time_point from_ns(std::int64_t ns)
+{
+  return diw::time_point(std::chrono::duration_cast<diw::duration>(std::chrono::nanoseconds(ns)));
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+capture_reader::capture_reader()
+  : _data(nullptr)
+  , _size(0)
+  , _frame_count(0)
+  , _index(nullptr)
+  , _fd(-1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+capture_reader::~capture_reader()
+{
+  close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_reader::open(std::string const& filename)
+{
+  close();
+
+#if !defined(_WIN32)
+  _fd = ::open(filename.c_str(), O_RDONLY);
+  if (_fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(_fd, &st) != 0 || st.st_size < off_t(sizeof(capture_file_header))) {
+    close();
+    return false;
+  }
+
+  void* m = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_SHARED, _fd, 0);
+  if (m == MAP_FAILED) {
+    close();
+    return false;
+  }
+  ::madvise(m, std::size_t(st.st_size), MADV_SEQUENTIAL);
+
+  _data = static_cast<std::uint8_t const*>(m);
+  _size = std::uint64_t(st.st_size);
+#else
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  _buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  if (_buffer.size() < sizeof(capture_file_header)) {
+    close();
+    return false;
+  }
+  _data = _buffer.data();
+  _size = _buffer.size();
+#endif
+
+  if (!validate()) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void capture_reader::close()
+{
+#if !defined(_WIN32)
+  if (_data) {
+    ::munmap(const_cast<std::uint8_t*>(_data), std::size_t(_size));
+  }
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+#endif
+  _fd = -1;
+  _buffer.clear();
+
+  _data        = nullptr;
+  _size        = 0;
+  _frame_count = 0;
+  _index       = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_reader::validate()
+{
+  capture_file_header const* header = reinterpret_cast<capture_file_header const*>(_data);
+
+  if (std::memcmp(header->magic, capture_magic, sizeof(header->magic)) != 0
+    || header->version != capture_version
+    || header->header_size != sizeof(capture_file_header)) {
+    return false;
+  }
+
+  // an unfinished capture has no index
+  if (header->index_offset == 0
+    || header->index_offset > _size
+    || header->frame_count > (_size - header->index_offset) / sizeof(capture_index_entry)) {
+    return false;
+  }
+
+  _frame_count = header->frame_count;
+  _index       = reinterpret_cast<capture_index_entry const*>(_data + header->index_offset);
+
+  for (std::uint64_t i = 0; i < _frame_count; ++i) {
+    capture_index_entry const& e = _index[i];
+    if (e.offset > _size || e.size > _size - e.offset || e.size < sizeof(capture_frame_header)) {
+      return false;
+    }
+
+    capture_frame_header const* f = reinterpret_cast<capture_frame_header const*>(_data + e.offset);
+    if (f->color_offset > e.size || f->color_bytes > e.size - f->color_offset
+      || f->depth_offset > e.size || f->depth_bytes > e.size - f->depth_offset) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint8_t const* capture_reader::record(std::uint64_t i) const
+{
+  return i < _frame_count ? _data + _index[i].offset : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+capture_frame_header const* capture_reader::frame_header(std::uint64_t i) const
+{
+  return reinterpret_cast<capture_frame_header const*>(record(i));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t const* capture_reader::color_data(std::uint64_t i) const
+{
+  capture_frame_header const* f = frame_header(i);
+  if (!f || f->color_encoding != capture_encoding_raw) {
+    return nullptr;
+  }
+  return reinterpret_cast<std::uint32_t const*>(record(i) + f->color_offset);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float const* capture_reader::depth_data(std::uint64_t i) const
+{
+  capture_frame_header const* f = frame_header(i);
+  if (!f || f->depth_encoding != capture_encoding_raw) {
+    return nullptr;
+  }
+  return reinterpret_cast<float const*>(record(i) + f->depth_offset);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void capture_reader::prefetch(std::uint64_t i) const
+{
+#if !defined(_WIN32)
+  if (i >= _frame_count || _fd < 0) {
+    return;
+  }
+
+  // madvise wants a page aligned start, frame records are page aligned
+  ::madvise(const_cast<std::uint8_t*>(record(i)), std::size_t(_index[i].size), MADV_WILLNEED);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_reader::read(std::uint64_t i, reference_frame& frame) const
+{
+  capture_frame_header const* f = frame_header(i);
+  if (!f) {
+    return false;
+  }
+
+  std::uint8_t const* r = record(i);
+  std::size_t const count = std::size_t(f->width) * f->height;
+
+  scm::math::vec2ui size(f->width, f->height);
+  if (frame.size != size) {
+    frame.resize(size);
+  }
+
+  auto load_plane = [&](std::uint32_t encoding, std::uint64_t offset, std::uint64_t bytes, std::uint32_t* dst) {
+    std::uint32_t const* src = reinterpret_cast<std::uint32_t const*>(r + offset);
+    if (encoding == capture_encoding_raw) {
+      if (bytes != std::uint64_t(count) * 4) {
+        return false;
+      }
+      std::copy(src, src + count, dst);
+      return true;
+    }
+    if (encoding == capture_encoding_rle32) {
+      return rle32_decode(src, std::size_t(bytes / 4), dst, count);
+    }
+    return false;
+  };
+
+  if (!load_plane(f->color_encoding, f->color_offset, f->color_bytes, frame.color.data())
+    || !load_plane(f->depth_encoding, f->depth_offset, f->depth_bytes, reinterpret_cast<std::uint32_t*>(frame.depth.data()))) {
+    return false;
+  }
+
+  std::copy(f->projection_matrix, f->projection_matrix + 16, frame.projection_matrix.data_array);
+  std::copy(f->view_matrix, f->view_matrix + 16, frame.view_matrix.data_array);
+
+  frame.frame_id  = f->frame_id;
+  frame.timestamp = from_ns(f->timestamp_ns);
+  frame.input     = input_stamp(f->input_sequence, from_ns(f->input_time_ns));
+
+  return true;
+}
+
+} // namespace diw
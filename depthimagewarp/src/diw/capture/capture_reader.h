@@ -0,0 +1,59 @@
+#ifndef DIW_CAPTURE_CAPTURE_READER_H_INCLUDED
+#define DIW_CAPTURE_CAPTURE_READER_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <diw/capture/capture_format.h>
+#include <diw/core/reference_frame.h>
+
+namespace diw {
+
+// random access to a capture file through a read-only mapping. raw planes
+// are handed out straight from the mapping, coded planes are decoded by
+// read(). without mmap (windows) the file is read into memory once.
+class capture_reader
+{
+public:
+  capture_reader();
+  ~capture_reader();
+
+  capture_reader(capture_reader const&) = delete;
+  capture_reader& operator=(capture_reader const&) = delete;
+
+  bool                  open(std::string const& filename);
+  void                  close();
+  bool                  is_open() const { return _data != nullptr; }
+
+  std::uint64_t         frame_count() const { return _frame_count; }
+
+  capture_frame_header const* frame_header(std::uint64_t i) const;
+
+  // null if the plane is coded
+  std::uint32_t const*  color_data(std::uint64_t i) const;
+  float const*          depth_data(std::uint64_t i) const;
+
+  // hints the kernel to page in frame i ahead of use
+  void                  prefetch(std::uint64_t i) const;
+
+  // decodes or copies frame i into frame, false on corrupt data
+  bool                  read(std::uint64_t i, reference_frame& frame) const;
+
+private:
+  std::uint8_t const*   record(std::uint64_t i) const;
+  bool                  validate();
+
+  std::uint8_t const*               _data;
+  std::uint64_t                     _size;
+  std::uint64_t                     _frame_count;
+  capture_index_entry const*        _index;
+
+  int                               _fd;
+  std::vector<std::uint8_t>         _buffer;     // without mmap
+
+}; // class capture_reader
+
+} // namespace diw
+
+#endif // DIW_CAPTURE_CAPTURE_READER_H_INCLUDED
@@ -0,0 +1,277 @@
+#include "capture_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <diw/capture/rle32.h>
+
+namespace {
+
+std::int64_t to_ns(diw::time_point const& t)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+capture_writer::capture_writer(std::size_t queue_depth)
+  : _queue_depth(std::max<std::size_t>(queue_depth, 1))
+  , _compress(false)
+  , _file(nullptr)
+  , _offset(0)
+  , _failed(false)
+  , _allocated(0)
+  , _closing(false)
+  , _written(0)
+  , _dropped(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+capture_writer::~capture_writer()
+{
+  close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_writer::open(std::string const& filename, bool compress)
+{
+  if (is_open()) {
+    return false;
+  }
+
+  _file = std::fopen(filename.c_str(), "wb");
+  if (!_file) {
+    return false;
+  }
+
+  _compress = compress;
+  _offset   = 0;
+  _failed   = false;
+  _closing  = false;
+  _index.clear();
+  _written  = 0;
+  _dropped  = 0;
+
+  // placeholder until close() knows the index
+  capture_file_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, capture_magic, sizeof(header.magic));
+  header.version     = capture_version;
+  header.header_size = sizeof(capture_file_header);
+
+  if (!write_bytes(&header, sizeof(header))) {
+    std::fclose(_file);
+    _file = nullptr;
+    return false;
+  }
+
+  _io_thread = std::thread(&capture_writer::io_loop, this);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_writer::submit(reference_frame const& frame)
+{
+  if (!is_open() || frame.empty()) {
+    return false;
+  }
+
+  frame_ptr buffer;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_free.empty()) {
+      buffer = std::move(_free.back());
+      _free.pop_back();
+    }
+    else if (_allocated < _queue_depth) {
+      buffer.reset(new reference_frame());
+      ++_allocated;
+    }
+  }
+
+  if (!buffer) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // the copy happens outside the lock, the buffers keep their allocations.
+  // borrowed pixels are copied too, the queue must not hold their lease.
+  *buffer = frame;
+  buffer->detach();
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue.push_back(std::move(buffer));
+  }
+  _queued.notify_one();
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_writer::close()
+{
+  if (!is_open()) {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closing = true;
+  }
+  _queued.notify_one();
+  _io_thread.join();
+
+  // index and the final header
+  bool ok = !_failed && pad_to(16);
+
+  std::uint64_t index_offset = _offset;
+  if (ok && !_index.empty()) {
+    ok = write_bytes(_index.data(), _index.size() * sizeof(capture_index_entry));
+  }
+
+  capture_file_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, capture_magic, sizeof(header.magic));
+  header.version      = capture_version;
+  header.header_size  = sizeof(capture_file_header);
+  header.frame_count  = _index.size();
+  header.index_offset = index_offset;
+
+  ok = ok
+    && std::fseek(_file, 0, SEEK_SET) == 0
+    && std::fwrite(&header, sizeof(header), 1, _file) == 1;
+  ok = std::fclose(_file) == 0 && ok;
+  _file = nullptr;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _queue.clear();
+  _free.clear();
+  _allocated = 0;
+
+  return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void capture_writer::io_loop()
+{
+  for (;;) {
+    frame_ptr frame;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _queued.wait(lock, [this] { return _closing || !_queue.empty(); });
+      if (_queue.empty()) {
+        return;
+      }
+      frame = std::move(_queue.front());
+      _queue.pop_front();
+    }
+
+    // keep draining after an error so submit() does not run dry
+    if (!_failed) {
+      _failed = !write_frame(*frame);
+      if (!_failed) {
+        _written.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free.push_back(std::move(frame));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_writer::write_frame(reference_frame const& frame)
+{
+  if (!pad_to(capture_page_size)) {
+    return false;
+  }
+
+  std::uint64_t const begin = _offset;
+  std::size_t const   count = std::size_t(frame.size.x) * frame.size.y;
+
+  capture_frame_header header;
+  std::memset(&header, 0, sizeof(header));
+  header.frame_id       = frame.frame_id;
+  header.timestamp_ns   = to_ns(frame.timestamp);
+  header.input_sequence = frame.input.sequence;
+  header.input_time_ns  = to_ns(frame.input.time);
+  header.width          = frame.size.x;
+  header.height         = frame.size.y;
+  std::copy(frame.projection_matrix.data_array, frame.projection_matrix.data_array + 16, header.projection_matrix);
+  std::copy(frame.view_matrix.data_array, frame.view_matrix.data_array + 16, header.view_matrix);
+
+  // encode both planes up front, the header needs their sizes
+  std::vector<std::uint32_t> color_encoded;
+  std::vector<std::uint32_t> depth_encoded;
+
+  void const*   color_data = frame.color_data();
+  void const*   depth_data = frame.depth_data();
+  std::uint64_t raw_bytes  = std::uint64_t(count) * 4;
+
+  header.color_bytes = raw_bytes;
+  header.depth_bytes = raw_bytes;
+
+  if (_compress) {
+    // keep a plane raw if coding does not pay off
+    rle32_encode(frame.color_data(), count, color_encoded);
+    if (color_encoded.size() < count) {
+      header.color_encoding = capture_encoding_rle32;
+      header.color_bytes    = std::uint64_t(color_encoded.size()) * 4;
+      color_data            = color_encoded.data();
+    }
+
+    rle32_encode(reinterpret_cast<std::uint32_t const*>(frame.depth_data()), count, depth_encoded);
+    if (depth_encoded.size() < count) {
+      header.depth_encoding = capture_encoding_rle32;
+      header.depth_bytes    = std::uint64_t(depth_encoded.size()) * 4;
+      depth_data            = depth_encoded.data();
+    }
+  }
+
+  std::uint64_t const header_bytes = (sizeof(capture_frame_header) + 15) & ~std::uint64_t(15);
+  header.color_offset = header_bytes;
+  header.depth_offset = (header.color_offset + header.color_bytes + 15) & ~std::uint64_t(15);
+
+  bool ok = write_bytes(&header, sizeof(header))
+         && pad_to(16)
+         && write_bytes(color_data, header.color_bytes)
+         && pad_to(16)
+         && write_bytes(depth_data, header.depth_bytes);
+
+  if (ok) {
+    capture_index_entry e = { begin, _offset - begin };
+    _index.push_back(e);
+  }
+
+  return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_writer::write_bytes(void const* data, std::uint64_t size)
+{
+  if (size == 0) {
+    return true;
+  }
+  if (std::fwrite(data, 1, std::size_t(size), _file) != size) {
+    return false;
+  }
+  _offset += size;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool capture_writer::pad_to(std::uint64_t alignment)
+{
+  static char const zeros[capture_page_size] = {};
+
+  std::uint64_t padding = (alignment - _offset % alignment) % alignment;
+  return write_bytes(zeros, padding);
+}
+
+} // namespace diw
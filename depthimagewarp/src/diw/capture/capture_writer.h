@@ -0,0 +1,75 @@
+#ifndef DIW_CAPTURE_CAPTURE_WRITER_H_INCLUDED
+#define DIW_CAPTURE_CAPTURE_WRITER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <diw/capture/capture_format.h>
+#include <diw/core/reference_frame.h>
+
+namespace diw {
+
+// writes reference frames to a capture file from a background thread. the
+// render thread only copies the frame into a pooled buffer, when all buffers
+// are queued the frame is dropped rather than stalling the caller.
+class capture_writer
+{
+public:
+  explicit capture_writer(std::size_t queue_depth = 8);
+  ~capture_writer();
+
+  capture_writer(capture_writer const&) = delete;
+  capture_writer& operator=(capture_writer const&) = delete;
+
+  bool                open(std::string const& filename, bool compress = false);
+  bool                is_open() const { return _file != nullptr; }
+
+  // false if the frame was dropped
+  bool                submit(reference_frame const& frame);
+
+  // writes everything queued and the frame index, false on any i/o error
+  bool                close();
+
+  std::uint64_t       written_frames() const { return _written.load(std::memory_order_relaxed); }
+  std::uint64_t       dropped_frames() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+  typedef std::unique_ptr<reference_frame> frame_ptr;
+
+  void                io_loop();
+  bool                write_frame(reference_frame const& frame);
+  bool                write_bytes(void const* data, std::uint64_t size);
+  bool                pad_to(std::uint64_t alignment);
+
+  std::size_t                       _queue_depth;
+  bool                              _compress;
+
+  std::FILE*                        _file;
+  std::uint64_t                     _offset;
+  std::vector<capture_index_entry>  _index;
+  bool                              _failed;
+
+  std::mutex                        _mutex;
+  std::condition_variable           _queued;
+  std::deque<frame_ptr>             _queue;
+  std::vector<frame_ptr>            _free;
+  std::size_t                       _allocated;
+  bool                              _closing;
+  std::thread                       _io_thread;
+
+  std::atomic<std::uint64_t>        _written;
+  std::atomic<std::uint64_t>        _dropped;
+
+}; // class capture_writer
+
+} // namespace diw
+
+#endif // DIW_CAPTURE_CAPTURE_WRITER_H_INCLUDED
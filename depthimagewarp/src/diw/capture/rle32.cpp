@@ -0,0 +1,88 @@
+#include "rle32.h"
+
+#include <algorithm>
+
+namespace {
+
+std::uint32_t const run_bit   = 0x80000000u;
+std::size_t const   max_count = 0x7fffffffu;
+
+// shorter runs are cheaper as literals
+std::size_t const   min_run   = 3;
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+void rle32_encode(std::uint32_t const* src, std::size_t count, std::vector<std::uint32_t>& out)
+{
+  out.clear();
+
+  std::size_t i = 0;
+  std::size_t literal_begin = 0;
+
+  auto flush_literals = [&](std::size_t end) {
+    while (literal_begin < end) {
+      std::size_t n = std::min(end - literal_begin, max_count);
+      out.push_back(std::uint32_t(n));
+      out.insert(out.end(), src + literal_begin, src + literal_begin + n);
+      literal_begin += n;
+    }
+  };
+
+  while (i < count) {
+    std::uint32_t v = src[i];
+    std::size_t run = 1;
+    while (i + run < count && src[i + run] == v && run < max_count) {
+      ++run;
+    }
+
+    if (run >= min_run) {
+      flush_literals(i);
+      out.push_back(run_bit | std::uint32_t(run));
+      out.push_back(v);
+      i += run;
+      literal_begin = i;
+    }
+    else {
+      i += run;
+    }
+  }
+  flush_literals(count);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool rle32_decode(std::uint32_t const* src, std::size_t src_words, std::uint32_t* dst, std::size_t count)
+{
+  std::size_t s = 0;
+  std::size_t d = 0;
+
+  while (s < src_words) {
+    std::uint32_t c = src[s++];
+    std::size_t   n = c & ~run_bit;
+
+    if (n > count - d) {
+      return false;
+    }
+
+    if (c & run_bit) {
+      if (s >= src_words) {
+        return false;
+      }
+      std::fill(dst + d, dst + d + n, src[s++]);
+    }
+    else {
+      if (n > src_words - s) {
+        return false;
+      }
+      std::copy(src + s, src + s + n, dst + d);
+      s += n;
+    }
+    d += n;
+  }
+
+  return d == count;
+}
+
+} // namespace diw
@@ -0,0 +1,23 @@
+#ifndef DIW_CAPTURE_RLE32_H_INCLUDED
+#define DIW_CAPTURE_RLE32_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace diw {
+
+// run length coding of 32 bit words, cheap enough for the capture thread and
+// decodes at memory speed. background color and far depth make up most of a
+// frame, anything else is stored as literals. a packet starts with a control
+// word, high bit set: run of (c & 0x7fffffff) copies of the next word,
+// otherwise c literal words follow.
+
+void rle32_encode(std::uint32_t const* src, std::size_t count, std::vector<std::uint32_t>& out);
+
+// false on malformed input or if the result is not exactly count words
+bool rle32_decode(std::uint32_t const* src, std::size_t src_words, std::uint32_t* dst, std::size_t count);
+
+} // namespace diw
+
+#endif // DIW_CAPTURE_RLE32_H_INCLUDED
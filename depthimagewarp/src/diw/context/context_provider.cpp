@@ -0,0 +1,81 @@
+#include "context_provider.h"
+
+#include <diw/core/options.h>
+#include <diw/context/glfw_context_provider.h>
+#if defined(DIW_WITH_EGL)
+#include <diw/context/egl_context_provider.h>
+#endif
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+context_provider::context_provider()
+  : _close_requested(false)
+  , _presented_frames(0)
+  , _last_present(0)
+  , _frame_limit(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+context_provider::~context_provider()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool context_provider::should_close() const
+{
+  return    _close_requested.load(std::memory_order_acquire)
+         || (_frame_limit > 0 && presented_frames() >= _frame_limit)
+         || window_should_close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void context_provider::request_close()
+{
+  _close_requested.store(true, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+time_point context_provider::last_present() const
+{
+  return time_point(duration(_last_present.load(std::memory_order_acquire)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void context_provider::frame_presented()
+{
+  _last_present.store(clock::now().time_since_epoch().count(), std::memory_order_release);
+  _presented_frames.fetch_add(1, std::memory_order_acq_rel);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<context_provider> create_context_provider(bool headless)
+{
+  if (headless) {
+#if defined(DIW_WITH_EGL)
+    return std::make_shared<egl_context_provider>();
+#else
+    return std::shared_ptr<context_provider>();
+#endif
+  }
+  return std::make_shared<glfw_context_provider>();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool headless_requested(int argc, char** argv)
+{
+  return has_option(argc, argv, "--headless") || env_flag("DIW_HEADLESS");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool headless_supported()
+{
+#if defined(DIW_WITH_EGL)
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace diw
@@ -0,0 +1,85 @@
+#ifndef DIW_CONTEXT_CONTEXT_PROVIDER_H_INCLUDED
+#define DIW_CONTEXT_CONTEXT_PROVIDER_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <scm/core/math.h>
+
+#include <diw/core/clock.h>
+
+namespace diw {
+
+typedef unsigned context_id;
+
+const context_id main_context    = 0u;
+const context_id invalid_context = ~0u;
+
+// owns the gl contexts of an application independent of a window system.
+// there is one main context with a presentable surface and any number of
+// contexts sharing its objects. contexts are made current per thread, like
+// glfwMakeContextCurrent.
+class context_provider
+{
+public:
+  context_provider();
+  virtual ~context_provider();
+
+  virtual bool          initialize() = 0;
+  virtual void          terminate() = 0;
+
+  virtual bool          headless() const = 0;
+
+  virtual bool          create_main_context(scm::math::vec2ui const& size, std::string const& title) = 0;
+  // returns invalid_context on failure
+  virtual context_id    create_shared_context(std::string const& title) = 0;
+  virtual bool          has_context(context_id id) const = 0;
+
+  virtual bool          make_current(context_id id) = 0;
+  virtual void          release_current() = 0;
+
+  // window system handle of a context if there is one (GLFWwindow*)
+  virtual void*         native_handle(context_id id) const = 0;
+
+  // presents the main context and counts the frame
+  virtual void          swap_buffers() = 0;
+  // counts a frame drawn straight to the front buffer, nothing to swap
+  void                  front_buffer_presented() { frame_presented(); }
+  virtual void          poll_events() = 0;
+
+  bool                  should_close() const;
+  void                  request_close();
+
+  // close after n presented frames, 0 runs until closed
+  void                  frame_limit(std::uint64_t n) { _frame_limit = n; }
+  std::uint64_t         frame_limit() const { return _frame_limit; }
+
+  std::uint64_t         presented_frames() const { return _presented_frames.load(std::memory_order_acquire); }
+  time_point            last_present() const;
+
+protected:
+  void                  frame_presented();
+  virtual bool          window_should_close() const { return false; }
+
+private:
+  std::atomic<bool>           _close_requested;
+  std::atomic<std::uint64_t>  _presented_frames;
+  std::atomic<std::int64_t>   _last_present;
+  std::uint64_t               _frame_limit;
+
+}; // class context_provider
+
+// glfw windows, or surfaceless egl contexts if headless is set
+std::shared_ptr<context_provider> create_context_provider(bool headless);
+
+// true if --headless is on the command line or DIW_HEADLESS is set
+bool headless_requested(int argc, char** argv);
+
+// true if this build has a headless backend
+bool headless_supported();
+
+} // namespace diw
+
+#endif // DIW_CONTEXT_CONTEXT_PROVIDER_H_INCLUDED
@@ -0,0 +1,307 @@
+#include "egl_context_provider.h"
+
+#if defined(DIW_WITH_EGL)
+
+#include <cstdlib>
+#include <cstring>
+
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace {
+
+bool has_extension(char const* extensions, char const* name)
+{
+  if (!extensions) {
+    return false;
+  }
+
+  std::size_t const len = std::strlen(name);
+  for (char const* p = std::strstr(extensions, name); p; p = std::strstr(p + len, name)) {
+    if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+egl_context_provider::egl_context_provider(int device)
+  : _device(device)
+  , _display(EGL_NO_DISPLAY)
+  , _config(nullptr)
+  , _surfaceless(false)
+  , _gl_finish(nullptr)
+{
+  if (_device < 0) {
+    char const* env = std::getenv("DIW_EGL_DEVICE");
+    _device = env ? std::atoi(env) : 0;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+egl_context_provider::~egl_context_provider()
+{
+  terminate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+EGLDisplay egl_context_provider::open_display() const
+{
+  char const* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+    reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+  if (get_platform_display && has_extension(client_extensions, "EGL_EXT_platform_device")) {
+    PFNEGLQUERYDEVICESEXTPROC query_devices =
+      reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+
+    EGLDeviceEXT devices[16];
+    EGLint       num_devices = 0;
+
+    if (query_devices && query_devices(16, devices, &num_devices) && _device < num_devices) {
+      EGLDisplay dpy = get_platform_display(EGL_PLATFORM_DEVICE_EXT, devices[_device], nullptr);
+      if (dpy != EGL_NO_DISPLAY) {
+        return dpy;
+      }
+    }
+  }
+
+  if (get_platform_display && has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+    EGLDisplay dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (dpy != EGL_NO_DISPLAY) {
+      return dpy;
+    }
+  }
+
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool egl_context_provider::initialize()
+{
+  if (_display != EGL_NO_DISPLAY) {
+    return true;
+  }
+
+  EGLDisplay dpy = open_display();
+  EGLint major = 0;
+  EGLint minor = 0;
+
+  if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+    return false;
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    eglTerminate(dpy);
+    return false;
+  }
+
+  _surfaceless = has_extension(eglQueryString(dpy, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+  EGLint const pbuffer_attribs[] = {
+    EGL_SURFACE_TYPE,     EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE,  EGL_OPENGL_BIT,
+    EGL_RED_SIZE,         8,
+    EGL_GREEN_SIZE,       8,
+    EGL_BLUE_SIZE,        8,
+    EGL_ALPHA_SIZE,       8,
+    EGL_DEPTH_SIZE,       24,
+    EGL_NONE
+  };
+
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(dpy, pbuffer_attribs, &_config, 1, &num_configs) || num_configs < 1) {
+    _config = nullptr;
+  }
+
+  // surfaceless only displays may not offer pbuffer configs at all
+  if (!_config && _surfaceless) {
+    EGLint const attribs[] = {
+      EGL_RENDERABLE_TYPE,  EGL_OPENGL_BIT,
+      EGL_NONE
+    };
+    if (!eglChooseConfig(dpy, attribs, &_config, 1, &num_configs) || num_configs < 1) {
+      _config = nullptr;
+    }
+  }
+
+  if (!_config) {
+    eglTerminate(dpy);
+    return false;
+  }
+
+  _display = dpy;
+  _gl_finish = reinterpret_cast<finish_function>(eglGetProcAddress("glFinish"));
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void egl_context_provider::terminate()
+{
+  if (_display == EGL_NO_DISPLAY) {
+    return;
+  }
+
+  eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto c = _contexts.rbegin(); c != _contexts.rend(); ++c) {
+      if (c->surface != EGL_NO_SURFACE) {
+        eglDestroySurface(_display, c->surface);
+      }
+      eglDestroyContext(_display, c->handle);
+    }
+    _contexts.clear();
+  }
+
+  eglTerminate(_display);
+  _display = EGL_NO_DISPLAY;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+EGLContext egl_context_provider::create_context(EGLContext share) const
+{
+  EGLint const attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION,        4,
+    EGL_CONTEXT_MINOR_VERSION,        4,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK,  EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+
+  return eglCreateContext(_display, _config, share, attribs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+EGLSurface egl_context_provider::create_pbuffer(scm::math::vec2ui const& size) const
+{
+  EGLint const attribs[] = {
+    EGL_WIDTH,  EGLint(size.x),
+    EGL_HEIGHT, EGLint(size.y),
+    EGL_NONE
+  };
+
+  return eglCreatePbufferSurface(_display, _config, attribs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool egl_context_provider::create_main_context(scm::math::vec2ui const& size, std::string const& title)
+{
+  if (_display == EGL_NO_DISPLAY) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (!_contexts.empty()) {
+    return true;
+  }
+
+  context c;
+  c.handle = create_context(EGL_NO_CONTEXT);
+  if (c.handle == EGL_NO_CONTEXT) {
+    return false;
+  }
+
+  // without a pbuffer there is no default framebuffer to present into
+  c.surface = create_pbuffer(size);
+  if (c.surface == EGL_NO_SURFACE && !_surfaceless) {
+    eglDestroyContext(_display, c.handle);
+    return false;
+  }
+
+  _contexts.push_back(c);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+context_id egl_context_provider::create_shared_context(std::string const& title)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (_contexts.empty()) {
+    return invalid_context;
+  }
+
+  context c;
+  c.handle = create_context(_contexts[main_context].handle);
+  if (c.handle == EGL_NO_CONTEXT) {
+    return invalid_context;
+  }
+
+  c.surface = EGL_NO_SURFACE;
+  if (!_surfaceless) {
+    c.surface = create_pbuffer(scm::math::vec2ui(1u, 1u));
+    if (c.surface == EGL_NO_SURFACE) {
+      eglDestroyContext(_display, c.handle);
+      return invalid_context;
+    }
+  }
+
+  _contexts.push_back(c);
+  return context_id(_contexts.size() - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool egl_context_provider::has_context(context_id id) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return id < _contexts.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool egl_context_provider::make_current(context_id id)
+{
+  context c;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (id >= _contexts.size()) {
+      return false;
+    }
+    c = _contexts[id];
+  }
+  return eglMakeCurrent(_display, c.surface, c.surface, c.handle) == EGL_TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void egl_context_provider::release_current()
+{
+  eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void egl_context_provider::swap_buffers()
+{
+  EGLSurface surface = EGL_NO_SURFACE;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_contexts.empty()) {
+      return;
+    }
+    surface = _contexts[main_context].surface;
+  }
+
+  // a pbuffer swap is a no-op, wait for the frame to actually complete
+  if (_gl_finish) {
+    _gl_finish();
+  }
+  if (surface != EGL_NO_SURFACE) {
+    eglSwapBuffers(_display, surface);
+  }
+
+  frame_presented();
+}
+
+} // namespace diw
+
+#endif // DIW_WITH_EGL
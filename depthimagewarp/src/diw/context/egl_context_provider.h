@@ -0,0 +1,73 @@
+#ifndef DIW_CONTEXT_EGL_CONTEXT_PROVIDER_H_INCLUDED
+#define DIW_CONTEXT_EGL_CONTEXT_PROVIDER_H_INCLUDED
+
+#if defined(DIW_WITH_EGL)
+
+#include <mutex>
+#include <vector>
+
+#include <EGL/egl.h>
+
+#include <diw/context/context_provider.h>
+
+namespace diw {
+
+// headless contexts without any window system. the display comes from the
+// egl device platform (render nodes, llvmpipe) or the mesa surfaceless
+// platform, falling back to the default display. the main context renders
+// into a pbuffer of the requested size so the default framebuffer exists,
+// shared contexts are surfaceless where supported and 1x1 pbuffers
+// otherwise. swap_buffers finishes the frame so presents can be timed.
+class egl_context_provider : public context_provider
+{
+public:
+  // device selects the egl device, -1 picks DIW_EGL_DEVICE or the first one
+  explicit egl_context_provider(int device = -1);
+  virtual ~egl_context_provider();
+
+  bool          initialize();
+  void          terminate();
+
+  bool          headless() const { return true; }
+
+  bool          create_main_context(scm::math::vec2ui const& size, std::string const& title);
+  context_id    create_shared_context(std::string const& title);
+  bool          has_context(context_id id) const;
+
+  bool          make_current(context_id id);
+  void          release_current();
+
+  void*         native_handle(context_id id) const { return nullptr; }
+
+  void          swap_buffers();
+  void          poll_events() {}
+
+private:
+  struct context {
+    EGLContext  handle;
+    EGLSurface  surface;
+  };
+
+  EGLDisplay    open_display() const;
+  EGLContext    create_context(EGLContext share) const;
+  EGLSurface    create_pbuffer(scm::math::vec2ui const& size) const;
+
+  int                   _device;
+
+  EGLDisplay            _display;
+  EGLConfig             _config;
+  bool                  _surfaceless;
+
+  mutable std::mutex    _mutex;
+  std::vector<context>  _contexts;
+
+  typedef void (*finish_function)();
+  finish_function       _gl_finish;
+
+}; // class egl_context_provider
+
+} // namespace diw
+
+#endif // DIW_WITH_EGL
+
+#endif // DIW_CONTEXT_EGL_CONTEXT_PROVIDER_H_INCLUDED
@@ -0,0 +1,161 @@
+#include "glfw_context_provider.h"
+
+#include <GLFW/glfw3.h>
+
+namespace {
+
+void context_hints(bool visible)
+{
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, visible);
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+glfw_context_provider::glfw_context_provider()
+  : _size(0u, 0u)
+  , _initialized(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+glfw_context_provider::~glfw_context_provider()
+{
+  terminate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool glfw_context_provider::initialize()
+{
+  if (!_initialized) {
+    _initialized = glfwInit() != 0;
+  }
+  return _initialized;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void glfw_context_provider::terminate()
+{
+  if (!_initialized) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto w = _windows.rbegin(); w != _windows.rend(); ++w) {
+      if (*w) {
+        glfwDestroyWindow(*w);
+      }
+    }
+    _windows.clear();
+  }
+
+  glfwTerminate();
+  _initialized = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool glfw_context_provider::create_main_context(scm::math::vec2ui const& size, std::string const& title)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (!_windows.empty()) {
+    return _windows[main_context] != nullptr;
+  }
+
+  context_hints(true);
+
+  GLFWwindow* win = glfwCreateWindow(int(size.x), int(size.y), title.c_str(), NULL, NULL);
+  if (!win) {
+    return false;
+  }
+
+  _windows.push_back(win);
+  _size = size;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+context_id glfw_context_provider::create_shared_context(std::string const& title)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (_windows.empty()) {
+    return invalid_context;
+  }
+
+  context_hints(false);
+
+  GLFWwindow* win = glfwCreateWindow(int(_size.x), int(_size.y), title.c_str(), NULL, _windows[main_context]);
+  if (!win) {
+    return invalid_context;
+  }
+
+  _windows.push_back(win);
+  return context_id(_windows.size() - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool glfw_context_provider::has_context(context_id id) const
+{
+  return window(id) != nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool glfw_context_provider::make_current(context_id id)
+{
+  GLFWwindow* win = window(id);
+  if (!win) {
+    return false;
+  }
+  glfwMakeContextCurrent(win);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void glfw_context_provider::release_current()
+{
+  glfwMakeContextCurrent(NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void* glfw_context_provider::native_handle(context_id id) const
+{
+  return window(id);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void glfw_context_provider::swap_buffers()
+{
+  if (GLFWwindow* win = window(main_context)) {
+    glfwSwapBuffers(win);
+    frame_presented();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void glfw_context_provider::poll_events()
+{
+  glfwPollEvents();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool glfw_context_provider::window_should_close() const
+{
+  GLFWwindow* win = window(main_context);
+  return win && glfwWindowShouldClose(win);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GLFWwindow* glfw_context_provider::window(context_id id) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return id < _windows.size() ? _windows[id] : nullptr;
+}
+
+} // namespace diw
@@ -0,0 +1,53 @@
+#ifndef DIW_CONTEXT_GLFW_CONTEXT_PROVIDER_H_INCLUDED
+#define DIW_CONTEXT_GLFW_CONTEXT_PROVIDER_H_INCLUDED
+
+#include <mutex>
+#include <vector>
+
+#include <diw/context/context_provider.h>
+
+struct GLFWwindow;
+
+namespace diw {
+
+// every context is a glfw window, shared contexts are hidden windows. needs
+// a display server.
+class glfw_context_provider : public context_provider
+{
+public:
+  glfw_context_provider();
+  virtual ~glfw_context_provider();
+
+  bool          initialize();
+  void          terminate();
+
+  bool          headless() const { return false; }
+
+  bool          create_main_context(scm::math::vec2ui const& size, std::string const& title);
+  context_id    create_shared_context(std::string const& title);
+  bool          has_context(context_id id) const;
+
+  bool          make_current(context_id id);
+  void          release_current();
+
+  void*         native_handle(context_id id) const;
+
+  void          swap_buffers();
+  void          poll_events();
+
+protected:
+  bool          window_should_close() const;
+
+private:
+  GLFWwindow*   window(context_id id) const;
+
+  mutable std::mutex        _mutex;
+  std::vector<GLFWwindow*>  _windows;
+  scm::math::vec2ui         _size;
+  bool                      _initialized;
+
+}; // class glfw_context_provider
+
+} // namespace diw
+
+#endif // DIW_CONTEXT_GLFW_CONTEXT_PROVIDER_H_INCLUDED
@@ -0,0 +1,20 @@
+#ifndef DIW_CORE_CLOCK_H_INCLUDED
+#define DIW_CORE_CLOCK_H_INCLUDED
+
+#include <chrono>
+
+namespace diw {
+
+// monotonic clock every timestamp in the pipeline is taken from
+typedef std::chrono::steady_clock   clock;
+typedef clock::time_point           time_point;
+typedef clock::duration             duration;
+
+inline double to_milliseconds(duration const& d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace diw
+
+#endif // DIW_CORE_CLOCK_H_INCLUDED
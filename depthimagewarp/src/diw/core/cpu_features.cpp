@@ -0,0 +1,102 @@
+#include "cpu_features.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+#if defined(DIW_SIMD_X86)
+
+#if defined(_MSC_VER)
+bool has_avx2()
+{
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7) {
+    return false;
+  }
+
+  // avx needs the os to save the ymm registers
+  __cpuid(regs, 1);
+  bool const osxsave = (regs[2] & (1 << 27)) != 0;
+  bool const avx     = (regs[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 5)) != 0;
+}
+
+bool has_sse4()
+{
+  int regs[4];
+  __cpuid(regs, 1);
+  return (regs[2] & (1 << 19)) != 0;
+}
+#else
+bool has_avx2() { return __builtin_cpu_supports("avx2") != 0; }
+bool has_sse4() { return __builtin_cpu_supports("sse4.1") != 0; }
+#endif
+
+diw::simd_level detect()
+{
+  if (has_avx2()) {
+    return diw::simd_avx2;
+  }
+  if (has_sse4()) {
+    return diw::simd_sse4;
+  }
+  return diw::simd_scalar;
+}
+
+#else
+
+diw::simd_level detect()
+{
+  return diw::simd_scalar;
+}
+
+#endif
+
+diw::simd_level capped(diw::simd_level level)
+{
+  char const* env = std::getenv("DIW_SIMD");
+  if (!env) {
+    return level;
+  }
+
+  for (int l = diw::simd_scalar; l <= diw::simd_avx2; ++l) {
+    if (std::strcmp(env, diw::simd_level_name(diw::simd_level(l))) == 0) {
+      return l < level ? diw::simd_level(l) : level;
+    }
+  }
+  return level;
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+simd_level supported_simd_level()
+{
+  static simd_level const level = capped(detect());
+  return level;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+char const* simd_level_name(simd_level level)
+{
+  switch (level) {
+    case simd_avx2: return "avx2";
+    case simd_sse4: return "sse4";
+    default:        return "scalar";
+  }
+}
+
+} // namespace diw
@@ -0,0 +1,34 @@
+#ifndef DIW_CORE_CPU_FEATURES_H_INCLUDED
+#define DIW_CORE_CPU_FEATURES_H_INCLUDED
+
+namespace diw {
+
+// instruction sets the cpu kernels come in, each level implies the ones
+// below it
+enum simd_level {
+  simd_scalar = 0,
+  simd_sse4,
+  simd_avx2
+};
+
+// best level the running cpu and os support, asked once. DIW_SIMD=scalar,
+// sse4 or avx2 caps it, to compare kernels or to work around a bad one.
+simd_level    supported_simd_level();
+
+char const*   simd_level_name(simd_level level);
+
+} // namespace diw
+
+// kernels for a higher level than the build targets are compiled per
+// function, the dispatch makes sure they only run where supported
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DIW_SIMD_X86 1
+#define DIW_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define DIW_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define DIW_SIMD_X86 1
+#define DIW_TARGET_SSE4
+#define DIW_TARGET_AVX2
+#endif
+
+#endif // DIW_CORE_CPU_FEATURES_H_INCLUDED
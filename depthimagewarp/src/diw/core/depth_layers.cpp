@@ -0,0 +1,47 @@
+#include "depth_layers.h"
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+void depth_layers::pack(std::uint32_t const* const* layer_colors,
+                        float const* const*         layer_depths,
+                        unsigned                    layer_count,
+                        scm::math::vec2ui const&    layer_size)
+{
+  std::size_t const pixels = std::size_t(layer_size.x) * layer_size.y;
+
+  size = layer_size;
+  counts.resize(pixels);
+  row_offsets.resize(layer_size.y + 1);
+  color.clear();
+  depth.clear();
+
+  // counts first, the pixels behind nothing are most of the image and
+  // should cost no more than one compare per layer
+  std::size_t total = 0;
+  for (unsigned y = 0; y < layer_size.y; ++y) {
+    row_offsets[y] = std::uint32_t(total);
+    for (std::size_t i = std::size_t(y) * layer_size.x; i < std::size_t(y + 1) * layer_size.x; ++i) {
+      unsigned n = 0;
+      while (n < layer_count && layer_depths[n][i] < 1.0f) {
+        ++n;
+      }
+      counts[i] = std::uint8_t(n);
+      total += n;
+    }
+  }
+  row_offsets[layer_size.y] = std::uint32_t(total);
+
+  color.resize(total);
+  depth.resize(total);
+
+  std::size_t next = 0;
+  for (std::size_t i = 0; i < pixels; ++i) {
+    for (unsigned l = 0; l < counts[i]; ++l, ++next) {
+      color[next] = layer_colors[l][i];
+      depth[next] = layer_depths[l][i];
+    }
+  }
+}
+
+} // namespace diw
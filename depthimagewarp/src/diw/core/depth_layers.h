@@ -0,0 +1,48 @@
+#ifndef DIW_CORE_DEPTH_LAYERS_H_INCLUDED
+#define DIW_CORE_DEPTH_LAYERS_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include <scm/core/math.h>
+
+namespace diw {
+
+// the surfaces behind the front one of a reference frame, a layered depth
+// image without the front layer. only samples that exist are stored:
+// pixel i has counts[i] of them, nearest first, the samples of row y start
+// at row_offsets[y] and follow the pixels of the row in x order.
+struct depth_layers
+{
+  depth_layers()
+    : size(0u, 0u)
+  {}
+
+  bool empty() const { return depth.empty(); }
+
+  void clear() {
+    size = scm::math::vec2ui(0u, 0u);
+    counts.clear();
+    row_offsets.clear();
+    color.clear();
+    depth.clear();
+  }
+
+  // packs layer_count full layers of size, front to back as depth peeling
+  // produces them. a pixel ends at its first background (depth 1.0) sample.
+  void pack(std::uint32_t const* const* layer_colors,
+            float const* const*         layer_depths,
+            unsigned                    layer_count,
+            scm::math::vec2ui const&    layer_size);
+
+  scm::math::vec2ui           size;
+  std::vector<std::uint8_t>   counts;
+  std::vector<std::uint32_t>  row_offsets;    // size.y + 1 entries
+  std::vector<std::uint32_t>  color;
+  std::vector<float>          depth;
+
+}; // struct depth_layers
+
+} // namespace diw
+
+#endif // DIW_CORE_DEPTH_LAYERS_H_INCLUDED
@@ -0,0 +1,80 @@
+#ifndef DIW_CORE_INPUT_STAMP_H_INCLUDED
+#define DIW_CORE_INPUT_STAMP_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+
+#include <diw/core/clock.h>
+
+namespace diw {
+
+// identifies the newest input event a camera pose reflects. sequence counts
+// input events, 0 means the pose was never touched by input.
+struct input_stamp
+{
+  input_stamp()
+    : sequence(0)
+  {}
+
+  input_stamp(std::uint64_t s, time_point const& t)
+    : sequence(s)
+    , time(t)
+  {}
+
+  std::uint64_t   sequence;
+  time_point      time;
+
+}; // struct input_stamp
+
+// an input_stamp shared between threads. std::atomic<input_stamp> is 16
+// bytes and needs libatomic on gcc, so the halves are stored separately
+// behind a version: one thread stores, any thread loads, and load() retries
+// until both halves came from the same store.
+class atomic_input_stamp
+{
+public:
+  atomic_input_stamp()
+    : _version(0)
+    , _sequence(0)
+    , _time(0)
+  {}
+
+  atomic_input_stamp(atomic_input_stamp const&) = delete;
+  atomic_input_stamp& operator=(atomic_input_stamp const&) = delete;
+
+  void store(input_stamp const& s)
+  {
+    std::uint64_t const v = _version.load(std::memory_order_relaxed);
+    _version.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _sequence.store(s.sequence, std::memory_order_relaxed);
+    _time.store(s.time.time_since_epoch().count(), std::memory_order_relaxed);
+
+    _version.store(v + 2, std::memory_order_release);
+  }
+
+  input_stamp load() const
+  {
+    for (;;) {
+      std::uint64_t const v = _version.load(std::memory_order_acquire);
+      std::uint64_t const s = _sequence.load(std::memory_order_relaxed);
+      duration::rep const t = _time.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if ((v & 1) == 0 && _version.load(std::memory_order_relaxed) == v) {
+        return input_stamp(s, time_point(duration(t)));
+      }
+    }
+  }
+
+private:
+  std::atomic<std::uint64_t>    _version;     // odd while a store is in progress
+  std::atomic<std::uint64_t>    _sequence;
+  std::atomic<duration::rep>    _time;
+
+}; // class atomic_input_stamp
+
+} // namespace diw
+
+#endif // DIW_CORE_INPUT_STAMP_H_INCLUDED
@@ -0,0 +1,27 @@
+#ifndef DIW_CORE_JSON_H_INCLUDED
+#define DIW_CORE_JSON_H_INCLUDED
+
+#include <ostream>
+#include <string>
+
+namespace diw {
+
+// quoted and escaped, enough for names and paths
+inline void write_json_string(std::ostream& os, std::string const& s)
+{
+  os << '"';
+  for (char c : s) {
+    switch (c) {
+    case '"':  os << "\\\""; break;
+    case '\\': os << "\\\\"; break;
+    case '\n': os << "\\n"; break;
+    case '\t': os << "\\t"; break;
+    default:   os << c;
+    }
+  }
+  os << '"';
+}
+
+} // namespace diw
+
+#endif // DIW_CORE_JSON_H_INCLUDED
@@ -0,0 +1,41 @@
+#ifndef DIW_CORE_OPTIONS_H_INCLUDED
+#define DIW_CORE_OPTIONS_H_INCLUDED
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace diw {
+
+// minimal command line lookup for the example switches, --name or --name value
+
+inline bool has_option(int argc, char** argv, char const* name)
+{
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline std::string option_value(int argc, char** argv, char const* name, std::string const& fallback = std::string())
+{
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], name) == 0) {
+      return argv[i + 1];
+    }
+  }
+  return fallback;
+}
+
+// set and not "0"
+inline bool env_flag(char const* name)
+{
+  char const* env = std::getenv(name);
+  return env && *env && std::strcmp(env, "0") != 0;
+}
+
+} // namespace diw
+
+#endif // DIW_CORE_OPTIONS_H_INCLUDED
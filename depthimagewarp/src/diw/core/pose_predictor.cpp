@@ -0,0 +1,467 @@
+#include "pose_predictor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+#include <diw/core/statistics.h>
+
+namespace {
+
+// defaults for a mouse driven trackball
+float const default_position_noise          = 20.0f;
+float const default_orientation_noise       = 50.0f;
+float const default_position_sample_noise   = 1e-6f;
+float const default_orientation_sample_noise = 1e-6f;
+
+// predictions waiting for their actual pose, more means nobody samples
+std::size_t const max_pending = 64;
+
+float seconds(diw::duration const& d)
+{
+  return std::chrono::duration<float>(d).count();
+}
+
+// quaternions as x y z w, rotation matrices column major like scm
+
+void multiply(float const* a, float const* b, float* r)
+{
+  float const x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+  float const y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+  float const z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+  float const w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+  r[0] = x; r[1] = y; r[2] = z; r[3] = w;
+}
+
+void normalize(float* q)
+{
+  float const n = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (int i = 0; i < 4; ++i) {
+    q[i] /= n;
+  }
+}
+
+// rotation from a to b in world space, b * conjugate(a), as a rotation
+// vector. the shorter way round.
+void difference(float const* a, float const* b, float* v)
+{
+  float const ca[4] = { -a[0], -a[1], -a[2], a[3] };
+  float d[4];
+  multiply(b, ca, d);
+  if (d[3] < 0.0f) {
+    for (int i = 0; i < 4; ++i) {
+      d[i] = -d[i];
+    }
+  }
+
+  float const s = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+  float const angle = 2.0f * std::atan2(s, d[3]);
+  float const k = s > 1e-12f ? angle / s : 2.0f;
+  for (int i = 0; i < 3; ++i) {
+    v[i] = d[i] * k;
+  }
+}
+
+// turns q by the rotation vector v in world space
+void rotate(float const* q, float const* v, float* r)
+{
+  float const angle = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  float const k = angle > 1e-12f ? std::sin(0.5f * angle) / angle : 0.5f;
+  float const e[4] = { v[0] * k, v[1] * k, v[2] * k, std::cos(0.5f * angle) };
+  multiply(e, q, r);
+  normalize(r);
+}
+
+void from_matrix(float const* m, float* q)
+{
+  // m(row, col) = m[col * 4 + row]
+  float const trace = m[0] + m[5] + m[10];
+  if (trace > 0.0f) {
+    float const s = 2.0f * std::sqrt(trace + 1.0f);
+    q[3] = 0.25f * s;
+    q[0] = (m[6] - m[9]) / s;
+    q[1] = (m[8] - m[2]) / s;
+    q[2] = (m[1] - m[4]) / s;
+  }
+  else if (m[0] > m[5] && m[0] > m[10]) {
+    float const s = 2.0f * std::sqrt(1.0f + m[0] - m[5] - m[10]);
+    q[3] = (m[6] - m[9]) / s;
+    q[0] = 0.25f * s;
+    q[1] = (m[4] + m[1]) / s;
+    q[2] = (m[8] + m[2]) / s;
+  }
+  else if (m[5] > m[10]) {
+    float const s = 2.0f * std::sqrt(1.0f + m[5] - m[0] - m[10]);
+    q[3] = (m[8] - m[2]) / s;
+    q[0] = (m[4] + m[1]) / s;
+    q[1] = 0.25f * s;
+    q[2] = (m[9] + m[6]) / s;
+  }
+  else {
+    float const s = 2.0f * std::sqrt(1.0f + m[10] - m[0] - m[5]);
+    q[3] = (m[1] - m[4]) / s;
+    q[0] = (m[8] + m[2]) / s;
+    q[1] = (m[9] + m[6]) / s;
+    q[2] = 0.25f * s;
+  }
+  normalize(q);
+}
+
+void to_matrix(float const* q, float* m)
+{
+  float const x = q[0], y = q[1], z = q[2], w = q[3];
+  m[0] = 1.0f - 2.0f * (y * y + z * z);
+  m[1] = 2.0f * (x * y + z * w);
+  m[2] = 2.0f * (x * z - y * w);
+  m[4] = 2.0f * (x * y - z * w);
+  m[5] = 1.0f - 2.0f * (x * x + z * z);
+  m[6] = 2.0f * (y * z + x * w);
+  m[8] = 2.0f * (x * z + y * w);
+  m[9] = 2.0f * (y * z - x * w);
+  m[10] = 1.0f - 2.0f * (x * x + y * y);
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::axis_filter::reset(float x0)
+{
+  x = x0;
+  v = 0.0f;
+  p00 = 0.0f;
+  p01 = 0.0f;
+  p11 = 1.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::axis_filter::predict(float dt, float q)
+{
+  x += v * dt;
+
+  // P = F P F^T + Q with F = [1 dt; 0 1]
+  float const n00 = p00 + dt * (2.0f * p01 + dt * p11) + q * dt * dt * dt / 3.0f;
+  float const n01 = p01 + dt * p11 + q * dt * dt / 2.0f;
+  float const n11 = p11 + q * dt;
+  p00 = n00;
+  p01 = n01;
+  p11 = n11;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::axis_filter::update(float z, float r)
+{
+  float const s  = p00 + r;
+  float const k0 = p00 / s;
+  float const k1 = p01 / s;
+  float const y  = z - x;
+
+  x += k0 * y;
+  v += k1 * y;
+
+  float const n00 = (1.0f - k0) * p00;
+  float const n01 = (1.0f - k0) * p01;
+  float const n11 = p11 - k1 * p01;
+  p00 = n00;
+  p01 = n01;
+  p11 = n11;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+pose_predictor::pose_predictor(prediction_model m, std::size_t history)
+  : _model(m)
+  , _max_horizon(std::chrono::milliseconds(250))
+  , _position_noise(default_position_noise)
+  , _orientation_noise(default_orientation_noise)
+  , _position_sample_noise(default_position_sample_noise)
+  , _orientation_sample_noise(default_orientation_sample_noise)
+  , _samples(0)
+  , _history(std::max<std::size_t>(history, 1))
+  , _next(0)
+  , _count(0)
+  , _max_distance(0.0)
+  , _max_degrees(0.0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::model(prediction_model m)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _model = m;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+pose_predictor::prediction_model pose_predictor::model() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _model;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::max_horizon(duration const& h)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _max_horizon = h;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::process_noise(float position, float orientation)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _position_noise = position;
+  _orientation_noise = orientation;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::sample_noise(float position, float orientation)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _position_sample_noise = position;
+  _orientation_sample_noise = orientation;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool pose_predictor::has_samples() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _samples > 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::sample(time_point const& t, scm::math::mat4f const& view)
+{
+  // view is [R t], the camera sits at -R^T t and turns by R^T
+  float const* m = view.data_array;
+  float camera[16];
+  for (int c = 0; c < 3; ++c) {
+    for (int r = 0; r < 3; ++r) {
+      camera[c * 4 + r] = m[r * 4 + c];
+    }
+  }
+
+  timed_pose s;
+  s.time = t;
+  for (int i = 0; i < 3; ++i) {
+    s.p.eye[i] = -(m[4 * i] * m[12] + m[4 * i + 1] * m[13] + m[4 * i + 2] * m[14]);
+  }
+  from_matrix(camera, s.p.orientation);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (_samples > 0 && t <= _last.time) {
+    return;
+  }
+
+  if (_samples == 0) {
+    for (int i = 0; i < 3; ++i) {
+      _position[i].reset(s.p.eye[i]);
+      _rotation[i].reset(0.0f);
+    }
+    std::copy(s.p.orientation, s.p.orientation + 4, _orientation);
+  }
+  else {
+    check_predictions(_last, s);
+
+    float const dt = seconds(t - _last.time);
+
+    float turn[3];
+    for (int i = 0; i < 3; ++i) {
+      _position[i].predict(dt, _position_noise);
+      _position[i].update(s.p.eye[i], _position_sample_noise);
+      _rotation[i].predict(dt, _orientation_noise);
+      turn[i] = _rotation[i].x;
+    }
+
+    // the predicted orientation is the linearization point of the update
+    rotate(_orientation, turn, _orientation);
+
+    float residual[3];
+    difference(_orientation, s.p.orientation, residual);
+    for (int i = 0; i < 3; ++i) {
+      _rotation[i].x = 0.0f;
+      _rotation[i].update(residual[i], _orientation_sample_noise);
+      turn[i] = _rotation[i].x;
+      _rotation[i].x = 0.0f;
+    }
+    rotate(_orientation, turn, _orientation);
+  }
+
+  _previous = _last;
+  _last = s;
+  ++_samples;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+scm::math::mat4f pose_predictor::predict(time_point const& t)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  scm::math::mat4f view = scm::math::mat4f::identity();
+  if (_samples == 0) {
+    return view;
+  }
+
+  pose const p = extrapolate(t);
+
+  // back to [R t] with R the inverse of the camera orientation
+  float camera[16];
+  to_matrix(p.orientation, camera);
+  float* m = view.data_array;
+  for (int c = 0; c < 3; ++c) {
+    for (int r = 0; r < 3; ++r) {
+      m[c * 4 + r] = camera[r * 4 + c];
+    }
+  }
+  for (int r = 0; r < 3; ++r) {
+    m[12 + r] = -(m[r] * p.eye[0] + m[4 + r] * p.eye[1] + m[8 + r] * p.eye[2]);
+  }
+
+  if (t > _last.time) {
+    if (_pending.size() >= max_pending) {
+      _pending.erase(_pending.begin());
+    }
+    timed_pose pending;
+    pending.time = t;
+    pending.p = p;
+    // several threads predict with different horizons, kept sorted so
+    // check_predictions finds everything due at the front
+    auto const later = std::upper_bound(_pending.begin(), _pending.end(), pending,
+                                        [](timed_pose const& a, timed_pose const& b) { return a.time < b.time; });
+    _pending.insert(later, pending);
+  }
+
+  return view;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+pose_predictor::pose pose_predictor::extrapolate(time_point const& t) const
+{
+  float const h = std::min(seconds(t - _last.time), seconds(_max_horizon));
+
+  if (_samples < 2 || h <= 0.0f) {
+    return _last.p;
+  }
+
+  pose p;
+  float turn[3];
+
+  if (_model == constant_velocity) {
+    float const dt = seconds(_last.time - _previous.time);
+    float const k = dt > 0.0f ? h / dt : 0.0f;
+
+    difference(_previous.p.orientation, _last.p.orientation, turn);
+    for (int i = 0; i < 3; ++i) {
+      p.eye[i] = _last.p.eye[i] + k * (_last.p.eye[i] - _previous.p.eye[i]);
+      turn[i] *= k;
+    }
+    rotate(_last.p.orientation, turn, p.orientation);
+  }
+  else {
+    for (int i = 0; i < 3; ++i) {
+      p.eye[i] = _position[i].x + h * _position[i].v;
+      turn[i] = h * _rotation[i].v;
+    }
+    rotate(_orientation, turn, p.orientation);
+  }
+
+  return p;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::check_predictions(timed_pose const& previous, timed_pose const& current)
+{
+  // predictions up to the current sample are due, the actual pose is
+  // interpolated between the two samples around them
+  std::size_t due = 0;
+  while (due < _pending.size() && _pending[due].time <= current.time) {
+    timed_pose const& e = _pending[due++];
+
+    float const span = seconds(current.time - previous.time);
+    float const a = span > 0.0f ? std::min(std::max(seconds(e.time - previous.time) / span, 0.0f), 1.0f) : 1.0f;
+
+    float turn[3];
+    difference(previous.p.orientation, current.p.orientation, turn);
+    float eye[3];
+    for (int i = 0; i < 3; ++i) {
+      eye[i] = previous.p.eye[i] + a * (current.p.eye[i] - previous.p.eye[i]);
+      turn[i] *= a;
+    }
+    float actual[4];
+    rotate(previous.p.orientation, turn, actual);
+
+    float const dx = e.p.eye[0] - eye[0];
+    float const dy = e.p.eye[1] - eye[1];
+    float const dz = e.p.eye[2] - eye[2];
+    float const distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+    float error[3];
+    difference(actual, e.p.orientation, error);
+    float const degrees = std::sqrt(error[0] * error[0] + error[1] * error[1] + error[2] * error[2])
+                        * 57.2957795f;
+
+    if (_distances.size() < _history) {
+      _distances.push_back(distance);
+      _degrees.push_back(degrees);
+    }
+    else {
+      _distances[_next] = distance;
+      _degrees[_next] = degrees;
+    }
+    _next = (_next + 1) % _history;
+    ++_count;
+    _max_distance = std::max(_max_distance, double(distance));
+    _max_degrees = std::max(_max_degrees, double(degrees));
+  }
+
+  _pending.erase(_pending.begin(), _pending.begin() + due);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+prediction_statistics pose_predictor::statistics() const
+{
+  std::vector<float> distances;
+  std::vector<float> degrees;
+
+  prediction_statistics s;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    distances = _distances;
+    degrees = _degrees;
+    s.count = _count;
+    s.max_distance = _max_distance;
+    s.max_degrees = _max_degrees;
+  }
+
+  std::sort(distances.begin(), distances.end());
+  std::sort(degrees.begin(), degrees.end());
+
+  double distance_sum = 0.0;
+  double degree_sum = 0.0;
+  for (std::size_t i = 0; i < distances.size(); ++i) {
+    distance_sum += distances[i];
+    degree_sum += degrees[i];
+  }
+
+  s.mean_distance = distances.empty() ? 0.0 : distance_sum / double(distances.size());
+  s.p95_distance  = percentile(distances, 0.95);
+  s.mean_degrees  = degrees.empty() ? 0.0 : degree_sum / double(degrees.size());
+  s.p95_degrees   = percentile(degrees, 0.95);
+  return s;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_predictor::write_report(std::ostream& os) const
+{
+  prediction_statistics s = statistics();
+
+  os << std::fixed << std::setprecision(4)
+     << (model() == kalman ? "kalman" : "constant velocity") << ": " << s.count << " predictions" << std::endl
+     << "  position mean " << s.mean_distance << " p95 " << s.p95_distance << " max " << s.max_distance << " [units]" << std::endl
+     << std::setprecision(3)
+     << "  orientation mean " << s.mean_degrees << " p95 " << s.p95_degrees << " max " << s.max_degrees << " [deg]" << std::endl;
+}
+
+} // namespace diw
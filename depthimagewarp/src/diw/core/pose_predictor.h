@@ -0,0 +1,128 @@
+#ifndef DIW_CORE_POSE_PREDICTOR_H_INCLUDED
+#define DIW_CORE_POSE_PREDICTOR_H_INCLUDED
+
+#include <cstddef>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+
+#include <scm/core/math.h>
+
+#include <diw/core/clock.h>
+
+namespace diw {
+
+struct prediction_statistics
+{
+  std::size_t   count;            // predictions checked in total
+  double        mean_distance;    // the rest over the rolling history only
+  double        p95_distance;
+  double        max_distance;
+  double        mean_degrees;
+  double        p95_degrees;
+  double        max_degrees;
+
+}; // struct prediction_statistics
+
+// extrapolates a camera from timestamped view matrices. the pose is split
+// in eye position and orientation, the orientation extrapolates along its
+// angular velocity as a quaternion:
+//   constant_velocity  velocities from the last two samples, exact for
+//                      steady motion and noisy for everything else
+//   kalman             constant velocity filter per axis, white noise
+//                      acceleration. orientation is filtered as an error
+//                      state, the rotation from the filtered orientation to
+//                      a sample is the measurement and folds back after
+//                      every update.
+// samples come from one thread and predictions from any number of others,
+// each with a horizon of its own. every prediction for the future is kept
+// in time order until samples cover its time, its error against the
+// interpolated actual pose is the metric.
+class pose_predictor
+{
+public:
+  enum prediction_model {
+    constant_velocity,
+    kalman
+  };
+
+  explicit pose_predictor(prediction_model m = kalman, std::size_t history = 4096);
+
+  void              model(prediction_model m);
+  prediction_model  model() const;
+
+  // spectral density of the acceleration noise, position in units^2 / s^3
+  // and orientation in rad^2 / s^3, and variance of a sample. larger
+  // process noise follows turns faster, larger sample noise smoothes more.
+  void              process_noise(float position, float orientation);
+  void              sample_noise(float position, float orientation);
+
+  // predictions never look further ahead of the last sample than this
+  void              max_horizon(duration const& h);
+
+  void              sample(time_point const& t, scm::math::mat4f const& view);
+  bool              has_samples() const;
+
+  // view matrix at time t, the last sample as is before there are two
+  scm::math::mat4f  predict(time_point const& t);
+
+  prediction_statistics statistics() const;
+  void              write_report(std::ostream& os) const;
+
+private:
+  struct pose {
+    float   eye[3];
+    float   orientation[4];   // camera to world, x y z w
+  };
+
+  struct timed_pose {
+    time_point    time;
+    pose          p;
+  };
+
+  // constant velocity kalman filter of one axis
+  struct axis_filter {
+    float   x, v;
+    float   p00, p01, p11;
+
+    void reset(float x0);
+    void predict(float dt, float q);
+    void update(float z, float r);
+  };
+
+  pose              extrapolate(time_point const& t) const;
+  void              check_predictions(timed_pose const& previous, timed_pose const& current);
+
+  prediction_model          _model;
+  duration                  _max_horizon;
+
+  float                     _position_noise;
+  float                     _orientation_noise;
+  float                     _position_sample_noise;
+  float                     _orientation_sample_noise;
+
+  mutable std::mutex        _mutex;
+
+  std::size_t               _samples;
+  timed_pose                _previous;
+  timed_pose                _last;
+
+  axis_filter               _position[3];
+  axis_filter               _rotation[3];     // error state, x is 0 between updates
+  float                     _orientation[4];  // filtered
+
+  std::vector<timed_pose>   _pending;
+
+  std::size_t               _history;
+  std::size_t               _next;
+  std::size_t               _count;
+  std::vector<float>        _distances;
+  std::vector<float>        _degrees;
+  double                    _max_distance;
+  double                    _max_degrees;
+
+}; // class pose_predictor
+
+} // namespace diw
+
+#endif // DIW_CORE_POSE_PREDICTOR_H_INCLUDED
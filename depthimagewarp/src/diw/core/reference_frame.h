@@ -0,0 +1,108 @@
+#ifndef DIW_CORE_REFERENCE_FRAME_H_INCLUDED
+#define DIW_CORE_REFERENCE_FRAME_H_INCLUDED
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <scm/core/math.h>
+
+#include <diw/core/clock.h>
+#include <diw/core/depth_layers.h>
+#include <diw/core/input_stamp.h>
+
+namespace diw {
+
+// the camera a slow client frame was rendered with, when that camera was
+// sampled and which input it reflects.
+struct frame_camera
+{
+  frame_camera()
+    : projection_matrix(scm::math::mat4f::identity())
+    , view_matrix(scm::math::mat4f::identity())
+  {}
+
+  scm::math::mat4f            projection_matrix;
+  scm::math::mat4f            view_matrix;
+
+  time_point                  timestamp;
+  input_stamp                 input;
+
+}; // struct frame_camera
+
+// one frame of the slow client as seen by the cpu: resolved RGBA8 color and
+// window space depth in [0, 1], both bottom-up as glReadPixels returns them,
+// plus its camera. back_layers holds what lies behind the front surface
+// when the slow client peels more than one layer, it is empty otherwise.
+//
+// the pixels are either owned, in color and depth, or borrowed from memory
+// that lives elsewhere, a mapped readback buffer say. a borrowed frame holds
+// a lease on that memory, which is dropped with the frame or its next
+// contents, copies of the frame share the lease. readers go through
+// color_data() and depth_data(), which serve both.
+struct reference_frame : frame_camera
+{
+  reference_frame()
+    : size(0u, 0u)
+    , color_view(nullptr)
+    , depth_view(nullptr)
+    , frame_id(0)
+  {}
+
+  void resize(scm::math::vec2ui const& s) {
+    unborrow();
+    size = s;
+    color.resize(std::size_t(s.x) * s.y);
+    depth.resize(std::size_t(s.x) * s.y);
+  }
+
+  void borrow(scm::math::vec2ui const&          s,
+              std::uint32_t const*              c,
+              float const*                      d,
+              std::shared_ptr<void const> const& l) {
+    size = s;
+    color_view = c;
+    depth_view = d;
+    lease = l;
+  }
+
+  // drops the lease, the pixels are gone with it
+  void unborrow() {
+    color_view = nullptr;
+    depth_view = nullptr;
+    lease.reset();
+  }
+
+  // makes the pixels owned, for a frame kept longer than its lease should be
+  void detach() {
+    if (!borrowed()) {
+      return;
+    }
+    std::size_t const n = std::size_t(size.x) * size.y;
+    color.assign(color_view, color_view + n);
+    depth.assign(depth_view, depth_view + n);
+    unborrow();
+  }
+
+  bool borrowed() const { return color_view != nullptr; }
+  bool empty() const { return size.x == 0 || size.y == 0; }
+
+  std::uint32_t const*  color_data() const { return borrowed() ? color_view : color.data(); }
+  float const*          depth_data() const { return borrowed() ? depth_view : depth.data(); }
+
+  scm::math::vec2ui           size;
+  std::vector<std::uint32_t>  color;
+  std::vector<float>          depth;
+  depth_layers                back_layers;
+
+  std::uint32_t const*        color_view;
+  float const*                depth_view;
+  std::shared_ptr<void const> lease;
+
+  std::uint64_t               frame_id;
+
+}; // struct reference_frame
+
+} // namespace diw
+
+#endif // DIW_CORE_REFERENCE_FRAME_H_INCLUDED
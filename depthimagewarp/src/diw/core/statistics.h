@@ -0,0 +1,31 @@
+#ifndef DIW_CORE_STATISTICS_H_INCLUDED
+#define DIW_CORE_STATISTICS_H_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace diw {
+
+// index of the p-th percentile (0..1) in count sorted samples, nearest rank
+inline std::size_t percentile_rank(std::size_t count, double p)
+{
+  if (count == 0) {
+    return 0;
+  }
+  std::size_t const rank = std::size_t(p * double(count - 1) + 0.5);
+  return std::min(rank, count - 1);
+}
+
+// the p-th percentile (0..1) of ascending samples, 0 if there are none
+inline double percentile(std::vector<float> const& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  return sorted[percentile_rank(sorted.size(), p)];
+}
+
+} // namespace diw
+
+#endif // DIW_CORE_STATISTICS_H_INCLUDED
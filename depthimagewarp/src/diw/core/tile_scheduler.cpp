@@ -0,0 +1,176 @@
+#include "tile_scheduler.h"
+
+#include <algorithm>
+
+#include <diw/core/clock.h>
+#include <diw/core/worker_pool.h>
+
+namespace {
+
+inline std::uint64_t pack_range(std::uint32_t front, std::uint32_t back)
+{
+  return (std::uint64_t(back) << 32) | front;
+}
+
+inline std::uint32_t range_front(std::uint64_t r) { return std::uint32_t(r); }
+inline std::uint32_t range_back(std::uint64_t r)  { return std::uint32_t(r >> 32); }
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+tile_scheduler::tile_scheduler(scm::math::vec2ui const& tile_size)
+  : _tile_size(std::max(tile_size.x, 1u), std::max(tile_size.y, 1u))
+  , _image_size(0u, 0u)
+  , _lane_capacity(0)
+  , _steals(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void tile_scheduler::tile_image(scm::math::vec2ui const& image_size)
+{
+  if (image_size == _image_size) {
+    return;
+  }
+  _image_size = image_size;
+
+  _tiles.clear();
+  for (unsigned y = 0; y < image_size.y; y += _tile_size.y) {
+    for (unsigned x = 0; x < image_size.x; x += _tile_size.x) {
+      tile t;
+      t.origin = scm::math::vec2ui(x, y);
+      t.size   = scm::math::vec2ui(std::min(_tile_size.x, image_size.x - x),
+                                   std::min(_tile_size.y, image_size.y - y));
+      _tiles.push_back(t);
+    }
+  }
+
+  // no history, cost by area
+  _cost.resize(_tiles.size());
+  for (std::size_t i = 0; i < _tiles.size(); ++i) {
+    _cost[i] = std::uint64_t(_tiles[i].size.x) * _tiles[i].size.y;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void tile_scheduler::deal(unsigned lanes)
+{
+  if (lanes > _lane_capacity) {
+    _lanes.reset(new lane[lanes]);
+    _lane_capacity = lanes;
+  }
+
+  std::vector<std::uint32_t> sorted(_tiles.size());
+  for (std::size_t i = 0; i < sorted.size(); ++i) {
+    sorted[i] = std::uint32_t(i);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [this](std::uint32_t a, std::uint32_t b) {
+    return _cost[a] > _cost[b];
+  });
+
+  // longest processing time first, every tile goes to the least loaded lane
+  std::vector<std::uint64_t>              load(lanes, 0);
+  std::vector<std::vector<std::uint32_t>> dealt(lanes);
+  for (std::uint32_t t : sorted) {
+    unsigned const l = unsigned(std::min_element(load.begin(), load.end()) - load.begin());
+    load[l] += std::max<std::uint64_t>(_cost[t], 1);
+    dealt[l].push_back(t);
+  }
+
+  _order.clear();
+  for (unsigned l = 0; l < lanes; ++l) {
+    std::uint32_t const front = std::uint32_t(_order.size());
+    _order.insert(_order.end(), dealt[l].begin(), dealt[l].end());
+    _lanes[l].range.store(pack_range(front, std::uint32_t(_order.size())), std::memory_order_relaxed);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool tile_scheduler::pop_front(lane& l, std::uint32_t& t)
+{
+  std::uint64_t r = l.range.load(std::memory_order_relaxed);
+  for (;;) {
+    std::uint32_t const front = range_front(r);
+    std::uint32_t const back  = range_back(r);
+    if (front >= back) {
+      return false;
+    }
+    if (l.range.compare_exchange_weak(r, pack_range(front + 1, back), std::memory_order_relaxed)) {
+      t = _order[front];
+      return true;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool tile_scheduler::pop_back(lane& l, std::uint32_t& t)
+{
+  std::uint64_t r = l.range.load(std::memory_order_relaxed);
+  for (;;) {
+    std::uint32_t const front = range_front(r);
+    std::uint32_t const back  = range_back(r);
+    if (front >= back) {
+      return false;
+    }
+    if (l.range.compare_exchange_weak(r, pack_range(front, back - 1), std::memory_order_relaxed)) {
+      t = _order[back - 1];
+      return true;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void tile_scheduler::run_lane(unsigned index, unsigned lanes, tile_function const& fn)
+{
+  auto run_tile = [&](std::uint32_t t) {
+    time_point const begin = clock::now();
+    fn(_tiles[t]);
+    _cost[t] = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - begin).count());
+  };
+
+  std::uint32_t t;
+  while (pop_front(_lanes[index], t)) {
+    run_tile(t);
+  }
+
+  // a full round over the other lanes without a single steal means done
+  std::uint64_t stolen = 0;
+  for (bool found = true; found; ) {
+    found = false;
+    for (unsigned k = 1; k < lanes; ++k) {
+      lane& victim = _lanes[(index + k) % lanes];
+      while (pop_back(victim, t)) {
+        run_tile(t);
+        ++stolen;
+        found = true;
+      }
+    }
+  }
+
+  if (stolen) {
+    _steals.fetch_add(stolen, std::memory_order_relaxed);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void tile_scheduler::run(worker_pool& workers, tile_function const& fn)
+{
+  if (_tiles.empty()) {
+    return;
+  }
+
+  unsigned const lanes = std::max(1u, std::min(workers.size(), unsigned(_tiles.size())));
+
+  deal(lanes);
+  _steals.store(0, std::memory_order_relaxed);
+
+  workers.parallel_for(lanes, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t l = begin; l < end; ++l) {
+      run_lane(unsigned(l), lanes, fn);
+    }
+  }, 1);
+}
+
+} // namespace diw
@@ -0,0 +1,82 @@
+#ifndef DIW_CORE_TILE_SCHEDULER_H_INCLUDED
+#define DIW_CORE_TILE_SCHEDULER_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <scm/core/math.h>
+
+namespace diw {
+
+class worker_pool;
+
+// runs a function over the tiles of an image on a worker pool, balanced by
+// what every tile cost the last time. tiles are dealt out to one queue per
+// worker, most expensive first and each to the queue with the least
+// predicted work. a worker drains its own queue from the front and then
+// steals from the back of the others, so mispredictions even out at the
+// granularity of the cheapest tiles.
+//
+// costs are measured on every run and kept while the tiling stays the
+// same, the first run after a change assumes cost proportional to area.
+class tile_scheduler
+{
+public:
+  struct tile {
+    scm::math::vec2ui   origin;
+    scm::math::vec2ui   size;
+  };
+
+  typedef std::function<void(tile const&)> tile_function;
+
+  explicit tile_scheduler(scm::math::vec2ui const& tile_size = scm::math::vec2ui(64u, 64u));
+
+  tile_scheduler(tile_scheduler const&) = delete;
+  tile_scheduler& operator=(tile_scheduler const&) = delete;
+
+  // splits an image of image_size in tiles, a no-op if nothing changed
+  void                  tile_image(scm::math::vec2ui const& image_size);
+
+  std::size_t           tile_count() const { return _tiles.size(); }
+  tile const&           tile_at(std::size_t i) const { return _tiles[i]; }
+
+  // calls fn for every tile, returns when all are done
+  void                  run(worker_pool& workers, tile_function const& fn);
+
+  // tiles taken from another worker's queue during the last run
+  std::uint64_t         last_steals() const { return _steals.load(std::memory_order_relaxed); }
+
+private:
+  // tiles [front, back) of _order, front and back packed in one word so
+  // that the owner and thieves agree through a single compare exchange.
+  // padded rather than aligned, c++14 new ignores over-alignment.
+  struct lane {
+    std::atomic<std::uint64_t>  range;
+    char                        padding[64 - sizeof(std::atomic<std::uint64_t>)];
+  };
+
+  void                  deal(unsigned lanes);
+  void                  run_lane(unsigned index, unsigned lanes, tile_function const& fn);
+  bool                  pop_front(lane& l, std::uint32_t& t);
+  bool                  pop_back(lane& l, std::uint32_t& t);
+
+  scm::math::vec2ui                 _tile_size;
+  scm::math::vec2ui                 _image_size;
+
+  std::vector<tile>                 _tiles;
+  std::vector<std::uint64_t>        _cost;      // ns, written by whoever ran the tile
+  std::vector<std::uint32_t>        _order;     // tiles grouped by lane
+
+  std::unique_ptr<lane[]>           _lanes;
+  unsigned                          _lane_capacity;
+
+  std::atomic<std::uint64_t>        _steals;
+
+}; // class tile_scheduler
+
+} // namespace diw
+
+#endif // DIW_CORE_TILE_SCHEDULER_H_INCLUDED
@@ -0,0 +1,110 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+worker_pool::worker_pool(unsigned num_threads)
+  : _job(nullptr)
+  , _count(0)
+  , _grain(1)
+  , _next(0)
+  , _busy(0)
+  , _generation(0)
+  , _shutdown(false)
+{
+  unsigned spawn = std::max(num_threads, 1u) - 1;
+
+  _threads.reserve(spawn);
+  for (unsigned i = 0; i < spawn; ++i) {
+    _threads.emplace_back(&worker_pool::worker_loop, this);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+worker_pool::~worker_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _shutdown = true;
+  }
+  _work_ready.notify_all();
+
+  for (auto& t : _threads) {
+    t.join();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void worker_pool::parallel_for(std::size_t count, range_function const& fn, std::size_t grain)
+{
+  if (count == 0) {
+    return;
+  }
+
+  grain = std::max<std::size_t>(grain, 1);
+
+  // not worth waking anybody up
+  if (_threads.empty() || count <= grain) {
+    fn(0, count);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _job = &fn;
+    _count = count;
+    _grain = grain;
+    _next.store(0, std::memory_order_relaxed);
+    _busy = static_cast<unsigned>(_threads.size());
+    ++_generation;
+  }
+  _work_ready.notify_all();
+
+  run_chunks();
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _work_done.wait(lock, [this] { return _busy == 0; });
+  _job = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void worker_pool::run_chunks()
+{
+  for (;;) {
+    std::size_t begin = _next.fetch_add(_grain, std::memory_order_relaxed);
+    if (begin >= _count) {
+      break;
+    }
+    (*_job)(begin, std::min(begin + _grain, _count));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void worker_pool::worker_loop()
+{
+  std::uint64_t seen = 0;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _work_ready.wait(lock, [&] { return _shutdown || _generation != seen; });
+      if (_shutdown) {
+        return;
+      }
+      seen = _generation;
+    }
+
+    run_chunks();
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (--_busy == 0) {
+        _work_done.notify_one();
+      }
+    }
+  }
+}
+
+} // namespace diw
@@ -0,0 +1,57 @@
+#ifndef DIW_CORE_WORKER_POOL_H_INCLUDED
+#define DIW_CORE_WORKER_POOL_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace diw {
+
+// persistent pool of worker threads for data parallel loops. the calling
+// thread takes part in every loop, so a pool of size n spawns n - 1 threads.
+// only one parallel_for may be in flight at a time.
+class worker_pool
+{
+public:
+  typedef std::function<void(std::size_t, std::size_t)> range_function;
+
+  explicit worker_pool(unsigned num_threads = std::thread::hardware_concurrency());
+  ~worker_pool();
+
+  worker_pool(worker_pool const&) = delete;
+  worker_pool& operator=(worker_pool const&) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(_threads.size()) + 1; }
+
+  // calls fn(begin, end) on chunks of [0, count) of at most grain elements.
+  // chunks are handed out dynamically, returns when all chunks are done.
+  void parallel_for(std::size_t count, range_function const& fn, std::size_t grain = 1);
+
+private:
+  void worker_loop();
+  void run_chunks();
+
+  std::vector<std::thread>    _threads;
+
+  std::mutex                  _mutex;
+  std::condition_variable     _work_ready;
+  std::condition_variable     _work_done;
+
+  range_function const*       _job;
+  std::size_t                 _count;
+  std::size_t                 _grain;
+  std::atomic<std::size_t>    _next;
+  unsigned                    _busy;
+  std::uint64_t               _generation;
+  bool                        _shutdown;
+
+}; // class worker_pool
+
+} // namespace diw
+
+#endif // DIW_CORE_WORKER_POOL_H_INCLUDED
@@ -0,0 +1,69 @@
+#include "frame_handoff.h"
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t frame_handoff::begin_write(scm::gl::render_context_ptr const& context)
+{
+  const scm::gl::opengl::gl_core& glapi = context->opengl_api();
+
+  fences& f = _slots.back();
+
+  if (f.read) {
+    glapi.glWaitSync(f.read, 0, GL_TIMEOUT_IGNORED);
+    glapi.glDeleteSync(f.read);
+    f.read = nullptr;
+  }
+
+  // published but overwritten before the consumer got to it
+  if (f.written) {
+    glapi.glDeleteSync(f.written);
+    f.written = nullptr;
+  }
+
+  return _slots.back_index();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_handoff::publish(scm::gl::render_context_ptr const& context)
+{
+  const scm::gl::opengl::gl_core& glapi = context->opengl_api();
+
+  fences& f = _slots.back();
+
+  // another context only sees a fence once it got to the gpu
+  f.written = glapi.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glapi.glFlush();
+
+  _slots.publish();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t frame_handoff::acquire(scm::gl::render_context_ptr const& context)
+{
+  if (!_slots.has_new()) {
+    return _front_valid ? _slots.front_index() : npos;
+  }
+
+  const scm::gl::opengl::gl_core& glapi = context->opengl_api();
+
+  // fence the reads of the old front before the producer can get hold of it
+  if (_front_valid) {
+    _slots.front().read = glapi.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glapi.glFlush();
+  }
+
+  _slots.acquire();
+  _front_valid = true;
+
+  fences& f = _slots.front();
+  if (f.written) {
+    glapi.glWaitSync(f.written, 0, GL_TIMEOUT_IGNORED);
+    glapi.glDeleteSync(f.written);
+    f.written = nullptr;
+  }
+
+  return _slots.front_index();
+}
+
+} // namespace diw
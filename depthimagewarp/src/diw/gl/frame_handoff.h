@@ -0,0 +1,68 @@
+#ifndef DIW_GL_FRAME_HANDOFF_H_INCLUDED
+#define DIW_GL_FRAME_HANDOFF_H_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+
+#include <scm/gl_core.h>
+
+#include <diw/sync/frame_mailbox.h>
+
+namespace diw {
+
+// hands gpu resident frames from a producing to a consuming context of one
+// share group. the caller keeps one set of render targets per slot, the
+// handoff says which slot each side may touch and orders the gpu work of
+// both contexts with fences:
+//   - publish() fences the producer's writes, the consumer's context waits
+//     on that fence before its first read of the slot
+//   - acquiring a new slot fences the consumer's reads of the old one, the
+//     producer's context waits on that before writing to it again
+// all waits are glWaitSync, neither thread ever blocks on the other's gpu.
+// the slot rotation is the frame_mailbox triple buffer.
+//
+// the producer side belongs to one thread, the consumer side to another.
+// sync objects still alive on destruction go away with the share group.
+class frame_handoff
+{
+public:
+  static const std::size_t npos = ~std::size_t(0);
+  static const std::size_t slots = frame_mailbox<int>::slots;
+
+  frame_handoff() : _front_valid(false) {}
+
+  frame_handoff(frame_handoff const&) = delete;
+  frame_handoff& operator=(frame_handoff const&) = delete;
+
+  // producer side, the slot to render to. queues the wait for the
+  // consumer's last read of it on context.
+  std::size_t   begin_write(scm::gl::render_context_ptr const& context);
+  void          publish(scm::gl::render_context_ptr const& context);
+
+  // consumer side, the newest published slot, npos before the first
+  // publish. queues the wait for the producer's writes on context.
+  std::size_t   acquire(scm::gl::render_context_ptr const& context);
+
+  bool          has_published() const { return _slots.has_published(); }
+
+  template <typename rep, typename period>
+  bool          wait_for_first(std::chrono::duration<rep, period> const& timeout) {
+    return _slots.wait_for_first(timeout);
+  }
+
+private:
+  struct fences {
+    fences() : written(nullptr), read(nullptr) {}
+
+    GLsync  written;    // set by the producer, cleared by the consumer
+    GLsync  read;       // set by the consumer, cleared by the producer
+  };
+
+  frame_mailbox<fences>   _slots;
+  bool                    _front_valid;   // consumer only
+
+}; // class frame_handoff
+
+} // namespace diw
+
+#endif // DIW_GL_FRAME_HANDOFF_H_INCLUDED
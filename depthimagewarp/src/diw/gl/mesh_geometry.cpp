@@ -0,0 +1,62 @@
+#include "mesh_geometry.h"
+
+#include <vector>
+
+#include <diw/mesh/mesh_cache.h>
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+mesh_geometry::mesh_geometry(scm::gl::render_device_ptr const& device, std::string const& obj_filename)
+  : _index_count(0)
+  , _compiled(false)
+  , _bounds_min(0.0f)
+  , _bounds_max(0.0f)
+{
+  using namespace scm::gl;
+
+  mesh_cache cache;
+  if (!cache.open(obj_filename)) {
+    return;
+  }
+  _compiled = cache.compiled();
+
+  mesh_file_header const& h = cache.header();
+
+  // uploaded from the mapping, the cache is unmapped when it goes out of scope
+  _vertex_buffer = device->create_buffer(BIND_VERTEX_BUFFER, USAGE_STATIC_DRAW,
+                                         h.vertex_count * sizeof(mesh_vertex), cache.vertices());
+  _index_buffer  = device->create_buffer(BIND_INDEX_BUFFER, USAGE_STATIC_DRAW,
+                                         h.index_count * sizeof(std::uint32_t), cache.indices());
+  if (!_vertex_buffer || !_index_buffer) {
+    return;
+  }
+
+  _vertex_array = device->create_vertex_array(vertex_format(0, 0, TYPE_VEC3F, sizeof(mesh_vertex))
+                                                           (0, 1, TYPE_VEC3F, sizeof(mesh_vertex))
+                                                           (0, 2, TYPE_VEC2F, sizeof(mesh_vertex)),
+                                              std::vector<buffer_ptr>(1, _vertex_buffer));
+
+  _index_count = h.index_count;
+  _bounds_min  = scm::math::vec3f(h.bounds_min[0], h.bounds_min[1], h.bounds_min[2]);
+  _bounds_max  = scm::math::vec3f(h.bounds_max[0], h.bounds_max[1], h.bounds_max[2]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void mesh_geometry::draw(scm::gl::render_context_ptr const& context) const
+{
+  using namespace scm::gl;
+
+  if (!valid()) {
+    return;
+  }
+
+  context_vertex_input_guard vig(context);
+
+  context->bind_vertex_array(_vertex_array);
+  context->bind_index_buffer(_index_buffer, PRIMITIVE_TRIANGLE_LIST, TYPE_UINT);
+  context->apply();
+  context->draw_elements(_index_count);
+}
+
+} // namespace diw
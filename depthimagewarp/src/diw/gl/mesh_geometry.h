@@ -0,0 +1,50 @@
+#ifndef DIW_GL_MESH_GEOMETRY_H_INCLUDED
+#define DIW_GL_MESH_GEOMETRY_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+#include <scm/core/math.h>
+#include <scm/gl_core.h>
+
+namespace diw {
+
+// a wavefront obj file drawn from its compiled cache (see mesh_cache). the
+// vertex and index buffers are created straight from the mapped cache, the
+// text is parsed only when the cache is missing or stale. attribute 0 is
+// the position, 1 the normal and 2 the texture coordinate, as with
+// scm::gl::wavefront_obj_geometry.
+class mesh_geometry
+{
+public:
+  mesh_geometry(scm::gl::render_device_ptr const& device, std::string const& obj_filename);
+
+  mesh_geometry(mesh_geometry const&) = delete;
+  mesh_geometry& operator=(mesh_geometry const&) = delete;
+
+  // false if the file could not be read or compiled
+  bool                      valid() const { return _vertex_array != nullptr; }
+
+  // true if the cache had to be compiled from the obj text
+  bool                      compiled() const { return _compiled; }
+
+  scm::math::vec3f const&   bounds_min() const { return _bounds_min; }
+  scm::math::vec3f const&   bounds_max() const { return _bounds_max; }
+
+  void                      draw(scm::gl::render_context_ptr const& context) const;
+
+private:
+  scm::gl::buffer_ptr               _vertex_buffer;
+  scm::gl::buffer_ptr               _index_buffer;
+  scm::gl::vertex_array_ptr         _vertex_array;
+  std::uint32_t                     _index_count;
+  bool                              _compiled;
+
+  scm::math::vec3f                  _bounds_min;
+  scm::math::vec3f                  _bounds_max;
+
+}; // class mesh_geometry
+
+} // namespace diw
+
+#endif // DIW_GL_MESH_GEOMETRY_H_INCLUDED
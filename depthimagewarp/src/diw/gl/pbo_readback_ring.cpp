@@ -0,0 +1,170 @@
+#include "pbo_readback_ring.h"
+
+#include <algorithm>
+
+namespace {
+
+GLbitfield const map_flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// frames are warped straight out of the mapping, which asks for cached
+// client memory rather than whatever the driver maps fastest for one copy
+GLbitfield const storage_flags = map_flags | GL_CLIENT_STORAGE_BIT;
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+pbo_readback_ring::pbo_readback_ring(scm::gl::render_context_ptr const& context, std::size_t slots)
+  : _context(context)
+  , _num_slots(std::max<std::size_t>(slots, 1))
+  , _slots(new slot[std::max<std::size_t>(slots, 1)])
+  , _head(0)
+  , _tail(0)
+{
+  for (std::size_t i = 0; i < _num_slots; ++i) {
+    slot& s = _slots[i];
+    s.buffer   = 0;
+    s.capacity = 0;
+    s.mapping  = nullptr;
+    s.fence    = nullptr;
+    s.size     = scm::math::vec2ui(0u, 0u);
+    s.state.store(slot_free, std::memory_order_relaxed);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+pbo_readback_ring::~pbo_readback_ring()
+{
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+
+  // deleting a buffer unmaps it
+  for (std::size_t i = 0; i < _num_slots; ++i) {
+    if (_slots[i].fence) {
+      glapi.glDeleteSync(_slots[i].fence);
+    }
+    if (_slots[i].buffer) {
+      glapi.glDeleteBuffers(1, &_slots[i].buffer);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool pbo_readback_ring::can_read() const
+{
+  return _slots[_head].state.load(std::memory_order_acquire) == slot_free;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool pbo_readback_ring::reserve(slot& s, std::size_t bytes)
+{
+  if (s.capacity >= bytes) {
+    return true;
+  }
+
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+
+  // immutable storage, a bigger frame needs a new buffer
+  if (s.buffer) {
+    glapi.glDeleteBuffers(1, &s.buffer);
+    s.buffer   = 0;
+    s.capacity = 0;
+    s.mapping  = nullptr;
+  }
+
+  glapi.glGenBuffers(1, &s.buffer);
+  glapi.glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+  glapi.glBufferStorage(GL_PIXEL_PACK_BUFFER, GLsizeiptr(bytes), nullptr, storage_flags);
+  s.mapping = static_cast<std::uint8_t*>(glapi.glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes), map_flags));
+  glapi.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (!s.mapping) {
+    glapi.glDeleteBuffers(1, &s.buffer);
+    s.buffer = 0;
+    return false;
+  }
+
+  s.capacity = bytes;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t pbo_readback_ring::read(scm::gl::frame_buffer_ptr const& source, scm::math::vec2ui const& size)
+{
+  if (!can_read()) {
+    return npos;
+  }
+
+  slot& s = _slots[_head];
+
+  std::size_t const plane = std::size_t(size.x) * size.y * 4;
+  if (!reserve(s, 2 * plane)) {
+    return npos;
+  }
+
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+
+  glapi.glBindFramebuffer(GL_READ_FRAMEBUFFER, source->object_id());
+  glapi.glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+  glapi.glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glapi.glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glapi.glReadPixels(0, 0, size.x, size.y, GL_DEPTH_COMPONENT, GL_FLOAT, reinterpret_cast<void*>(plane));
+  glapi.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glapi.glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+  s.fence = glapi.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  s.size  = size;
+  s.state.store(slot_pending, std::memory_order_relaxed);
+
+  std::size_t index = _head;
+  _head = (_head + 1) % _num_slots;
+  return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t pbo_readback_ring::next_queued() const
+{
+  return _slots[_tail].state.load(std::memory_order_relaxed) == slot_pending ? _tail : npos;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool pbo_readback_ring::acquire(frame& f, std::uint64_t timeout_ns)
+{
+  slot& s = _slots[_tail];
+  if (s.state.load(std::memory_order_relaxed) != slot_pending) {
+    return false;
+  }
+
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+
+  // the flush bit makes sure the fence gets to the gpu at all
+  GLenum result = glapi.glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(timeout_ns));
+  if (result == GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+
+  // a failed wait leaves nothing better to do than hand the data out
+  glapi.glDeleteSync(s.fence);
+  s.fence = nullptr;
+  s.state.store(slot_acquired, std::memory_order_relaxed);
+
+  std::size_t const plane = std::size_t(s.size.x) * s.size.y * 4;
+
+  f.slot  = _tail;
+  f.size  = s.size;
+  f.color = reinterpret_cast<std::uint32_t const*>(s.mapping);
+  f.depth = reinterpret_cast<float const*>(s.mapping + plane);
+
+  _tail = (_tail + 1) % _num_slots;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pbo_readback_ring::release(frame const& f)
+{
+  if (f.slot < _num_slots) {
+    _slots[f.slot].state.store(slot_free, std::memory_order_release);
+  }
+}
+
+} // namespace diw
@@ -0,0 +1,85 @@
+#ifndef DIW_GL_PBO_READBACK_RING_H_INCLUDED
+#define DIW_GL_PBO_READBACK_RING_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <scm/core/math.h>
+#include <scm/gl_core.h>
+
+namespace diw {
+
+// asynchronous readback of the color attachment 0 and the depth attachment
+// of a frame buffer through a ring of persistently mapped pixel pack buffers.
+// read() only queues the copy and a fence, acquire() hands out the oldest
+// finished copy as pointers into the mapping. with n slots a frame is on the
+// cpu at most n - 1 reads later, provided the consumer keeps acquiring.
+//
+// read() and acquire() belong to the thread the context is current on, the
+// pointers stay valid until release(), which any thread may call.
+class pbo_readback_ring
+{
+public:
+  static const std::size_t npos = ~std::size_t(0);
+
+  struct frame {
+    std::size_t           slot;
+    scm::math::vec2ui     size;
+    std::uint32_t const*  color;    // RGBA8, bottom-up
+    float const*          depth;    // window depth, bottom-up
+  };
+
+  pbo_readback_ring(scm::gl::render_context_ptr const& context, std::size_t slots = 3);
+  ~pbo_readback_ring();
+
+  pbo_readback_ring(pbo_readback_ring const&) = delete;
+  pbo_readback_ring& operator=(pbo_readback_ring const&) = delete;
+
+  std::size_t           slots() const { return _num_slots; }
+
+  // true if the next read() has a slot to go to
+  bool                  can_read() const;
+
+  // slot the copy went to, npos if every slot is in flight or acquired
+  std::size_t           read(scm::gl::frame_buffer_ptr const& source, scm::math::vec2ui const& size);
+
+  // slot the next acquire() hands out, npos if no copy is queued
+  std::size_t           next_queued() const;
+
+  // oldest queued copy, waiting at most timeout_ns for its fence
+  bool                  acquire(frame& f, std::uint64_t timeout_ns = 0);
+
+  void                  release(frame const& f);
+
+private:
+  enum slot_state {
+    slot_free,
+    slot_pending,
+    slot_acquired
+  };
+
+  struct slot {
+    unsigned                buffer;
+    std::size_t             capacity;
+    std::uint8_t*           mapping;
+    GLsync                  fence;
+    scm::math::vec2ui       size;
+    std::atomic<int>        state;
+  };
+
+  bool                  reserve(slot& s, std::size_t bytes);
+
+  scm::gl::render_context_ptr       _context;
+
+  std::size_t                       _num_slots;
+  std::unique_ptr<slot[]>           _slots;
+  std::size_t                       _head;    // next read
+  std::size_t                       _tail;    // next acquire
+
+}; // class pbo_readback_ring
+
+} // namespace diw
+
+#endif // DIW_GL_PBO_READBACK_RING_H_INCLUDED
@@ -0,0 +1,270 @@
+#include "async_logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+std::int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(diw::clock::now().time_since_epoch()).count();
+}
+
+char const* level_name(diw::log_level l)
+{
+  switch (l) {
+  case diw::log_level::trace:   return "trace";
+  case diw::log_level::debug:   return "debug";
+  case diw::log_level::info:    return "info";
+  case diw::log_level::warning: return "warning";
+  case diw::log_level::error:   return "error";
+  default:                      return "off";
+  }
+}
+
+diw::log_level level_from_environment(diw::log_level fallback)
+{
+  char const* v = std::getenv("DIW_LOG_LEVEL");
+  if (v == nullptr) {
+    return fallback;
+  }
+  for (int l = 0; l <= int(diw::log_level::off); ++l) {
+    if (std::strcmp(v, level_name(diw::log_level(l))) == 0) {
+      return diw::log_level(l);
+    }
+  }
+  return fallback;
+}
+
+std::chrono::milliseconds const drain_interval(5);
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+log_rate_limit::log_rate_limit(double interval_ms)
+  : _interval_ns(std::int64_t(interval_ms * 1.0e6))
+  , _next_ns(0)
+  , _suppressed(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool log_rate_limit::pass(std::uint32_t& suppressed)
+{
+  std::int64_t now  = now_ns();
+  std::int64_t next = _next_ns.load(std::memory_order_relaxed);
+
+  if (now < next || !_next_ns.compare_exchange_strong(next, now + _interval_ns, std::memory_order_relaxed)) {
+    _suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+async_logger::thread_ring::thread_ring()
+  : head(0)
+  , tail(0)
+  , dropped(0)
+  , retired(false)
+  , records(new record[ring_capacity])
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+async_logger::ring_owner::~ring_owner()
+{
+  // the drain thread frees the ring once it is empty
+  if (ring) {
+    ring->retired.store(true, std::memory_order_release);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+async_logger& async_logger::instance()
+{
+  static async_logger logger;
+  return logger;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+async_logger::async_logger()
+  : _level(int(level_from_environment(log_level::info)))
+  , _epoch(clock::now())
+  , _sink(&std::clog)
+  , _drain_count(0)
+  , _shutdown(false)
+{
+  _drain_thread = std::thread(&async_logger::drain_loop, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+async_logger::~async_logger()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _shutdown = true;
+  }
+  _drain_thread.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void async_logger::sink(std::ostream& os)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _sink = &os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void async_logger::name_current_thread(std::string const& name)
+{
+  thread_ring& r = current_ring();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  r.name = name;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+async_logger::thread_ring& async_logger::current_ring()
+{
+  static thread_local ring_owner owner;
+
+  if (!owner.ring) {
+    owner.ring = std::make_shared<thread_ring>();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    owner.ring->name = "thread " + std::to_string(_rings.size());
+    _rings.push_back(owner.ring);
+  }
+
+  return *owner.ring;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void async_logger::write(log_level l, std::uint32_t suppressed, char const* format, ...)
+{
+  thread_ring& r = current_ring();
+
+  std::size_t tail = r.tail.load(std::memory_order_relaxed);
+  if (tail - r.head.load(std::memory_order_acquire) >= ring_capacity) {
+    r.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  record& rec = r.records[tail % ring_capacity];
+  rec.time_ns    = now_ns();
+  rec.level      = l;
+  rec.suppressed = suppressed;
+
+  va_list args;
+  va_start(args, format);
+  std::vsnprintf(rec.text, message_size, format, args);
+  va_end(args);
+
+  r.tail.store(tail + 1, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void async_logger::flush()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  // two passes, the one running might have started before our messages
+  std::uint64_t target = _drain_count + 2;
+  _drained.wait(lock, [&] { return _drain_count >= target || _shutdown; });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool async_logger::drain()
+{
+  struct line {
+    record const*       rec;
+    std::string const*  thread;
+  };
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  std::vector<line>         lines;
+  std::vector<std::size_t>  tails(_rings.size());
+
+  for (std::size_t i = 0; i < _rings.size(); ++i) {
+    thread_ring& r = *_rings[i];
+
+    std::uint32_t dropped = r.dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+      *_sink << "[" << r.name << "] " << dropped << " log messages dropped, ring full" << std::endl;
+    }
+
+    std::size_t head = r.head.load(std::memory_order_relaxed);
+    tails[i] = r.tail.load(std::memory_order_acquire);
+    for (std::size_t n = head; n != tails[i]; ++n) {
+      line l = { &r.records[n % ring_capacity], &r.name };
+      lines.push_back(l);
+    }
+  }
+
+  // merge the threads back into one timeline
+  std::stable_sort(lines.begin(), lines.end(), [](line const& a, line const& b) {
+    return a.rec->time_ns < b.rec->time_ns;
+  });
+
+  std::int64_t epoch_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_epoch.time_since_epoch()).count();
+
+  for (auto const& l : lines) {
+    *_sink << "[" << std::fixed << std::setprecision(6) << std::setw(12) << double(l.rec->time_ns - epoch_ns) * 1.0e-9 << "] "
+           << "[" << level_name(l.rec->level) << "] [" << *l.thread << "] " << l.rec->text;
+    if (l.rec->suppressed > 0) {
+      *_sink << " (" << l.rec->suppressed << " similar suppressed)";
+    }
+    *_sink << "\n";
+  }
+  if (!lines.empty()) {
+    _sink->flush();
+  }
+
+  // hand the slots back, then let go of rings of finished threads
+  for (std::size_t i = 0; i < _rings.size(); ++i) {
+    _rings[i]->head.store(tails[i], std::memory_order_release);
+  }
+  _rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](std::shared_ptr<thread_ring> const& r) {
+    return r->retired.load(std::memory_order_acquire)
+        && r->head.load(std::memory_order_relaxed) == r->tail.load(std::memory_order_acquire);
+  }), _rings.end());
+
+  ++_drain_count;
+  _drained.notify_all();
+
+  return !lines.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void async_logger::drain_loop()
+{
+  for (;;) {
+    bool shutdown;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      shutdown = _shutdown;
+    }
+
+    // keep going while busy, the last pass after shutdown catches the rest
+    if (!drain() && shutdown) {
+      return;
+    }
+    if (!shutdown) {
+      std::this_thread::sleep_for(drain_interval);
+    }
+  }
+}
+
+} // namespace diw
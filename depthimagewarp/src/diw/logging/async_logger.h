@@ -0,0 +1,152 @@
+#ifndef DIW_LOGGING_ASYNC_LOGGER_H_INCLUDED
+#define DIW_LOGGING_ASYNC_LOGGER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <diw/core/clock.h>
+
+// messages below this level are compiled out (0 trace ... 4 error, 5 off)
+#ifndef DIW_LOG_MIN_LEVEL
+#define DIW_LOG_MIN_LEVEL 1
+#endif
+
+#if defined(__GNUC__)
+#define DIW_LOG_PRINTF_FORMAT(f, a) __attribute__((format(printf, f, a)))
+#else
+#define DIW_LOG_PRINTF_FORMAT(f, a)
+#endif
+
+namespace diw {
+
+enum class log_level
+{
+  trace = 0,
+  debug,
+  info,
+  warning,
+  error,
+  off
+
+}; // enum class log_level
+
+// at most one message per interval per call site, counts the rest
+class log_rate_limit
+{
+public:
+  explicit log_rate_limit(double interval_ms);
+
+  // suppressed receives the messages swallowed since the last one that passed
+  bool                    pass(std::uint32_t& suppressed);
+
+private:
+  std::int64_t                _interval_ns;
+  std::atomic<std::int64_t>   _next_ns;
+  std::atomic<std::uint32_t>  _suppressed;
+
+}; // class log_rate_limit
+
+// logger for the render loops. every thread formats into its own lock-free
+// ring, a background thread drains the rings and writes to the sink. a full
+// ring drops messages instead of blocking the writer.
+class async_logger
+{
+public:
+  static std::size_t const message_size  = 232;
+  static std::size_t const ring_capacity = 1024;
+
+  static async_logger&    instance();
+
+  ~async_logger();
+
+  async_logger(async_logger const&) = delete;
+  async_logger& operator=(async_logger const&) = delete;
+
+  // runtime level on top of DIW_LOG_MIN_LEVEL, initialized from DIW_LOG_LEVEL
+  void                    level(log_level l) { _level.store(int(l), std::memory_order_relaxed); }
+  log_level               level() const { return log_level(_level.load(std::memory_order_relaxed)); }
+  bool                    enabled(log_level l) const { return int(l) >= _level.load(std::memory_order_relaxed); }
+
+  void                    sink(std::ostream& os);
+  void                    name_current_thread(std::string const& name);
+
+  void                    write(log_level l, std::uint32_t suppressed, char const* format, ...) DIW_LOG_PRINTF_FORMAT(4, 5);
+
+  // blocks until everything written before the call reached the sink
+  void                    flush();
+
+private:
+  struct record {
+    std::int64_t    time_ns;
+    log_level       level;
+    std::uint32_t   suppressed;
+    char            text[message_size];
+  };
+
+  struct thread_ring {
+    thread_ring();
+
+    alignas(64) std::atomic<std::size_t>  head;   // consumer
+    alignas(64) std::atomic<std::size_t>  tail;   // producer
+    alignas(64) std::atomic<std::uint32_t> dropped;
+    std::atomic<bool>                     retired;
+
+    std::string                           name;
+    std::unique_ptr<record[]>             records;
+  };
+
+  struct ring_owner {
+    ~ring_owner();
+    std::shared_ptr<thread_ring>  ring;
+  };
+
+  async_logger();
+
+  thread_ring&            current_ring();
+  bool                    drain();
+  void                    drain_loop();
+
+  std::atomic<int>                            _level;
+  time_point                                  _epoch;
+
+  std::mutex                                  _mutex;    // rings, sink
+  std::vector<std::shared_ptr<thread_ring>>   _rings;
+  std::ostream*                               _sink;
+
+  std::condition_variable                     _drained;
+  std::uint64_t                               _drain_count;
+  bool                                        _shutdown;
+  std::thread                                 _drain_thread;
+
+}; // class async_logger
+
+} // namespace diw
+
+#define DIW_LOG(lvl, ...)                                                         \
+  do {                                                                            \
+    if (int(::diw::log_level::lvl) >= DIW_LOG_MIN_LEVEL                           \
+      && ::diw::async_logger::instance().enabled(::diw::log_level::lvl)) {        \
+      ::diw::async_logger::instance().write(::diw::log_level::lvl, 0, __VA_ARGS__); \
+    }                                                                             \
+  } while (false)
+
+#define DIW_LOG_EVERY(lvl, interval_ms, ...)                                      \
+  do {                                                                            \
+    if (int(::diw::log_level::lvl) >= DIW_LOG_MIN_LEVEL                           \
+      && ::diw::async_logger::instance().enabled(::diw::log_level::lvl)) {        \
+      static ::diw::log_rate_limit diw_log_limit(interval_ms);                    \
+      std::uint32_t diw_log_suppressed = 0;                                       \
+      if (diw_log_limit.pass(diw_log_suppressed)) {                               \
+        ::diw::async_logger::instance().write(::diw::log_level::lvl, diw_log_suppressed, __VA_ARGS__); \
+      }                                                                           \
+    }                                                                             \
+  } while (false)
+
+#endif // DIW_LOGGING_ASYNC_LOGGER_H_INCLUDED
@@ -0,0 +1,262 @@
+#include "mesh_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+#include <diw/mesh/obj_compiler.h>
+
+namespace {
+
+std::uint64_t fnv1a(char const* data, std::size_t size)
+{
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (std::size_t i = 0; i < size; ++i) {
+    h ^= std::uint8_t(data[i]);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+std::uint64_t align(std::uint64_t offset)
+{
+  return (offset + diw::mesh_alignment - 1) / diw::mesh_alignment * diw::mesh_alignment;
+}
+
+int process_id()
+{
+#if !defined(_WIN32)
+  return int(::getpid());
+#else
+  return ::_getpid();
+#endif
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+mesh_cache::mesh_cache()
+  : _data(nullptr)
+  , _size(0)
+  , _compiled(false)
+  , _fd(-1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+mesh_cache::~mesh_cache()
+{
+  close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool mesh_cache::open(std::string const& obj_filename)
+{
+  close();
+
+  std::ifstream in(obj_filename, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  std::vector<char> source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::uint64_t const hash = fnv1a(source.data(), source.size());
+
+  if (map(cache_filename(obj_filename)) && validate(hash, source.size())) {
+    return true;
+  }
+  unmap();
+
+  return compile(obj_filename, source, hash);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void mesh_cache::close()
+{
+  unmap();
+  _compiled = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+mesh_vertex const* mesh_cache::vertices() const
+{
+  return _data ? reinterpret_cast<mesh_vertex const*>(_data + header().vertex_offset) : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t const* mesh_cache::indices() const
+{
+  return _data ? reinterpret_cast<std::uint32_t const*>(_data + header().index_offset) : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool mesh_cache::map(std::string const& filename)
+{
+#if !defined(_WIN32)
+  _fd = ::open(filename.c_str(), O_RDONLY);
+  if (_fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(_fd, &st) != 0 || st.st_size < off_t(sizeof(mesh_file_header))) {
+    unmap();
+    return false;
+  }
+
+  void* m = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_SHARED, _fd, 0);
+  if (m == MAP_FAILED) {
+    unmap();
+    return false;
+  }
+  // read once front to back by the upload. advice values are not flags,
+  // each one takes a call of its own.
+  ::madvise(m, std::size_t(st.st_size), MADV_SEQUENTIAL);
+  ::madvise(m, std::size_t(st.st_size), MADV_WILLNEED);
+
+  _data = static_cast<std::uint8_t const*>(m);
+  _size = std::uint64_t(st.st_size);
+#else
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  _buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  if (_buffer.size() < sizeof(mesh_file_header)) {
+    unmap();
+    return false;
+  }
+  _data = _buffer.data();
+  _size = _buffer.size();
+#endif
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void mesh_cache::unmap()
+{
+#if !defined(_WIN32)
+  if (_data && _fd >= 0) {
+    ::munmap(const_cast<std::uint8_t*>(_data), std::size_t(_size));
+  }
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+#endif
+  _fd = -1;
+  _buffer.clear();
+
+  _data = nullptr;
+  _size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool mesh_cache::validate(std::uint64_t source_hash, std::uint64_t source_size) const
+{
+  mesh_file_header const& h = header();
+
+  if (std::memcmp(h.magic, mesh_magic, sizeof(h.magic)) != 0
+    || h.version != mesh_version
+    || h.header_size != sizeof(mesh_file_header)
+    || h.vertex_stride != sizeof(mesh_vertex)) {
+    return false;
+  }
+
+  if (h.source_hash != source_hash || h.source_size != source_size) {
+    return false;
+  }
+
+  if (h.vertex_offset % mesh_alignment != 0 || h.index_offset % mesh_alignment != 0
+    || h.vertex_offset > _size || h.vertex_count > (_size - h.vertex_offset) / sizeof(mesh_vertex)
+    || h.index_offset > _size || h.index_count > (_size - h.index_offset) / sizeof(std::uint32_t)
+    || h.index_count % 3 != 0) {
+    return false;
+  }
+
+  // a damaged cache with an intact header must not reach the gpu, every
+  // index is checked once here instead of trusted on every draw
+  std::uint32_t const* index = indices();
+  for (std::uint32_t i = 0; i < h.index_count; ++i) {
+    if (index[i] >= h.vertex_count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool mesh_cache::compile(std::string const& obj_filename, std::vector<char> const& source, std::uint64_t source_hash)
+{
+  compiled_mesh mesh;
+  if (!compile_obj(source.data(), source.size(), mesh)) {
+    return false;
+  }
+
+  mesh_file_header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, mesh_magic, sizeof(h.magic));
+  h.version       = mesh_version;
+  h.header_size   = sizeof(mesh_file_header);
+  h.source_hash   = source_hash;
+  h.source_size   = source.size();
+  h.vertex_count  = std::uint32_t(mesh.vertices.size());
+  h.vertex_stride = sizeof(mesh_vertex);
+  h.vertex_offset = align(sizeof(mesh_file_header));
+  h.index_count   = std::uint32_t(mesh.indices.size());
+  h.index_offset  = align(h.vertex_offset + mesh.vertices.size() * sizeof(mesh_vertex));
+  std::copy(mesh.bounds_min, mesh.bounds_min + 3, h.bounds_min);
+  std::copy(mesh.bounds_max, mesh.bounds_max + 3, h.bounds_max);
+
+  std::vector<std::uint8_t> image(std::size_t(h.index_offset + mesh.indices.size() * sizeof(std::uint32_t)), 0);
+  std::memcpy(image.data(), &h, sizeof(h));
+  std::memcpy(image.data() + h.vertex_offset, mesh.vertices.data(), mesh.vertices.size() * sizeof(mesh_vertex));
+  std::memcpy(image.data() + h.index_offset, mesh.indices.data(), mesh.indices.size() * sizeof(std::uint32_t));
+
+  _compiled = true;
+
+  // written aside and renamed, a reader never maps half a cache. the
+  // temporary is per process and cache object, several may compile the
+  // same source at once.
+  std::string const cache = cache_filename(obj_filename);
+  std::string const temporary = cache + "." + std::to_string(process_id())
+                                      + "." + std::to_string(std::uintptr_t(this)) + ".tmp";
+  bool written = false;
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<char const*>(image.data()), std::streamsize(image.size()));
+    out.close();
+    written = !out.fail();
+  }
+#if defined(_WIN32)
+  // rename does not replace an existing file here, posix rename does so
+  // atomically and no reader ever finds the cache missing
+  if (written) {
+    std::remove(cache.c_str());
+  }
+#endif
+  if (written && std::rename(temporary.c_str(), cache.c_str()) == 0 && map(cache) && validate(source_hash, source.size())) {
+    return true;
+  }
+  unmap();
+  std::remove(temporary.c_str());
+
+  // no cache for the next start, this one still has the mesh
+  _buffer.swap(image);
+  _data = _buffer.data();
+  _size = _buffer.size();
+  return true;
+}
+
+} // namespace diw
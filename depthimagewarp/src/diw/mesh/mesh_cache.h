@@ -0,0 +1,58 @@
+#ifndef DIW_MESH_MESH_CACHE_H_INCLUDED
+#define DIW_MESH_MESH_CACHE_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <diw/mesh/mesh_format.h>
+
+namespace diw {
+
+// the compiled form of a wavefront obj file, next to it as <file>.diwmesh.
+// open() hashes the source and maps the cache if it was compiled from the
+// same bytes, otherwise it compiles the source once and writes the cache
+// for the next start. vertices and indices point into the read-only
+// mapping, ready to be uploaded without a copy. without mmap (windows), or
+// where the cache cannot be written, the compiled file is kept in memory.
+class mesh_cache
+{
+public:
+  mesh_cache();
+  ~mesh_cache();
+
+  mesh_cache(mesh_cache const&) = delete;
+  mesh_cache& operator=(mesh_cache const&) = delete;
+
+  bool                    open(std::string const& obj_filename);
+  void                    close();
+  bool                    is_open() const { return _data != nullptr; }
+
+  // true if open() had to compile the source
+  bool                    compiled() const { return _compiled; }
+
+  mesh_file_header const& header() const { return *reinterpret_cast<mesh_file_header const*>(_data); }
+
+  mesh_vertex const*      vertices() const;
+  std::uint32_t const*    indices() const;
+
+  static std::string      cache_filename(std::string const& obj_filename) { return obj_filename + ".diwmesh"; }
+
+private:
+  bool                    map(std::string const& filename);
+  void                    unmap();
+  bool                    validate(std::uint64_t source_hash, std::uint64_t source_size) const;
+  bool                    compile(std::string const& obj_filename, std::vector<char> const& source, std::uint64_t source_hash);
+
+  std::uint8_t const*               _data;
+  std::uint64_t                     _size;
+  bool                              _compiled;
+
+  int                               _fd;
+  std::vector<std::uint8_t>         _buffer;     // without mmap
+
+}; // class mesh_cache
+
+} // namespace diw
+
+#endif // DIW_MESH_MESH_CACHE_H_INCLUDED
@@ -0,0 +1,59 @@
+#ifndef DIW_MESH_MESH_FORMAT_H_INCLUDED
+#define DIW_MESH_MESH_FORMAT_H_INCLUDED
+
+#include <cstdint>
+
+namespace diw {
+
+// compiled mesh file, little endian, meant to be mapped and handed to the
+// gpu as is:
+//
+//   mesh_file_header
+//   mesh_vertex[vertex_count] at vertex_offset, interleaved
+//   std::uint32_t[index_count] at index_offset, triangle list
+//
+// both arrays start 16 byte aligned. the header keeps a hash and the size
+// of the source it was compiled from, a cache whose source changed is
+// compiled again.
+
+std::uint32_t const mesh_version          = 1;
+std::uint64_t const mesh_alignment        = 16;
+
+struct mesh_vertex
+{
+  float           position[3];
+  float           normal[3];
+  float           texture_coord[2];
+
+}; // struct mesh_vertex
+
+struct mesh_file_header
+{
+  char            magic[8];         // "DIWMESH\0"
+  std::uint32_t   version;
+  std::uint32_t   header_size;
+
+  std::uint64_t   source_hash;      // fnv-1a 64 of the source bytes
+  std::uint64_t   source_size;
+
+  std::uint32_t   vertex_count;
+  std::uint32_t   vertex_stride;
+  std::uint64_t   vertex_offset;
+  std::uint32_t   index_count;
+  std::uint32_t   reserved_0;
+  std::uint64_t   index_offset;
+
+  float           bounds_min[3];
+  float           bounds_max[3];
+  std::uint8_t    reserved[40];
+
+}; // struct mesh_file_header
+
+static_assert(sizeof(mesh_vertex) == 32, "mesh_vertex layout changed");
+static_assert(sizeof(mesh_file_header) == 128, "mesh_file_header layout changed");
+
+char const mesh_magic[8] = { 'D', 'I', 'W', 'M', 'E', 'S', 'H', '\0' };
+
+} // namespace diw
+
+#endif // DIW_MESH_MESH_FORMAT_H_INCLUDED
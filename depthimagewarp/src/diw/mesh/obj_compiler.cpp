@@ -0,0 +1,326 @@
+#include "obj_compiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+std::int64_t const absent = -1;
+std::int64_t const invalid = -2;
+
+// element indices of one face corner, absent where the face has none
+struct corner {
+  std::int64_t  p, t, n;
+
+  bool operator==(corner const& o) const { return p == o.p && t == o.t && n == o.n; }
+};
+
+struct corner_hash {
+  std::size_t operator()(corner const& c) const {
+    std::uint64_t h = std::uint64_t(c.p) * 0x9e3779b97f4a7c15ull;
+    h ^= std::uint64_t(c.t) * 0xc2b2ae3d27d4eb4full + (h << 6) + (h >> 2);
+    h ^= std::uint64_t(c.n) * 0x165667b19e3779f9ull + (h << 6) + (h >> 2);
+    return std::size_t(h);
+  }
+};
+
+bool is_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+void skip_space(char const*& p, char const* end)
+{
+  while (p < end && is_space(*p)) {
+    ++p;
+  }
+}
+
+void skip_line(char const*& p, char const* end)
+{
+  while (p < end && *p != '\n') {
+    ++p;
+  }
+  if (p < end) {
+    ++p;
+  }
+}
+
+// decimal with optional sign, fraction and exponent, never reads past end.
+// digits beyond what a double holds exactly only move the exponent.
+bool parse_float(char const*& p, char const* end, float& f)
+{
+  skip_space(p, end);
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  std::uint64_t const mantissa_limit = 900000000000000ull;
+  std::uint64_t mantissa = 0;
+  int           exponent = 0;
+  bool          digits = false;
+
+  for (; p < end && is_digit(*p); ++p) {
+    digits = true;
+    if (mantissa < mantissa_limit) {
+      mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+    }
+    else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && is_digit(*p); ++p) {
+      digits = true;
+      if (mantissa < mantissa_limit) {
+        mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+        --exponent;
+      }
+    }
+  }
+  if (!digits) {
+    return false;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    char const* q = p + 1;
+    bool        exponent_negative = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+      exponent_negative = *q == '-';
+      ++q;
+    }
+    if (q < end && is_digit(*q)) {
+      int e = 0;
+      for (; q < end && is_digit(*q); ++q) {
+        e = std::min(e * 10 + (*q - '0'), 10000);
+      }
+      exponent += exponent_negative ? -e : e;
+      p = q;
+    }
+  }
+
+  double v = double(mantissa);
+  if (exponent > 0) {
+    v *= std::pow(10.0, exponent);
+  }
+  else if (exponent < 0) {
+    v /= std::pow(10.0, -exponent);
+  }
+  f = float(negative ? -v : v);
+  return true;
+}
+
+bool parse_index(char const*& p, char const* end, std::int64_t& i)
+{
+  bool negative = false;
+  if (p < end && *p == '-') {
+    negative = true;
+    ++p;
+  }
+  if (p >= end || !is_digit(*p)) {
+    return false;
+  }
+
+  i = 0;
+  for (; p < end && is_digit(*p); ++p) {
+    i = std::min<std::int64_t>(i * 10 + (*p - '0'), std::numeric_limits<std::int32_t>::max());
+  }
+  if (negative) {
+    i = -i;
+  }
+  return true;
+}
+
+// 1 based, or negative from the last element read so far. positive ones
+// are checked once all elements are known.
+std::int64_t resolve(std::int64_t i, std::size_t count)
+{
+  if (i > 0) {
+    return i - 1;
+  }
+  if (i < 0 && std::int64_t(count) + i >= 0) {
+    return std::int64_t(count) + i;
+  }
+  return invalid;
+}
+
+bool in_range(std::int64_t i, std::size_t count)
+{
+  return i == absent || (i >= 0 && i < std::int64_t(count));
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+bool compile_obj(char const* text, std::size_t size, compiled_mesh& mesh)
+{
+  mesh.vertices.clear();
+  mesh.indices.clear();
+
+  std::vector<float>  positions;
+  std::vector<float>  normals;
+  std::vector<float>  texture_coords;
+  std::vector<corner> corners;      // three per triangle
+  std::vector<corner> face;
+
+  char const* p = text;
+  char const* end = text + size;
+
+  while (p < end) {
+    skip_space(p, end);
+
+    if (end - p > 1 && p[0] == 'v' && is_space(p[1])) {
+      p += 1;
+      float x, y, z;
+      if (!parse_float(p, end, x) || !parse_float(p, end, y) || !parse_float(p, end, z)) {
+        return false;
+      }
+      positions.push_back(x);
+      positions.push_back(y);
+      positions.push_back(z);
+    }
+    else if (end - p > 2 && p[0] == 'v' && p[1] == 'n' && is_space(p[2])) {
+      p += 2;
+      float x, y, z;
+      if (!parse_float(p, end, x) || !parse_float(p, end, y) || !parse_float(p, end, z)) {
+        return false;
+      }
+      normals.push_back(x);
+      normals.push_back(y);
+      normals.push_back(z);
+    }
+    else if (end - p > 2 && p[0] == 'v' && p[1] == 't' && is_space(p[2])) {
+      p += 2;
+      float u, v = 0.0f;
+      if (!parse_float(p, end, u)) {
+        return false;
+      }
+      parse_float(p, end, v);
+      texture_coords.push_back(u);
+      texture_coords.push_back(v);
+    }
+    else if (end - p > 1 && p[0] == 'f' && is_space(p[1])) {
+      p += 1;
+      face.clear();
+      for (;;) {
+        skip_space(p, end);
+
+        corner       c = { absent, absent, absent };
+        std::int64_t i;
+        if (!parse_index(p, end, i)) {
+          break;
+        }
+        c.p = resolve(i, positions.size() / 3);
+        if (p < end && *p == '/') {
+          ++p;
+          if (parse_index(p, end, i)) {
+            c.t = resolve(i, texture_coords.size() / 2);
+          }
+          if (p < end && *p == '/') {
+            ++p;
+            if (parse_index(p, end, i)) {
+              c.n = resolve(i, normals.size() / 3);
+            }
+          }
+        }
+        face.push_back(c);
+      }
+
+      for (std::size_t k = 1; k + 1 < face.size(); ++k) {
+        corners.push_back(face[0]);
+        corners.push_back(face[k]);
+        corners.push_back(face[k + 1]);
+      }
+    }
+
+    skip_line(p, end);
+  }
+
+  if (corners.empty()) {
+    return false;
+  }
+
+  bool smooth_normals = false;
+  for (corner const& c : corners) {
+    if (c.p == absent || !in_range(c.p, positions.size() / 3)
+      || !in_range(c.t, texture_coords.size() / 2) || !in_range(c.n, normals.size() / 3)) {
+      return false;
+    }
+    smooth_normals = smooth_normals || c.n == absent;
+  }
+
+  // the cross product is twice the area, summing it weights by area
+  std::vector<float> smooth;
+  if (smooth_normals) {
+    smooth.assign(positions.size(), 0.0f);
+    for (std::size_t k = 0; k < corners.size(); k += 3) {
+      float const* a = &positions[3 * corners[k].p];
+      float const* b = &positions[3 * corners[k + 1].p];
+      float const* c = &positions[3 * corners[k + 2].p];
+
+      float const u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+      float const v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+      float const n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+
+      for (std::size_t j = 0; j < 3; ++j) {
+        float* s = &smooth[3 * corners[k + j].p];
+        s[0] += n[0];
+        s[1] += n[1];
+        s[2] += n[2];
+      }
+    }
+    for (std::size_t k = 0; k < smooth.size(); k += 3) {
+      float const l = std::sqrt(smooth[k] * smooth[k] + smooth[k + 1] * smooth[k + 1] + smooth[k + 2] * smooth[k + 2]);
+      if (l > 0.0f) {
+        smooth[k] /= l;
+        smooth[k + 1] /= l;
+        smooth[k + 2] /= l;
+      }
+    }
+  }
+
+  std::fill(mesh.bounds_min, mesh.bounds_min + 3, std::numeric_limits<float>::max());
+  std::fill(mesh.bounds_max, mesh.bounds_max + 3, -std::numeric_limits<float>::max());
+
+  std::unordered_map<corner, std::uint32_t, corner_hash> shared;
+  shared.reserve(corners.size());
+  mesh.indices.reserve(corners.size());
+
+  for (corner const& c : corners) {
+    auto inserted = shared.insert(std::make_pair(c, std::uint32_t(mesh.vertices.size())));
+    mesh.indices.push_back(inserted.first->second);
+    if (!inserted.second) {
+      continue;
+    }
+
+    mesh_vertex v;
+    float const* position = &positions[3 * c.p];
+    float const* normal = c.n != absent ? &normals[3 * c.n] : &smooth[3 * c.p];
+    std::copy(position, position + 3, v.position);
+    std::copy(normal, normal + 3, v.normal);
+    v.texture_coord[0] = c.t != absent ? texture_coords[2 * c.t] : 0.0f;
+    v.texture_coord[1] = c.t != absent ? texture_coords[2 * c.t + 1] : 0.0f;
+    mesh.vertices.push_back(v);
+
+    for (int k = 0; k < 3; ++k) {
+      mesh.bounds_min[k] = std::min(mesh.bounds_min[k], position[k]);
+      mesh.bounds_max[k] = std::max(mesh.bounds_max[k], position[k]);
+    }
+  }
+
+  return true;
+}
+
+} // namespace diw
@@ -0,0 +1,34 @@
+#ifndef DIW_MESH_OBJ_COMPILER_H_INCLUDED
+#define DIW_MESH_OBJ_COMPILER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <diw/mesh/mesh_format.h>
+
+namespace diw {
+
+// one indexed triangle list from wavefront obj text. positions, normals and
+// texture coordinates of a face corner become one interleaved vertex, equal
+// corners share it. polygons are fanned into triangles, negative indices
+// count back from the last element. corners without a normal get the area
+// weighted normal of the faces around their position, corners without
+// texture coordinates get 0. groups, objects and materials are ignored, the
+// examples draw with one material.
+struct compiled_mesh
+{
+  std::vector<mesh_vertex>    vertices;
+  std::vector<std::uint32_t>  indices;
+  float                       bounds_min[3];
+  float                       bounds_max[3];
+
+}; // struct compiled_mesh
+
+// text need not be terminated, false if it holds no triangle or a face
+// refers to an element that does not exist
+bool compile_obj(char const* text, std::size_t size, compiled_mesh& mesh);
+
+} // namespace diw
+
+#endif // DIW_MESH_OBJ_COMPILER_H_INCLUDED
@@ -0,0 +1,107 @@
+#include "gpu_timer.h"
+
+#include <algorithm>
+
+#include <diw/core/clock.h>
+#include <diw/profiling/profiler.h>
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+gpu_timer::gpu_timer(profiler& p, scm::gl::render_context_ptr const& context, std::size_t capacity)
+  : _profiler(p)
+  , _context(context)
+  , _zones(std::max<std::size_t>(capacity, 1))
+  , _head(0)
+  , _tail(0)
+{
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+
+  for (auto& z : _zones) {
+    z.name = nullptr;
+    z.state = zone_free;
+    glapi.glGenQueries(2, z.queries);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+gpu_timer::~gpu_timer()
+{
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+
+  for (auto& z : _zones) {
+    glapi.glDeleteQueries(2, z.queries);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t gpu_timer::begin(char const* name)
+{
+  zone& z = _zones[_head];
+  if (z.state != zone_free) {
+    return npos;
+  }
+
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+  glapi.glQueryCounter(z.queries[0], GL_TIMESTAMP);
+
+  z.name = name;
+  z.state = zone_open;
+
+  std::size_t index = _head;
+  _head = (_head + 1) % _zones.size();
+  return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void gpu_timer::end(std::size_t index)
+{
+  if (index >= _zones.size() || _zones[index].state != zone_open) {
+    return;
+  }
+
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+  glapi.glQueryCounter(_zones[index].queries[1], GL_TIMESTAMP);
+
+  _zones[index].state = zone_pending;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void gpu_timer::collect()
+{
+  if (_zones[_tail].state != zone_pending) {
+    return;
+  }
+
+  const scm::gl::opengl::gl_core& glapi = _context->opengl_api();
+
+  // gpu timestamps live in their own time base, anchor them to the cpu clock
+  GLint64 gpu_now = 0;
+  glapi.glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+  time_point const cpu_now = clock::now();
+
+  while (_zones[_tail].state == zone_pending) {
+    zone& z = _zones[_tail];
+
+    GLint available = 0;
+    glapi.glGetQueryObjectiv(z.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+
+    GLuint64 begin_ns = 0;
+    GLuint64 end_ns = 0;
+    glapi.glGetQueryObjectui64v(z.queries[0], GL_QUERY_RESULT, &begin_ns);
+    glapi.glGetQueryObjectui64v(z.queries[1], GL_QUERY_RESULT, &end_ns);
+
+    time_point const begin = cpu_now - std::chrono::duration_cast<duration>(std::chrono::nanoseconds(gpu_now - GLint64(begin_ns)));
+    time_point const end   = cpu_now - std::chrono::duration_cast<duration>(std::chrono::nanoseconds(gpu_now - GLint64(end_ns)));
+
+    _profiler.record(z.name, begin, end, true);
+
+    z.state = zone_free;
+    _tail = (_tail + 1) % _zones.size();
+  }
+}
+
+} // namespace diw
@@ -0,0 +1,59 @@
+#ifndef DIW_PROFILING_GPU_TIMER_H_INCLUDED
+#define DIW_PROFILING_GPU_TIMER_H_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+#include <scm/gl_core.h>
+
+namespace diw {
+
+class profiler;
+
+// gpu zones from GL_TIMESTAMP query pairs on the context current on the
+// calling thread. results are picked up without stalling by collect(), a
+// few frames late, and reported to the profiler on the cpu clock. a timer
+// belongs to one thread and must only be used while its context is current.
+class gpu_timer
+{
+public:
+  static const std::size_t npos = ~std::size_t(0);
+
+  gpu_timer(profiler& p, scm::gl::render_context_ptr const& context, std::size_t capacity = 64);
+  ~gpu_timer();
+
+  gpu_timer(gpu_timer const&) = delete;
+  gpu_timer& operator=(gpu_timer const&) = delete;
+
+  // npos if all query pairs are in flight, the zone is dropped then
+  std::size_t   begin(char const* name);
+  void          end(std::size_t zone);
+
+  // reports every finished zone, oldest first
+  void          collect();
+
+private:
+  enum zone_state {
+    zone_free,
+    zone_open,
+    zone_pending
+  };
+
+  struct zone {
+    char const* name;
+    unsigned    queries[2];
+    zone_state  state;
+  };
+
+  profiler&                     _profiler;
+  scm::gl::render_context_ptr   _context;
+
+  std::vector<zone>             _zones;
+  std::size_t                   _head;
+  std::size_t                   _tail;
+
+}; // class gpu_timer
+
+} // namespace diw
+
+#endif // DIW_PROFILING_GPU_TIMER_H_INCLUDED
@@ -0,0 +1,132 @@
+#include "latency_tracker.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#include <diw/core/statistics.h>
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+latency_tracker::latency_tracker(double bucket_ms, std::size_t num_buckets, std::size_t history)
+  : _bucket_ms(bucket_ms > 0.0 ? bucket_ms : 1.0)
+  , _num_buckets(std::max<std::size_t>(num_buckets, 1))
+  , _history(std::max<std::size_t>(history, 1))
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void latency_tracker::presented(std::string const& path, input_stamp const& input, time_point const& present_time)
+{
+  // no input yet
+  if (input.sequence == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto p = _paths.find(path);
+  if (p == _paths.end()) {
+    path_data d;
+    d.last_sequence = 0;
+    d.next = 0;
+    d.count = 0;
+    d.max_ms = 0.0;
+    d.histogram.assign(_num_buckets, 0);
+    p = _paths.insert(std::make_pair(path, d)).first;
+  }
+
+  path_data& d = p->second;
+  if (input.sequence <= d.last_sequence) {
+    return;
+  }
+  d.last_sequence = input.sequence;
+
+  double const ms = to_milliseconds(present_time - input.time);
+
+  if (d.latencies_ms.size() < _history) {
+    d.latencies_ms.push_back(float(ms));
+  }
+  else {
+    d.latencies_ms[d.next] = float(ms);
+  }
+  d.next = (d.next + 1) % _history;
+  ++d.count;
+  d.max_ms = std::max(d.max_ms, ms);
+
+  std::size_t bucket = ms > 0.0 ? std::size_t(ms / _bucket_ms) : 0;
+  ++d.histogram[std::min(bucket, _num_buckets - 1)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<latency_statistics> latency_tracker::statistics() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  std::vector<latency_statistics> result;
+
+  std::vector<float> sorted;
+  for (auto const& p : _paths) {
+    sorted = p.second.latencies_ms;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (float l : sorted) {
+      sum += l;
+    }
+
+    latency_statistics s;
+    s.path      = p.first;
+    s.count     = p.second.count;
+    s.mean_ms   = sorted.empty() ? 0.0 : sum / double(sorted.size());
+    s.p50_ms    = percentile(sorted, 0.50);
+    s.p95_ms    = percentile(sorted, 0.95);
+    s.p99_ms    = percentile(sorted, 0.99);
+    s.max_ms    = p.second.max_ms;
+    s.bucket_ms = _bucket_ms;
+    s.histogram = p.second.histogram;
+    result.push_back(s);
+  }
+
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void latency_tracker::write_report(std::ostream& os) const
+{
+  std::vector<latency_statistics> stats = statistics();
+
+  os << std::fixed << std::setprecision(3);
+  for (auto const& s : stats) {
+    os << s.path << ": " << s.count << " inputs, mean " << s.mean_ms
+       << " p50 " << s.p50_ms << " p95 " << s.p95_ms << " p99 " << s.p99_ms
+       << " max " << s.max_ms << " [ms]" << std::endl;
+
+    std::size_t peak = *std::max_element(s.histogram.begin(), s.histogram.end());
+    if (peak == 0) {
+      continue;
+    }
+
+    // skip the empty tail, the last bucket is open ended
+    std::size_t last = s.histogram.size();
+    while (last > 1 && s.histogram[last - 1] == 0) {
+      --last;
+    }
+
+    os << std::setprecision(1);
+    for (std::size_t b = 0; b < last; ++b) {
+      bool const open_ended = b + 1 == s.histogram.size();
+      os << "  " << std::setw(6) << double(b) * s.bucket_ms
+         << (open_ended ? " +       " : " - ") << std::setw(6);
+      if (!open_ended) {
+        os << double(b + 1) * s.bucket_ms;
+      }
+      os << " ms " << std::setw(8) << s.histogram[b] << " "
+         << std::string(40 * s.histogram[b] / peak, '#') << std::endl;
+    }
+    os << std::setprecision(3);
+  }
+}
+
+} // namespace diw
@@ -0,0 +1,66 @@
+#ifndef DIW_PROFILING_LATENCY_TRACKER_H_INCLUDED
+#define DIW_PROFILING_LATENCY_TRACKER_H_INCLUDED
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <diw/core/clock.h>
+#include <diw/core/input_stamp.h>
+
+namespace diw {
+
+struct latency_statistics
+{
+  std::string                 path;
+  std::size_t                 count;
+  double                      mean_ms;
+  double                      p50_ms;
+  double                      p95_ms;
+  double                      p99_ms;
+  double                      max_ms;
+
+  double                      bucket_ms;
+  std::vector<std::size_t>    histogram;  // last bucket collects everything above
+
+}; // struct latency_statistics
+
+// motion-to-photon latency per content path ("warped", "rendered", ...).
+// a path reports every present, but only the first present that reflects a
+// new input event counts, at present time minus input event time.
+class latency_tracker
+{
+public:
+  explicit latency_tracker(double bucket_ms = 2.0, std::size_t num_buckets = 50, std::size_t history = 4096);
+
+  void            presented(std::string const& path, input_stamp const& input, time_point const& present_time);
+
+  std::vector<latency_statistics> statistics() const;
+
+  void            write_report(std::ostream& os) const;
+
+private:
+  struct path_data {
+    std::uint64_t               last_sequence;
+    std::vector<float>          latencies_ms;
+    std::size_t                 next;
+    std::size_t                 count;
+    double                      max_ms;
+    std::vector<std::size_t>    histogram;
+  };
+
+  double                            _bucket_ms;
+  std::size_t                       _num_buckets;
+  std::size_t                       _history;
+
+  mutable std::mutex                _mutex;
+  std::map<std::string, path_data>  _paths;
+
+}; // class latency_tracker
+
+} // namespace diw
+
+#endif // DIW_PROFILING_LATENCY_TRACKER_H_INCLUDED
@@ -0,0 +1,44 @@
+#ifndef DIW_PROFILING_PROFILE_ZONE_H_INCLUDED
+#define DIW_PROFILING_PROFILE_ZONE_H_INCLUDED
+
+#include <diw/core/clock.h>
+#include <diw/profiling/gpu_timer.h>
+#include <diw/profiling/profiler.h>
+
+namespace diw {
+
+// scoped cpu zone, plus a gpu zone around the same commands if a timer of
+// the current context is given
+class profile_zone
+{
+public:
+  profile_zone(profiler& p, gpu_timer* gpu, char const* name)
+    : _profiler(p)
+    , _gpu(gpu)
+    , _gpu_zone(gpu ? gpu->begin(name) : gpu_timer::npos)
+    , _name(name)
+    , _begin(clock::now())
+  {}
+
+  ~profile_zone() {
+    _profiler.record(_name, _begin, clock::now());
+    if (_gpu) {
+      _gpu->end(_gpu_zone);
+    }
+  }
+
+  profile_zone(profile_zone const&) = delete;
+  profile_zone& operator=(profile_zone const&) = delete;
+
+private:
+  profiler&     _profiler;
+  gpu_timer*    _gpu;
+  std::size_t   _gpu_zone;
+  char const*   _name;
+  time_point    _begin;
+
+}; // class profile_zone
+
+} // namespace diw
+
+#endif // DIW_PROFILING_PROFILE_ZONE_H_INCLUDED
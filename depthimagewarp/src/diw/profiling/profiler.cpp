@@ -0,0 +1,220 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+#include <diw/core/json.h>
+#include <diw/core/statistics.h>
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+profiler::profiler(std::size_t history, std::size_t trace_capacity)
+  : _enabled(true)
+  , _history(std::max<std::size_t>(history, 1))
+  , _epoch(clock::now())
+  , _trace_capacity(trace_capacity)
+  , _trace_next(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void profiler::name_current_thread(std::string const& name)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _thread_names[thread_index()] = name;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned profiler::thread_index()
+{
+  auto t = _thread_ids.find(std::this_thread::get_id());
+  if (t != _thread_ids.end()) {
+    return t->second;
+  }
+
+  unsigned index = unsigned(_thread_names.size());
+  _thread_ids[std::this_thread::get_id()] = index;
+  _thread_names.push_back(std::string());
+  return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::string profiler::thread_name(unsigned index) const
+{
+  if (index < _thread_names.size() && !_thread_names[index].empty()) {
+    return _thread_names[index];
+  }
+  std::ostringstream s;
+  s << "thread " << index;
+  return s.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void profiler::record(char const* name, time_point const& begin, time_point const& end, bool gpu)
+{
+  if (!enabled()) {
+    return;
+  }
+
+  std::int64_t const begin_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - _epoch).count();
+  std::int64_t const end_ns   = std::chrono::duration_cast<std::chrono::nanoseconds>(end - _epoch).count();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  unsigned const thread = thread_index();
+
+  auto z = _zones.find(zone_key(name, thread, gpu));
+  if (z == _zones.end()) {
+    zone_history h;
+    h.durations_ms.reserve(_history);
+    h.next = 0;
+    h.count = 0;
+    z = _zones.insert(std::make_pair(zone_key(name, thread, gpu), h)).first;
+  }
+
+  zone_history& h = z->second;
+  float const ms = float(double(end_ns - begin_ns) * 1.0e-6);
+  if (h.durations_ms.size() < _history) {
+    h.durations_ms.push_back(ms);
+  }
+  else {
+    h.durations_ms[h.next] = ms;
+  }
+  h.next = (h.next + 1) % _history;
+  ++h.count;
+
+  if (_trace_capacity > 0) {
+    event e = { &std::get<0>(z->first), thread, gpu, begin_ns, end_ns };
+    if (_trace.size() < _trace_capacity) {
+      _trace.push_back(e);
+    }
+    else {
+      _trace[_trace_next] = e;
+    }
+    _trace_next = (_trace_next + 1) % _trace_capacity;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<zone_statistics> profiler::statistics() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  std::vector<zone_statistics> result;
+  result.reserve(_zones.size());
+
+  std::vector<float> sorted;
+  for (auto const& z : _zones) {
+    sorted = z.second.durations_ms;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (float d : sorted) {
+      sum += d;
+    }
+
+    zone_statistics s;
+    s.name    = std::get<0>(z.first);
+    s.thread  = thread_name(std::get<1>(z.first));
+    s.gpu     = std::get<2>(z.first);
+    s.count   = z.second.count;
+    s.mean_ms = sorted.empty() ? 0.0 : sum / double(sorted.size());
+    s.p50_ms  = percentile(sorted, 0.50);
+    s.p95_ms  = percentile(sorted, 0.95);
+    s.p99_ms  = percentile(sorted, 0.99);
+    s.max_ms  = sorted.empty() ? 0.0 : sorted.back();
+    result.push_back(s);
+  }
+
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void profiler::write_report(std::ostream& os) const
+{
+  std::vector<zone_statistics> stats = statistics();
+
+  os << std::left  << std::setw(16) << "thread"
+                   << std::setw(32) << "zone"
+     << std::right << std::setw(10) << "count"
+                   << std::setw(10) << "mean"
+                   << std::setw(10) << "p50"
+                   << std::setw(10) << "p95"
+                   << std::setw(10) << "p99"
+                   << std::setw(10) << "max" << " [ms]" << std::endl;
+
+  os << std::fixed << std::setprecision(3);
+  for (auto const& s : stats) {
+    os << std::left  << std::setw(16) << s.thread
+                     << std::setw(32) << (s.gpu ? s.name + " (gpu)" : s.name)
+       << std::right << std::setw(10) << s.count
+                     << std::setw(10) << s.mean_ms
+                     << std::setw(10) << s.p50_ms
+                     << std::setw(10) << s.p95_ms
+                     << std::setw(10) << s.p99_ms
+                     << std::setw(10) << s.max_ms << std::endl;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void profiler::write_chrome_trace(std::ostream& os) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // gpu zones of a thread go to their own track next to it
+  os << "{\"traceEvents\":[" << std::endl;
+
+  bool first = true;
+  for (unsigned t = 0; t < _thread_names.size(); ++t) {
+    for (unsigned gpu = 0; gpu < 2; ++gpu) {
+      os << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << (2 * t + gpu) << ",\"args\":{\"name\":";
+      write_json_string(os, gpu ? thread_name(t) + " (gpu)" : thread_name(t));
+      os << "}}";
+      first = false;
+    }
+  }
+
+  // oldest first
+  std::size_t const start = _trace.size() < _trace_capacity ? 0 : _trace_next;
+
+  os << std::fixed << std::setprecision(3);
+  for (std::size_t i = 0; i < _trace.size(); ++i) {
+    event const& e = _trace[(start + i) % _trace.size()];
+
+    os << (first ? "" : ",\n") << "{\"name\":";
+    write_json_string(os, *e.name);
+    os << ",\"cat\":\"" << (e.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1"
+       << ",\"tid\":" << (2 * e.thread + (e.gpu ? 1 : 0))
+       << ",\"ts\":" << double(e.begin_ns) * 1.0e-3
+       << ",\"dur\":" << double(e.end_ns - e.begin_ns) * 1.0e-3 << "}";
+    first = false;
+  }
+
+  os << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool profiler::write_chrome_trace(std::string const& filename) const
+{
+  std::ofstream file(filename.c_str());
+  if (!file) {
+    return false;
+  }
+  write_chrome_trace(file);
+  return bool(file);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void profiler::clear()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _trace.clear();
+  _trace_next = 0;
+  _zones.clear();
+}
+
+} // namespace diw
@@ -0,0 +1,95 @@
+#ifndef DIW_PROFILING_PROFILER_H_INCLUDED
+#define DIW_PROFILING_PROFILER_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <diw/core/clock.h>
+
+namespace diw {
+
+struct zone_statistics
+{
+  std::string   name;
+  std::string   thread;
+  bool          gpu;
+
+  std::size_t   count;    // zones recorded in total
+  double        mean_ms;  // the rest over the rolling history only
+  double        p50_ms;
+  double        p95_ms;
+  double        p99_ms;
+  double        max_ms;
+
+}; // struct zone_statistics
+
+// collects named time zones per thread, cpu zones measured on the host and
+// gpu zones from timestamp queries (see gpu_timer). keeps a rolling history
+// of durations per zone for percentiles and a bounded event log that can be
+// dumped as chrome trace json (chrome://tracing, perfetto).
+class profiler
+{
+public:
+  explicit profiler(std::size_t history = 512, std::size_t trace_capacity = 1u << 16);
+
+  void          enabled(bool e) { _enabled.store(e, std::memory_order_relaxed); }
+  bool          enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+  void          name_current_thread(std::string const& name);
+
+  // zone of the calling thread, gpu zones are already mapped to the cpu clock
+  void          record(char const* name, time_point const& begin, time_point const& end, bool gpu = false);
+
+  std::vector<zone_statistics>  statistics() const;
+
+  void          write_report(std::ostream& os) const;
+  void          write_chrome_trace(std::ostream& os) const;
+  bool          write_chrome_trace(std::string const& filename) const;
+
+  void          clear();
+
+private:
+  typedef std::tuple<std::string, unsigned, bool> zone_key;
+
+  struct zone_history {
+    std::vector<float>  durations_ms;
+    std::size_t         next;
+    std::size_t         count;
+  };
+
+  struct event {
+    std::string const*  name;
+    unsigned            thread;
+    bool                gpu;
+    std::int64_t        begin_ns;
+    std::int64_t        end_ns;
+  };
+
+  unsigned              thread_index();
+  std::string           thread_name(unsigned index) const;
+
+  std::atomic<bool>                     _enabled;
+  std::size_t                           _history;
+  time_point                            _epoch;
+
+  mutable std::mutex                    _mutex;
+  std::map<std::thread::id, unsigned>   _thread_ids;
+  std::vector<std::string>              _thread_names;
+  std::map<zone_key, zone_history>      _zones;
+
+  std::vector<event>                    _trace;
+  std::size_t                           _trace_capacity;
+  std::size_t                           _trace_next;
+
+}; // class profiler
+
+} // namespace diw
+
+#endif // DIW_PROFILING_PROFILER_H_INCLUDED
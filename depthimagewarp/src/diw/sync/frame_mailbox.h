@@ -0,0 +1,103 @@
+#ifndef DIW_SYNC_FRAME_MAILBOX_H_INCLUDED
+#define DIW_SYNC_FRAME_MAILBOX_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace diw {
+
+// lock-free triple buffer between exactly one producer and one consumer.
+// the producer fills back() and publishes it, the consumer acquires the
+// newest published slot into front(). neither side ever waits on the other,
+// frames the consumer did not pick up in time are overwritten.
+template <typename frame_type>
+class frame_mailbox
+{
+public:
+  static const unsigned slots = 3;
+
+  frame_mailbox()
+    : _back(0)
+    , _middle(1)
+    , _front(2)
+    , _first_published(false)
+  {}
+
+  frame_mailbox(frame_mailbox const&) = delete;
+  frame_mailbox& operator=(frame_mailbox const&) = delete;
+
+  // producer side
+  frame_type& back() { return _slots[_back]; }
+  unsigned    back_index() const { return _back; }
+
+  void publish() {
+    unsigned prev = _middle.exchange(_back | dirty_bit, std::memory_order_acq_rel);
+    _back = prev & index_mask;
+
+    // only the very first publish touches the mutex
+    if (!_first_published.load(std::memory_order_relaxed)) {
+      {
+        std::lock_guard<std::mutex> lock(_ready_mutex);
+        _first_published.store(true, std::memory_order_release);
+      }
+      _ready.notify_all();
+    }
+  }
+
+  // consumer side, true if the next acquire() changes front()
+  bool has_new() const {
+    return (_middle.load(std::memory_order_relaxed) & dirty_bit) != 0;
+  }
+
+  // consumer side, returns true if front() changed
+  bool acquire() {
+    if (!has_new()) {
+      return false;
+    }
+    unsigned prev = _middle.exchange(_front, std::memory_order_acq_rel);
+    _front = prev & index_mask;
+    return true;
+  }
+
+  frame_type const& front() const { return _slots[_front]; }
+  frame_type&       front() { return _slots[_front]; }
+  unsigned          front_index() const { return _front; }
+
+  // any slot, only while neither side runs
+  frame_type&       slot(unsigned i) { return _slots[i]; }
+
+  bool has_published() const { return _first_published.load(std::memory_order_acquire); }
+
+  // blocks until the producer published its first frame
+  void wait_for_first() {
+    std::unique_lock<std::mutex> lock(_ready_mutex);
+    _ready.wait(lock, [this] { return _first_published.load(std::memory_order_acquire); });
+  }
+
+  template <typename rep, typename period>
+  bool wait_for_first(std::chrono::duration<rep, period> const& timeout) {
+    std::unique_lock<std::mutex> lock(_ready_mutex);
+    return _ready.wait_for(lock, timeout, [this] { return _first_published.load(std::memory_order_acquire); });
+  }
+
+private:
+  static const unsigned index_mask = 0x3u;
+  static const unsigned dirty_bit  = 0x4u;
+
+  frame_type                _slots[slots];
+
+  unsigned                  _back;    // producer only
+  std::atomic<unsigned>     _middle;  // slot index | dirty_bit
+  unsigned                  _front;   // consumer only
+
+  std::atomic<bool>         _first_published;
+  std::mutex                _ready_mutex;
+  std::condition_variable   _ready;
+
+}; // class frame_mailbox
+
+} // namespace diw
+
+#endif // DIW_SYNC_FRAME_MAILBOX_H_INCLUDED
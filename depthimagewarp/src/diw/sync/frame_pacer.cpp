@@ -0,0 +1,156 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+
+#include <diw/core/statistics.h>
+
+namespace {
+
+// frames the cost prediction looks back on, and the percentile of them
+std::size_t const cost_history = 32;
+double const cost_percentile = 0.9;
+
+// sleeps overshoot, the last stretch before a target spins
+diw::duration const spin = std::chrono::microseconds(500);
+
+void wait_until(diw::time_point const& t)
+{
+  if (t - diw::clock::now() > spin) {
+    std::this_thread::sleep_until(t - spin);
+  }
+  while (diw::clock::now() < t) {
+    std::this_thread::yield();
+  }
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+frame_pacer::frame_pacer(duration const& period, bool virtual_vsync)
+  : _period(period)
+  , _margin(std::chrono::milliseconds(1))
+  , _virtual_vsync(virtual_vsync)
+  , _slices(1)
+  , _next(0)
+  , _frames(0)
+  , _missed(0)
+  , _lead_ms(0.0)
+  , _cost_ms(0.0)
+{
+  _costs_ms.reserve(cost_history);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+duration frame_pacer::predicted_cost() const
+{
+  if (_costs_ms.empty()) {
+    return _period / 2;
+  }
+
+  std::vector<float> sorted(_costs_ms);
+  std::size_t const rank = percentile_rank(sorted.size(), cost_percentile);
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+  return std::chrono::duration_cast<duration>(std::chrono::duration<float, std::milli>(sorted[rank]));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+time_point frame_pacer::next_deadline(time_point const& after) const
+{
+  if (after <= _phase) {
+    return _phase;
+  }
+  duration::rep const periods = (after - _phase) / _period + 1;
+  return _phase + periods * _period;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_pacer::wait_for_start()
+{
+  time_point const now = clock::now();
+  if (_phase == time_point()) {
+    _phase = now + _period;
+  }
+
+  // the first deadline the predicted work still makes
+  duration const lead = predicted_cost() + _margin;
+  _deadline = next_deadline(now + lead - duration(1));
+  _work_deadline = _deadline;
+
+  wait_until(_deadline - lead);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_pacer::wait_for_slice(unsigned i)
+{
+  if (i == 0) {
+    wait_for_start();
+    return;
+  }
+
+  _work_deadline = slice_deadline(i);
+  wait_until(_work_deadline - predicted_cost() - _margin);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_pacer::begin_work()
+{
+  _work_begin = clock::now();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_pacer::end_work()
+{
+  time_point const now = clock::now();
+  float const ms = float(to_milliseconds(now - _work_begin));
+
+  if (_costs_ms.size() < cost_history) {
+    _costs_ms.push_back(ms);
+  }
+  else {
+    _costs_ms[_next] = ms;
+  }
+  _next = (_next + 1) % cost_history;
+
+  ++_frames;
+  _missed += now > _work_deadline ? 1 : 0;
+  _lead_ms += to_milliseconds(_work_deadline - _work_begin);
+  _cost_ms += ms;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_pacer::wait_for_deadline()
+{
+  if (_virtual_vsync) {
+    wait_until(_deadline);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_pacer::presented(time_point const& t)
+{
+  // a blocking swap returns right after the vblank it waited for, that is
+  // the phase. a virtual vsync keeps the one it started with.
+  if (!_virtual_vsync && t != time_point()) {
+    _phase = t;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void frame_pacer::write_report(std::ostream& os) const
+{
+  double const frames = double(std::max<std::uint64_t>(_frames, 1));
+
+  os << std::fixed << std::setprecision(3)
+     << (_virtual_vsync ? "virtual vsync " : "vsync ") << to_milliseconds(_period) << " ms: "
+     << _frames << (_slices > 1 ? " slices, " : " frames, ") << _missed << " missed deadlines" << std::endl
+     << "  start before deadline mean " << _lead_ms / frames
+     << " work mean " << _cost_ms / frames
+     << " predicted " << to_milliseconds(predicted_cost()) << " [ms]" << std::endl;
+}
+
+} // namespace diw
@@ -0,0 +1,94 @@
+#ifndef DIW_SYNC_FRAME_PACER_H_INCLUDED
+#define DIW_SYNC_FRAME_PACER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include <diw/core/clock.h>
+
+namespace diw {
+
+// starts the work of a frame just in time for its display deadline instead
+// of right after the previous present. the work is predicted from the last
+// frames, a high percentile of their cost plus a margin:
+//
+//   wait_for_start()   sleeps until deadline - predicted cost - margin
+//   begin_work()       the frame samples its pose from here on
+//   end_work()         measures the cost
+//   wait_for_deadline  virtual vsync only, holds the present until the
+//                      deadline like a blocking swap would
+//   presented(t)       locks the deadlines onto the real vsync phase
+//
+// with a real vsync the swap blocks and the present times say where the
+// deadlines are, a virtual vsync just counts periods from the first frame.
+// a frame that misses its deadline goes to the next one.
+//
+// beam racing splits a frame in slices from the top, each one is a unit of
+// work of its own, due when its first row scans out. scan out is assumed
+// to take the whole period.
+class frame_pacer
+{
+public:
+  explicit frame_pacer(duration const& period = std::chrono::microseconds(16667),
+                       bool            virtual_vsync = false);
+
+  void          period(duration const& p) { _period = p; }
+  duration      period() const { return _period; }
+
+  // slack between the predicted end of the work and the deadline
+  void          margin(duration const& m) { _margin = m; }
+  duration      margin() const { return _margin; }
+
+  bool          virtual_vsync() const { return _virtual_vsync; }
+
+  void          slices(unsigned n) { _slices = n > 0 ? n : 1; }
+  unsigned      slices() const { return _slices; }
+
+  void          wait_for_start();
+  // slice 0 picks the deadline of the frame like wait_for_start()
+  void          wait_for_slice(unsigned i);
+  void          begin_work();
+  void          end_work();
+  void          wait_for_deadline();
+  void          presented(time_point const& t);
+
+  time_point    deadline() const { return _deadline; }
+  time_point    slice_deadline(unsigned i) const { return _deadline + i * _period / _slices; }
+  duration      predicted_cost() const;
+
+  // frames or slices worked on and how many of them missed their deadline
+  std::uint64_t frames() const { return _frames; }
+  std::uint64_t missed() const { return _missed; }
+
+  // frames, missed deadlines and how long before its deadline a frame
+  // started on average, the age of its pose at the deadline
+  void          write_report(std::ostream& os) const;
+
+private:
+  time_point    next_deadline(time_point const& after) const;
+
+  duration                  _period;
+  duration                  _margin;
+  bool                      _virtual_vsync;
+  unsigned                  _slices;
+
+  time_point                _phase;         // some deadline, the others are periods away
+  time_point                _deadline;      // of the frame in progress
+  time_point                _work_deadline; // of the frame or slice in progress
+  time_point                _work_begin;
+
+  std::vector<float>        _costs_ms;      // ring of the last frames
+  std::size_t               _next;
+
+  std::uint64_t             _frames;
+  std::uint64_t             _missed;
+  double                    _lead_ms;       // sum of deadline - start
+  double                    _cost_ms;       // sum of work
+
+}; // class frame_pacer
+
+} // namespace diw
+
+#endif // DIW_SYNC_FRAME_PACER_H_INCLUDED
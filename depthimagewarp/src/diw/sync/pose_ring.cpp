@@ -0,0 +1,107 @@
+#include "pose_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+std::int64_t to_nanoseconds(diw::time_point const& t)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+diw::time_point from_nanoseconds(std::int64_t ns)
+{
+  return diw::time_point(std::chrono::duration_cast<diw::duration>(std::chrono::nanoseconds(ns)));
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+pose_ring::pose_ring(std::size_t capacity)
+  : _capacity(std::max<std::size_t>(capacity, 2))
+  , _slots(new slot[_capacity])
+  , _written(0)
+{
+  for (std::size_t i = 0; i < _capacity; ++i) {
+    _slots[i].version.store(0, std::memory_order_relaxed);
+    for (std::size_t w = 0; w < words; ++w) {
+      _slots[i].data[w].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void pose_ring::push(time_point const& t, scm::math::mat4f const& view, input_stamp const& input)
+{
+  std::uint64_t buffer[words] = {};
+  packed_pose   p;
+  p.time_ns = to_nanoseconds(t);
+  p.input_ns = to_nanoseconds(input.time);
+  p.input_sequence = input.sequence;
+  std::copy(view.data_array, view.data_array + 16, p.view);
+  std::memcpy(buffer, &p, sizeof(p));
+
+  std::uint64_t const i = _written.load(std::memory_order_relaxed);
+  slot&               s = _slots[i % _capacity];
+
+  // odd before any word changes, even after all of them did
+  s.version.store(2 * i + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (std::size_t w = 0; w < words; ++w) {
+    s.data[w].store(buffer[w], std::memory_order_relaxed);
+  }
+  s.version.store(2 * i + 2, std::memory_order_release);
+
+  _written.store(i + 1, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool pose_ring::latch(pose_sample& p) const
+{
+  for (;;) {
+    std::uint64_t const n = written();
+    if (n == 0) {
+      return false;
+    }
+    if (read(n - 1, p)) {
+      return true;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool pose_ring::read(std::uint64_t i, pose_sample& p) const
+{
+  slot const&   s = _slots[i % _capacity];
+  std::uint64_t buffer[words];
+
+  for (;;) {
+    std::uint64_t const before = s.version.load(std::memory_order_acquire);
+    if (before != 2 * i + 2) {
+      // not written yet, being overwritten or already overwritten
+      return false;
+    }
+
+    for (std::size_t w = 0; w < words; ++w) {
+      buffer[w] = s.data[w].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (s.version.load(std::memory_order_relaxed) == before) {
+      break;
+    }
+  }
+
+  packed_pose packed;
+  std::memcpy(&packed, buffer, sizeof(packed));
+
+  p.time = from_nanoseconds(packed.time_ns);
+  p.input = input_stamp(packed.input_sequence, from_nanoseconds(packed.input_ns));
+  std::copy(packed.view, packed.view + 16, p.view.data_array);
+  return true;
+}
+
+} // namespace diw
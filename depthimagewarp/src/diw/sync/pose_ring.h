@@ -0,0 +1,81 @@
+#ifndef DIW_SYNC_POSE_RING_H_INCLUDED
+#define DIW_SYNC_POSE_RING_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <scm/core/math.h>
+
+#include <diw/core/clock.h>
+#include <diw/core/input_stamp.h>
+
+namespace diw {
+
+// a camera pose and the newest input it reflects
+struct pose_sample
+{
+  time_point        time;
+  scm::math::mat4f  view;
+  input_stamp       input;
+
+}; // struct pose_sample
+
+// lock-free history of timestamped poses from exactly one writer to any
+// number of readers. every slot is a sequence lock: the writer makes its
+// version odd, writes and makes it even again, a reader copies the slot and
+// keeps the copy only if the version was the same even one before and
+// after. readers never block the writer, a reader the writer laps retries
+// on a newer slot.
+//
+//   push(...)     writer side, one pose per input sample
+//   latch(p)      the newest pose right now, for the last moment before a
+//                 stage uses it
+//   read(i, p)    pose i of the history, for consumers that want every
+//                 sample, false once the writer overwrote it
+class pose_ring
+{
+public:
+  explicit pose_ring(std::size_t capacity = 1024);
+
+  pose_ring(pose_ring const&) = delete;
+  pose_ring& operator=(pose_ring const&) = delete;
+
+  std::size_t   capacity() const { return _capacity; }
+
+  // poses pushed so far, pose i is readable for written() - capacity <= i
+  std::uint64_t written() const { return _written.load(std::memory_order_acquire); }
+
+  void          push(time_point const& t, scm::math::mat4f const& view, input_stamp const& input);
+
+  // false before the first push
+  bool          latch(pose_sample& p) const;
+  bool          read(std::uint64_t i, pose_sample& p) const;
+
+private:
+  // the pose as plain words, so that torn copies are atomic loads that fail
+  // the version check instead of data races
+  struct packed_pose {
+    std::int64_t    time_ns;
+    std::int64_t    input_ns;
+    std::uint64_t   input_sequence;
+    float           view[16];
+  };
+
+  static std::size_t const words = (sizeof(packed_pose) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  struct slot {
+    std::atomic<std::uint64_t>  version;   // 2 i + 1 while pose i is written, 2 i + 2 after
+    std::atomic<std::uint64_t>  data[words];
+  };
+
+  std::size_t                 _capacity;
+  std::unique_ptr<slot[]>     _slots;
+  std::atomic<std::uint64_t>  _written;
+
+}; // class pose_ring
+
+} // namespace diw
+
+#endif // DIW_SYNC_POSE_RING_H_INCLUDED
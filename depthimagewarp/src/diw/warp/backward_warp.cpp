@@ -0,0 +1,359 @@
+#include "backward_warp.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#include <diw/warp/reprojection.h>
+
+namespace {
+
+// one percent of eye depth
+float const default_thickness = 0.01f;
+
+// march steps per target pixel before giving up, only ever reached by
+// degenerate segments
+unsigned const max_steps = 4096;
+
+// clips t in [t0, t1] to a + t * b >= 0
+inline bool clip(float a, float b, float& t0, float& t1)
+{
+  if (b == 0.0f) {
+    return a >= 0.0f;
+  }
+
+  float const t = -a / b;
+  if (b > 0.0f) {
+    t0 = std::max(t0, t);
+  }
+  else {
+    t1 = std::min(t1, t);
+  }
+  return t0 < t1;
+}
+
+// the view ray of one target pixel as a segment in reference window space
+struct epipolar_segment
+{
+  float x0, y0, z0;
+  float dx, dy, dz;
+};
+
+// h(t) = a + t * b are the homogeneous reference window coordinates of the
+// target pixel at target window depth t. the part of t in [0, 1] that lies
+// in the reference frustum becomes the segment.
+inline bool segment(float const* a, float const* b, float rw, float rh, epipolar_segment& s)
+{
+  float t0 = 0.0f;
+  float t1 = 1.0f;
+
+  // w > 0 with some margin, x in [0, rw], y in [0, rh], z in [0, w]
+  float const w_min = 1e-6f;
+  if (   !clip(a[3] - w_min, b[3], t0, t1)
+      || !clip(a[0], b[0], t0, t1)
+      || !clip(rw * a[3] - a[0], rw * b[3] - b[0], t0, t1)
+      || !clip(a[1], b[1], t0, t1)
+      || !clip(rh * a[3] - a[1], rh * b[3] - b[1], t0, t1)
+      || !clip(a[2], b[2], t0, t1)
+      || !clip(a[3] - a[2], b[3] - b[2], t0, t1)) {
+    return false;
+  }
+
+  float p0[4], p1[4];
+  for (int i = 0; i < 4; ++i) {
+    p0[i] = a[i] + t0 * b[i];
+    p1[i] = a[i] + t1 * b[i];
+  }
+
+  s.x0 = p0[0] / p0[3];
+  s.y0 = p0[1] / p0[3];
+  s.z0 = p0[2] / p0[3];
+  s.dx = p1[0] / p1[3] - s.x0;
+  s.dy = p1[1] / p1[3] - s.y0;
+  s.dz = p1[2] / p1[3] - s.z0;
+  return true;
+}
+
+// parameter where the segment leaves the box [x0, x1) x [y0, y1), inv_dx
+// and inv_dy are the reciprocal direction, infinite along an axis
+inline float exit_parameter(epipolar_segment const& s, float inv_dx, float inv_dy,
+                            float x0, float x1, float y0, float y1)
+{
+  float const ux = ((s.dx > 0.0f ? x1 : x0) - s.x0) * inv_dx;
+  float const uy = ((s.dy > 0.0f ? y1 : y0) - s.y0) * inv_dy;
+  return std::min(s.dx != 0.0f ? ux : std::numeric_limits<float>::max(),
+                  s.dy != 0.0f ? uy : std::numeric_limits<float>::max());
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+backward_warp::backward_warp(unsigned num_threads)
+  : _workers(num_threads)
+  , _pyramids(1)
+  , _pyramid_clock(0)
+  , _last_pyramid(0)
+  , _clear_color(default_clear_color)
+  , _thickness(default_thickness)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void backward_warp::pyramid_cache(std::size_t count)
+{
+  _pyramids.resize(std::max<std::size_t>(count, 1));
+  _last_pyramid = std::min(_last_pyramid, _pyramids.size() - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void backward_warp::warp(reference_frame const&    ref,
+                         scm::math::mat4f const&   projection,
+                         scm::math::mat4f const&   view,
+                         scm::math::vec2ui const&  target_size,
+                         warp_target&              target)
+{
+  if (target.size != target_size) {
+    target.resize(target_size);
+  }
+
+  if (ref.empty()) {
+    unsigned const tw = target_size.x;
+    unsigned const th = target_size.y;
+    _workers.parallel_for(th, [&](std::size_t begin, std::size_t end) {
+      std::fill(target.color.begin() + begin * tw, target.color.begin() + end * tw, _clear_color);
+      std::fill(target.depth.begin() + begin * tw, target.depth.begin() + end * tw, 1.0f);
+    }, std::max<std::size_t>(1, th / (_workers.size() * 8)));
+    return;
+  }
+
+  march(ref, pyramid_of(ref), projection, view, target_size, 0, target_size.y, target, false);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void backward_warp::warp_rows(reference_frame const&    ref,
+                              scm::math::mat4f const&   projection,
+                              scm::math::mat4f const&   view,
+                              scm::math::vec2ui const&  target_size,
+                              unsigned                  row_begin,
+                              unsigned                  row_end,
+                              warp_target&              target)
+{
+  if (target.size != target_size) {
+    target.resize(target_size);
+  }
+
+  row_end = std::min(row_end, target_size.y);
+  if (row_begin >= row_end) {
+    return;
+  }
+
+  if (ref.empty()) {
+    unsigned const tw = target_size.x;
+    std::fill(target.color.begin() + std::size_t(row_begin) * tw, target.color.begin() + std::size_t(row_end) * tw, _clear_color);
+    std::fill(target.depth.begin() + std::size_t(row_begin) * tw, target.depth.begin() + std::size_t(row_end) * tw, 1.0f);
+    return;
+  }
+
+  march(ref, pyramid_of(ref), projection, view, target_size, row_begin, row_end, target, false);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t backward_warp::fill_holes(reference_frame const&    ref,
+                                      scm::math::mat4f const&   projection,
+                                      scm::math::mat4f const&   view,
+                                      warp_target&              target,
+                                      unsigned                  row_begin,
+                                      unsigned                  row_end)
+{
+  row_end = std::min(row_end, target.size.y);
+  if (ref.empty() || target.size.x == 0 || row_begin >= row_end) {
+    return 0;
+  }
+
+  return march(ref, pyramid_of(ref), projection, view, target.size, row_begin, row_end, target, true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+depth_pyramid const& backward_warp::pyramid_of(reference_frame const& ref)
+{
+  ++_pyramid_clock;
+
+  // frame id 0 is a frame nobody numbered, never trust the cache with it
+  if (ref.frame_id != 0) {
+    for (std::size_t i = 0; i < _pyramids.size(); ++i) {
+      cached_pyramid& c = _pyramids[i];
+      if (c.frame == ref.frame_id && c.size == ref.size) {
+        c.used = _pyramid_clock;
+        _last_pyramid = i;
+        return c.pyramid;
+      }
+    }
+  }
+
+  // least recently used goes
+  std::size_t victim = 0;
+  for (std::size_t i = 1; i < _pyramids.size(); ++i) {
+    if (_pyramids[i].used < _pyramids[victim].used) {
+      victim = i;
+    }
+  }
+
+  cached_pyramid& c = _pyramids[victim];
+  c.pyramid.build(ref.depth_data(), ref.size, _workers);
+  c.frame = ref.frame_id;
+  c.size  = ref.size;
+  c.used  = _pyramid_clock;
+  _last_pyramid = victim;
+  return c.pyramid;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t backward_warp::march(reference_frame const&    ref,
+                                 depth_pyramid const&      pyramid,
+                                 scm::math::mat4f const&   projection,
+                                 scm::math::mat4f const&   view,
+                                 scm::math::vec2ui const&  target_size,
+                                 unsigned                  row_begin,
+                                 unsigned                  row_end,
+                                 warp_target&              target,
+                                 bool                      holes_only)
+{
+  using namespace scm::math;
+
+  // target window to reference window for the march, and back for the
+  // depth of what it hit
+  mat4f const to_ref = reprojection_matrix(projection, view, target_size,
+                                           ref.projection_matrix, ref.view_matrix, ref.size);
+  mat4f const to_target = reprojection_matrix(ref.projection_matrix, ref.view_matrix, ref.size,
+                                              projection, view, target_size);
+  float const* m = to_ref.data_array;
+  float const* f = to_target.data_array;
+
+  unsigned const tw = target_size.x;
+  unsigned const rw = ref.size.x;
+  unsigned const rh = ref.size.y;
+  unsigned const top = pyramid.levels() - 1;
+
+  float const thickness = _thickness;
+
+  std::atomic<std::size_t> filled(0);
+
+  // tiles of the rows only, offset by row_begin
+  _scheduler.tile_image(scm::math::vec2ui(tw, row_end - row_begin));
+  _scheduler.run(_workers, [&](tile_scheduler::tile const& t) {
+    std::size_t tile_filled = 0;
+
+    for (unsigned y = row_begin + t.origin.y; y < row_begin + t.origin.y + t.size.y; ++y) {
+      float const fy = float(y) + 0.5f;
+
+      for (unsigned x = t.origin.x; x < t.origin.x + t.size.x; ++x) {
+        std::size_t const out = std::size_t(y) * tw + x;
+        if (holes_only) {
+          if (target.depth[out] < 1.0f) {
+            continue;
+          }
+        }
+        else {
+          target.color[out] = _clear_color;
+          target.depth[out] = 1.0f;
+        }
+
+        float const fx = float(x) + 0.5f;
+
+        float const a[4] = { m[0] * fx + m[4] * fy + m[12],
+                             m[1] * fx + m[5] * fy + m[13],
+                             m[2] * fx + m[6] * fy + m[14],
+                             m[3] * fx + m[7] * fy + m[15] };
+        float const b[4] = { m[8], m[9], m[10], m[11] };
+
+        epipolar_segment s;
+        if (!segment(a, b, float(rw), float(rh), s)) {
+          continue;
+        }
+
+        // the ray changes this much depth per reference pixel, a crossing
+        // between two pixel depths is at most that far from either
+        float const length = std::max(std::abs(s.dx), std::abs(s.dy));
+        float const step_tolerance = length > 1.0f ? std::abs(s.dz) / length : std::abs(s.dz);
+
+        // nudges the march over cell borders, in reference pixels
+        float const nudge = length > 1e-3f ? 1e-3f / length : 1.0f;
+
+        float const inv_dx = s.dx != 0.0f ? 1.0f / s.dx : 0.0f;
+        float const inv_dy = s.dy != 0.0f ? 1.0f / s.dy : 0.0f;
+
+        // start at cells about as large as the whole segment
+        unsigned level = 0;
+        while (level < top && float(1u << (level + 1)) <= length) {
+          ++level;
+        }
+
+        float    u = 0.0f;
+        bool     hit = false;
+        unsigned hx = 0;
+        unsigned hy = 0;
+        float    hd = 1.0f;
+
+        for (unsigned step = 0; step < max_steps && u <= 1.0f; ++step) {
+          unsigned const ix = std::min(unsigned(std::max(s.x0 + u * s.dx, 0.0f)), rw - 1);
+          unsigned const iy = std::min(unsigned(std::max(s.y0 + u * s.dy, 0.0f)), rh - 1);
+
+          unsigned const cx = ix >> level;
+          unsigned const cy = iy >> level;
+          depth_pyramid::bounds const& c = pyramid.cell(level, cx, cy);
+
+          float const u_exit = std::min(1.0f, exit_parameter(s, inv_dx, inv_dy,
+                                                             float(cx << level), float((cx + 1) << level),
+                                                             float(cy << level), float((cy + 1) << level)));
+
+          float const za = s.z0 + u * s.dz;
+          float const zb = s.z0 + u_exit * s.dz;
+
+          // window depth 1 - d is roughly proportional to near / eye depth,
+          // the nearest surface of the cell has the widest tolerance
+          float const tolerance = step_tolerance + thickness * std::max(0.0f, 1.0f - c.min);
+
+          if (   std::max(za, zb) + tolerance < c.min
+              || std::min(za, zb) - tolerance > c.max) {
+            u = u_exit + nudge;
+            level = std::min(level + 1, top);
+            continue;
+          }
+
+          if (level > 0) {
+            --level;
+            continue;
+          }
+
+          hit = true;
+          hx = ix;
+          hy = iy;
+          hd = c.min;
+          break;
+        }
+
+        if (!hit) {
+          continue;
+        }
+
+        float const px = float(hx) + 0.5f;
+        float const py = float(hy) + 0.5f;
+        float const tz = f[2] * px + f[6] * py + f[10] * hd + f[14];
+        float const tw_ = f[3] * px + f[7] * py + f[11] * hd + f[15];
+
+        target.color[out] = ref.color_data()[std::size_t(hy) * rw + hx];
+        target.depth[out] = tw_ > 0.0f ? std::min(std::max(tz / tw_, 0.0f), std::nextafter(1.0f, 0.0f)) : 1.0f;
+        tile_filled += target.depth[out] < 1.0f ? 1 : 0;
+      }
+    }
+
+    filled.fetch_add(tile_filled, std::memory_order_relaxed);
+  });
+
+  return filled.load();
+}
+
+} // namespace diw
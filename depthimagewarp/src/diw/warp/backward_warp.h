@@ -0,0 +1,122 @@
+#ifndef DIW_WARP_BACKWARD_WARP_H_INCLUDED
+#define DIW_WARP_BACKWARD_WARP_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <scm/core/math.h>
+
+#include <diw/core/reference_frame.h>
+#include <diw/core/tile_scheduler.h>
+#include <diw/core/worker_pool.h>
+#include <diw/warp/depth_pyramid.h>
+#include <diw/warp/warp_target.h>
+
+namespace diw {
+
+// inverse depth image warp. the view ray of every target pixel projects to
+// a segment of its epipolar line in the reference image, along which the
+// window depth of the ray changes linearly. the segment is marched from
+// near to far for the first reference pixel whose depth the ray crosses.
+// a min/max depth pyramid of the reference lets the march step over whole
+// cells the ray passes in front of or behind, so the cost follows the
+// pyramid depth rather than the segment length. every target pixel gets
+// exactly one answer, there are no cracks between splats. march lengths
+// vary wildly across the target, target tiles are balanced by the
+// tile_scheduler.
+//
+// a ray counts as crossing a pixel when its depth range over the pixel
+// comes within the surface thickness of the pixel depth. thickness is
+// relative to eye depth, it keeps sloped surfaces closed where the ray
+// steps over the crossing between two pixel depths.
+class backward_warp
+{
+public:
+  explicit backward_warp(unsigned num_threads = std::thread::hardware_concurrency());
+
+  void          clear_color(std::uint32_t c) { _clear_color = c; }
+  std::uint32_t clear_color() const { return _clear_color; }
+
+  void          thickness(float t) { _thickness = t; }
+  float         thickness() const { return _thickness; }
+
+  unsigned      num_threads() const { return _workers.size(); }
+
+  // pyramids kept for the most recently used frame ids, one by default.
+  // warping several references alternately wants one per reference.
+  void          pyramid_cache(std::size_t count);
+  std::size_t   pyramid_cache() const { return _pyramids.size(); }
+
+  // reprojects ref into the camera (projection, view) at the resolution of
+  // target_size. target is resized if needed. the pyramid of ref is kept
+  // for the next call with the same frame id.
+  void warp(reference_frame const&    ref,
+            scm::math::mat4f const&   projection,
+            scm::math::mat4f const&   view,
+            scm::math::vec2ui const&  target_size,
+            warp_target&              target);
+
+  // warps rows [row_begin, row_end) of target only, the other rows keep
+  // what they have. lets slices of one frame use different cameras.
+  void warp_rows(reference_frame const&    ref,
+                 scm::math::mat4f const&   projection,
+                 scm::math::mat4f const&   view,
+                 scm::math::vec2ui const&  target_size,
+                 unsigned                  row_begin,
+                 unsigned                  row_end,
+                 warp_target&              target);
+
+  // marches only the holes of target, which is already warped to (projection,
+  // view) from some other reference, optionally in a range of rows. returns
+  // the number of holes ref filled, the cost follows the hole area, not the
+  // target size.
+  std::size_t fill_holes(reference_frame const&    ref,
+                         scm::math::mat4f const&   projection,
+                         scm::math::mat4f const&   view,
+                         warp_target&              target,
+                         unsigned                  row_begin = 0,
+                         unsigned                  row_end = ~0u);
+
+  // pyramid of the last reference warped
+  depth_pyramid const&  pyramid() const { return _pyramids[_last_pyramid].pyramid; }
+  tile_scheduler const& scheduler() const { return _scheduler; }
+
+private:
+  struct cached_pyramid {
+    cached_pyramid() : frame(0), size(0u, 0u), used(0) {}
+
+    depth_pyramid       pyramid;
+    std::uint64_t       frame;
+    scm::math::vec2ui   size;
+    std::uint64_t       used;
+  };
+
+  depth_pyramid const&  pyramid_of(reference_frame const& ref);
+
+  std::size_t march(reference_frame const&    ref,
+                    depth_pyramid const&      pyramid,
+                    scm::math::mat4f const&   projection,
+                    scm::math::mat4f const&   view,
+                    scm::math::vec2ui const&  target_size,
+                    unsigned                  row_begin,
+                    unsigned                  row_end,
+                    warp_target&              target,
+                    bool                      holes_only);
+
+  worker_pool                   _workers;
+  tile_scheduler                _scheduler;
+
+  std::vector<cached_pyramid>   _pyramids;
+  std::uint64_t                 _pyramid_clock;
+  std::size_t                   _last_pyramid;
+
+  std::uint32_t       _clear_color;
+  float               _thickness;
+
+}; // class backward_warp
+
+} // namespace diw
+
+#endif // DIW_WARP_BACKWARD_WARP_H_INCLUDED
@@ -0,0 +1,91 @@
+#include "depth_pyramid.h"
+
+#include <algorithm>
+
+#include <diw/core/worker_pool.h>
+
+namespace {
+
+float const empty_depth = 2.0f;
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+depth_pyramid::depth_pyramid()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void depth_pyramid::build(float const* depth, scm::math::vec2ui const& size, worker_pool& workers)
+{
+  using scm::math::vec2ui;
+
+  // level sizes down to a single cell, storage is kept across builds
+  std::size_t count = 0;
+  for (vec2ui s = size; ; s = vec2ui((s.x + 1) / 2, (s.y + 1) / 2)) {
+    if (count == _sizes.size()) {
+      _sizes.push_back(s);
+      _levels.emplace_back();
+    }
+    _sizes[count] = s;
+    _levels[count].resize(std::size_t(s.x) * s.y);
+    ++count;
+
+    if (s.x <= 1 && s.y <= 1) {
+      break;
+    }
+  }
+  _sizes.resize(count);
+  _levels.resize(count);
+
+  std::size_t const grain = std::max<std::size_t>(1, size.y / (workers.size() * 8));
+
+  workers.parallel_for(size.y, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin * size.x; i < end * size.x; ++i) {
+      float const d = depth[i] < 1.0f ? depth[i] : empty_depth;
+      _levels[0][i].min = d;
+      _levels[0][i].max = d;
+    }
+  }, grain);
+
+  for (std::size_t l = 1; l < count; ++l) {
+    vec2ui const src_size = _sizes[l - 1];
+    vec2ui const dst_size = _sizes[l];
+    bounds const* src = _levels[l - 1].data();
+    bounds*       dst = _levels[l].data();
+
+    workers.parallel_for(dst_size.y, [&](std::size_t begin, std::size_t end) {
+      for (unsigned y = unsigned(begin); y < unsigned(end); ++y) {
+        unsigned const y0 = 2 * y;
+        unsigned const y1 = std::min(y0 + 1, src_size.y - 1);
+
+        for (unsigned x = 0; x < dst_size.x; ++x) {
+          unsigned const x0 = 2 * x;
+          unsigned const x1 = std::min(x0 + 1, src_size.x - 1);
+
+          bounds const& a = src[std::size_t(y0) * src_size.x + x0];
+          bounds const& b = src[std::size_t(y0) * src_size.x + x1];
+          bounds const& c = src[std::size_t(y1) * src_size.x + x0];
+          bounds const& d = src[std::size_t(y1) * src_size.x + x1];
+
+          bounds& o = dst[std::size_t(y) * dst_size.x + x];
+          o.min = std::min(std::min(a.min, b.min), std::min(c.min, d.min));
+
+          // empty cells must not widen the range of the others
+          float m = -1.0f;
+          bounds const* cells[4] = { &a, &b, &c, &d };
+          for (bounds const* s : cells) {
+            if (s->min < empty_depth) {
+              m = std::max(m, s->max);
+            }
+          }
+          o.max = m < 0.0f ? empty_depth : m;
+        }
+      }
+    }, std::max<std::size_t>(1, dst_size.y / (workers.size() * 8)));
+  }
+}
+
+} // namespace diw
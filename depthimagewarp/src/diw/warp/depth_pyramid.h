@@ -0,0 +1,48 @@
+#ifndef DIW_WARP_DEPTH_PYRAMID_H_INCLUDED
+#define DIW_WARP_DEPTH_PYRAMID_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include <scm/core/math.h>
+
+namespace diw {
+
+class worker_pool;
+
+// conservative depth bounds of a depth image, the depth counterpart of a
+// color mip chain. level 0 is the image itself, every cell of level l + 1
+// holds the min and max of the up to 2x2 cells of level l below it. odd
+// sizes round up, the last row or column then covers a single cell.
+//
+// background (depth 1.0) is no surface and left out of the bounds, a cell
+// with nothing but background gets the empty range [2, 2], which no depth
+// inside the view frustum reaches.
+class depth_pyramid
+{
+public:
+  struct bounds {
+    float min;
+    float max;
+  };
+
+  depth_pyramid();
+
+  void                build(float const* depth, scm::math::vec2ui const& size, worker_pool& workers);
+
+  unsigned            levels() const { return unsigned(_levels.size()); }
+  scm::math::vec2ui   size(unsigned level) const { return _sizes[level]; }
+
+  bounds const&       cell(unsigned level, unsigned x, unsigned y) const {
+    return _levels[level][std::size_t(y) * _sizes[level].x + x];
+  }
+
+private:
+  std::vector<scm::math::vec2ui>      _sizes;
+  std::vector<std::vector<bounds>>    _levels;
+
+}; // class depth_pyramid
+
+} // namespace diw
+
+#endif // DIW_WARP_DEPTH_PYRAMID_H_INCLUDED
@@ -0,0 +1,116 @@
+#include "forward_warp.h"
+
+#include <algorithm>
+
+#include <diw/warp/reprojection.h>
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+forward_warp::forward_warp(unsigned num_threads)
+  : _workers(num_threads)
+  , _simd(supported_simd_level())
+  , _splat_row(splat_row_kernel(_simd))
+  , _splat_capacity(0)
+  , _clear_color(default_clear_color)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void forward_warp::simd(simd_level level)
+{
+  _simd = std::min(level, supported_simd_level());
+  _splat_row = splat_row_kernel(_simd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void forward_warp::reserve_splats(std::size_t count)
+{
+  if (count > _splat_capacity) {
+    _splats.reset(new std::atomic<std::uint64_t>[count]);
+    _splat_capacity = count;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void forward_warp::warp(reference_frame const&    ref,
+                        scm::math::mat4f const&   projection,
+                        scm::math::mat4f const&   view,
+                        scm::math::vec2ui const&  target_size,
+                        warp_target&              target)
+{
+  using namespace scm::math;
+
+  if (target.size != target_size) {
+    target.resize(target_size);
+  }
+  reserve_splats(target.color.size());
+
+  unsigned const tw = target_size.x;
+  unsigned const th = target_size.y;
+  std::uint64_t const cleared = pack_depth_color(depth_to_bits(1.0f), _clear_color);
+
+  std::atomic<std::uint64_t>* splats = _splats.get();
+  std::uint32_t* target_color = target.color.data();
+  float*         target_depth = target.depth.data();
+
+  std::size_t const target_grain = std::max<std::size_t>(1, th / (_workers.size() * 8));
+
+  _workers.parallel_for(th, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin * tw; i < end * tw; ++i) {
+      splats[i].store(cleared, std::memory_order_relaxed);
+    }
+  }, target_grain);
+
+  if (!ref.empty()) {
+    mat4f const reproj = reprojection_matrix(ref.projection_matrix, ref.view_matrix, ref.size,
+                                             projection, view, target_size);
+
+    splat_row row;
+    row.m             = reproj.data_array;
+    row.target_width  = tw;
+    row.target_height = th;
+
+    std::size_t const rw = ref.size.x;
+
+    _scheduler.tile_image(ref.size);
+    _scheduler.run(_workers, [&](tile_scheduler::tile const& t) {
+      splat_row r = row;
+      r.begin = t.origin.x;
+      r.end   = t.origin.x + t.size.x;
+      for (unsigned y = t.origin.y; y < t.origin.y + t.size.y; ++y) {
+        r.y     = y;
+        r.depth = ref.depth_data() + y * rw;
+        r.color = ref.color_data() + y * rw;
+        _splat_row(r, splats);
+      }
+    });
+
+    // surfaces behind the front one go through the same atomic min, which
+    // keeps them wherever nothing nearer lands
+    depth_layers const& layers = ref.back_layers;
+    if (!layers.empty() && layers.size == ref.size) {
+      _workers.parallel_for(ref.size.y, [&](std::size_t begin, std::size_t end) {
+        splat_row r = row;
+        r.begin = 0;
+        r.end   = ref.size.x;
+        for (std::size_t y = begin; y < end; ++y) {
+          r.y     = unsigned(y);
+          r.depth = layers.depth.data() + layers.row_offsets[y];
+          r.color = layers.color.data() + layers.row_offsets[y];
+          splat_layer_row(r, layers.counts.data() + y * rw, splats);
+        }
+      }, std::max<std::size_t>(1, ref.size.y / (_workers.size() * 8)));
+    }
+  }
+
+  _workers.parallel_for(th, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin * tw; i < end * tw; ++i) {
+      std::uint64_t const p = splats[i].load(std::memory_order_relaxed);
+      target_depth[i] = bits_to_depth(packed_depth_bits(p));
+      target_color[i] = packed_color(p);
+    }
+  }, target_grain);
+}
+
+} // namespace diw
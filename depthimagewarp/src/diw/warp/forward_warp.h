@@ -0,0 +1,73 @@
+#ifndef DIW_WARP_FORWARD_WARP_H_INCLUDED
+#define DIW_WARP_FORWARD_WARP_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include <scm/core/math.h>
+
+#include <diw/core/cpu_features.h>
+#include <diw/core/reference_frame.h>
+#include <diw/core/tile_scheduler.h>
+#include <diw/core/worker_pool.h>
+#include <diw/warp/splat_kernels.h>
+#include <diw/warp/warp_target.h>
+
+namespace diw {
+
+// cpu implementation of the depth image warp. every reference pixel is
+// reprojected into the target camera and splatted to the nearest target
+// pixel. target pixels are 64 bit words of depth bits and color, a single
+// atomic min per splat resolves visibility, no locks and no second pass:
+//   1. clear target
+//   2. reproject and splat, simd kernel picked at runtime, then the back
+//      layers of the reference if it has any
+//   3. unpack into the warp_target
+// clear and unpack are uniform and split by rows. splatting costs what the
+// reference content costs, background is free and depth edges are not, so
+// it runs on reference tiles balanced by the tile_scheduler.
+class forward_warp
+{
+public:
+  explicit forward_warp(unsigned num_threads = std::thread::hardware_concurrency());
+
+  void          clear_color(std::uint32_t c) { _clear_color = c; }
+  std::uint32_t clear_color() const { return _clear_color; }
+
+  unsigned      num_threads() const { return _workers.size(); }
+
+  // defaults to the best the cpu supports, higher levels are clamped to it
+  void          simd(simd_level level);
+  simd_level    simd() const { return _simd; }
+
+  tile_scheduler const& scheduler() const { return _scheduler; }
+
+  // reprojects ref into the camera (projection, view) at the resolution of
+  // target_size. target is resized if needed.
+  void warp(reference_frame const&    ref,
+            scm::math::mat4f const&   projection,
+            scm::math::mat4f const&   view,
+            scm::math::vec2ui const&  target_size,
+            warp_target&              target);
+
+private:
+  void reserve_splats(std::size_t count);
+
+  worker_pool                                   _workers;
+  tile_scheduler                                _scheduler;
+
+  simd_level                                    _simd;
+  splat_row_function                            _splat_row;
+
+  std::unique_ptr<std::atomic<std::uint64_t>[]> _splats;
+  std::size_t                                   _splat_capacity;
+
+  std::uint32_t                                 _clear_color;
+
+}; // class forward_warp
+
+} // namespace diw
+
+#endif // DIW_WARP_FORWARD_WARP_H_INCLUDED
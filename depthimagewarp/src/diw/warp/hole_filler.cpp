@@ -0,0 +1,337 @@
+#include "hole_filler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// a quarter of the weight of the background
+float const default_foreground_weight = 0.25f;
+
+// same register as backward_warp, one percent of eye depth
+float const default_thickness = 0.01f;
+
+// color and depth of a cell, w is how much of it was seen
+struct sample
+{
+  float r, g, b, w, d;
+};
+
+inline sample unpack(std::uint32_t c, float d)
+{
+  float const w = d < 1.0f ? 1.0f : 0.0f;
+  sample s;
+  s.r = float(c & 0xffu);
+  s.g = float((c >> 8) & 0xffu);
+  s.b = float((c >> 16) & 0xffu);
+  s.w = w;
+  s.d = w * d;
+  return s;
+}
+
+inline std::uint32_t pack(sample const& s)
+{
+  return   std::uint32_t(s.r + 0.5f)
+         | std::uint32_t(s.g + 0.5f) << 8
+         | std::uint32_t(s.b + 0.5f) << 16
+         | 0xff000000u;
+}
+
+// the four children of a cell, holes have w and d of 0. children nearer
+// than the farthest valid one by more than the tolerance are foreground.
+inline sample reduce(sample const& a, sample const& b, sample const& c, sample const& d,
+                     float thickness, float foreground_weight)
+{
+  float const far = std::max(std::max(a.d, b.d), std::max(c.d, d.d));
+  float const edge = far - thickness * (1.0f - far);
+
+  float const ka = a.w * (a.d >= edge ? 1.0f : foreground_weight);
+  float const kb = b.w * (b.d >= edge ? 1.0f : foreground_weight);
+  float const kc = c.w * (c.d >= edge ? 1.0f : foreground_weight);
+  float const kd = d.w * (d.d >= edge ? 1.0f : foreground_weight);
+
+  float const k = ka + kb + kc + kd;
+  float const inv = k > 0.0f ? 1.0f / k : 0.0f;
+
+  // one valid child makes half a cell, two or more a whole one
+  sample o;
+  o.r = (ka * a.r + kb * b.r + kc * c.r + kd * d.r) * inv;
+  o.g = (ka * a.g + kb * b.g + kc * c.g + kd * d.g) * inv;
+  o.b = (ka * a.b + kb * b.b + kc * c.b + kd * d.b) * inv;
+  o.d = (ka * a.d + kb * b.d + kc * c.d + kd * d.d) * inv;
+  o.w = std::min(1.0f, 0.5f * (a.w + b.w + c.w + d.w));
+  return o;
+}
+
+// parent rows or columns of a fine index and the weight of the first, the
+// fine center lies a quarter cell off the nearest parent center
+struct taps
+{
+  unsigned  i0, i1;
+  float     k0;
+};
+
+inline taps parent_taps(unsigned i, unsigned parent_count)
+{
+  unsigned const p = i >> 1;
+  taps t;
+  if (i & 1u) {
+    t.i0 = p;
+    t.i1 = std::min(p + 1, parent_count - 1);
+    t.k0 = 0.75f;
+  }
+  else {
+    t.i0 = p > 0 ? p - 1 : 0;
+    t.i1 = p;
+    t.k0 = 0.25f;
+  }
+  return t;
+}
+
+// bilinear upsample of the four parents of a fine cell, weighted by what the
+// parents saw and, like reduce(), leaning towards the farthest of them.
+// color and depth come back normalized, w is the weight it all rests on.
+template <typename planes>
+inline sample upsample(planes const& src, taps const& ty, taps const& tx,
+                       float thickness, float foreground_weight)
+{
+  std::size_t const row0 = std::size_t(ty.i0) * src.size.x;
+  std::size_t const row1 = std::size_t(ty.i1) * src.size.x;
+  std::size_t const p[4] = { row0 + tx.i0, row0 + tx.i1, row1 + tx.i0, row1 + tx.i1 };
+
+  float const far = std::max(std::max(src.d[p[0]], src.d[p[1]]),
+                             std::max(src.d[p[2]], src.d[p[3]]));
+  float const edge = far - thickness * (1.0f - far);
+
+  float const k[4] = { ty.k0 * tx.k0,          ty.k0 * (1.0f - tx.k0),
+                       (1.0f - ty.k0) * tx.k0, (1.0f - ty.k0) * (1.0f - tx.k0) };
+
+  sample s = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+  for (int i = 0; i < 4; ++i) {
+    float const kw = k[i] * src.w[p[i]] * (src.d[p[i]] >= edge ? 1.0f : foreground_weight);
+    s.r += kw * src.r[p[i]];
+    s.g += kw * src.g[p[i]];
+    s.b += kw * src.b[p[i]];
+    s.d += kw * src.d[p[i]];
+    s.w += kw;
+  }
+
+  float const inv = s.w > 0.0f ? 1.0f / s.w : 0.0f;
+  s.r *= inv;
+  s.g *= inv;
+  s.b *= inv;
+  s.d *= inv;
+  return s;
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+void hole_filler::level::resize(scm::math::vec2ui const& s)
+{
+  std::size_t const n = std::size_t(s.x) * s.y;
+  size = s;
+  r.resize(n);
+  g.resize(n);
+  b.resize(n);
+  w.resize(n);
+  d.resize(n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+hole_filler::hole_filler(unsigned num_threads)
+  : _workers(num_threads)
+  , _foreground_weight(default_foreground_weight)
+  , _thickness(default_thickness)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t hole_filler::fill(warp_target& target)
+{
+  using scm::math::vec2ui;
+
+  vec2ui const size = target.size;
+  if (size.x < 2 && size.y < 2) {
+    return 0;
+  }
+
+  // levels from half size down to a single cell, the target itself is the
+  // finest level and is never copied. storage is kept across fills.
+  std::size_t count = 0;
+  for (vec2ui s((size.x + 1) / 2, (size.y + 1) / 2); ; s = vec2ui((s.x + 1) / 2, (s.y + 1) / 2)) {
+    if (count == _levels.size()) {
+      _levels.emplace_back();
+    }
+    _levels[count].resize(s);
+    ++count;
+
+    if (s.x <= 1 && s.y <= 1) {
+      break;
+    }
+  }
+  _levels.resize(count);
+
+  float const thickness = _thickness;
+  float const foreground_weight = _foreground_weight;
+
+  std::uint32_t const* color = target.color.data();
+  float const*         depth = target.depth.data();
+
+  std::atomic<std::size_t> holes(0);
+  _workers.parallel_for(size.y, [&](std::size_t begin, std::size_t end) {
+    std::size_t const n = std::count_if(depth + begin * size.x, depth + end * size.x,
+                                        [](float v) { return v >= 1.0f; });
+    holes.fetch_add(n, std::memory_order_relaxed);
+  }, std::max<std::size_t>(1, size.y / (_workers.size() * 8)));
+
+  if (holes.load() == 0) {
+    return 0;
+  }
+
+  // push the target into the first level
+  level& first = _levels[0];
+  _workers.parallel_for(first.size.y, [&](std::size_t begin, std::size_t end) {
+    for (unsigned y = unsigned(begin); y < unsigned(end); ++y) {
+      unsigned const y0 = 2 * y;
+      unsigned const y1 = std::min(y0 + 1, size.y - 1);
+      std::size_t const row0 = std::size_t(y0) * size.x;
+      std::size_t const row1 = std::size_t(y1) * size.x;
+      std::size_t const out  = std::size_t(y) * first.size.x;
+
+      for (unsigned x = 0; x < first.size.x; ++x) {
+        unsigned const x0 = 2 * x;
+        unsigned const x1 = std::min(x0 + 1, size.x - 1);
+
+        sample const a = unpack(color[row0 + x0], depth[row0 + x0]);
+        sample const b = unpack(color[row0 + x1], depth[row0 + x1]);
+        sample const c = unpack(color[row1 + x0], depth[row1 + x0]);
+        sample const d = unpack(color[row1 + x1], depth[row1 + x1]);
+
+        sample const o = reduce(a, b, c, d, thickness, foreground_weight);
+        first.r[out + x] = o.r;
+        first.g[out + x] = o.g;
+        first.b[out + x] = o.b;
+        first.w[out + x] = o.w;
+        first.d[out + x] = o.d;
+      }
+    }
+  }, std::max<std::size_t>(1, first.size.y / (_workers.size() * 8)));
+
+  for (std::size_t l = 1; l < count; ++l) {
+    push(_levels[l - 1], _levels[l]);
+  }
+
+  // nothing valid anywhere, nothing to fill from
+  if (_levels[count - 1].w[0] <= 0.0f) {
+    return 0;
+  }
+
+  for (std::size_t l = count - 1; l > 0; --l) {
+    pull(_levels[l], _levels[l - 1]);
+  }
+
+  // the last pull only touches holes of the target
+  level const& src = _levels[0];
+  std::atomic<std::size_t> filled(0);
+
+  _workers.parallel_for(size.y, [&](std::size_t begin, std::size_t end) {
+    std::size_t band_filled = 0;
+
+    for (unsigned y = unsigned(begin); y < unsigned(end); ++y) {
+      taps const ty = parent_taps(y, src.size.y);
+      std::size_t const out = std::size_t(y) * size.x;
+
+      for (unsigned x = 0; x < size.x; ++x) {
+        if (target.depth[out + x] < 1.0f) {
+          continue;
+        }
+
+        sample const s = upsample(src, ty, parent_taps(x, src.size.x), thickness, foreground_weight);
+        if (s.w <= 0.0f) {
+          continue;
+        }
+
+        target.color[out + x] = pack(s);
+        target.depth[out + x] = std::min(s.d, std::nextafter(1.0f, 0.0f));
+        ++band_filled;
+      }
+    }
+
+    filled.fetch_add(band_filled, std::memory_order_relaxed);
+  }, std::max<std::size_t>(1, size.y / (_workers.size() * 8)));
+
+  return filled.load();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void hole_filler::push(level const& src, level& dst)
+{
+  float const thickness = _thickness;
+  float const foreground_weight = _foreground_weight;
+
+  _workers.parallel_for(dst.size.y, [&](std::size_t begin, std::size_t end) {
+    for (unsigned y = unsigned(begin); y < unsigned(end); ++y) {
+      unsigned const y0 = 2 * y;
+      unsigned const y1 = std::min(y0 + 1, src.size.y - 1);
+      std::size_t const row0 = std::size_t(y0) * src.size.x;
+      std::size_t const row1 = std::size_t(y1) * src.size.x;
+      std::size_t const out  = std::size_t(y) * dst.size.x;
+
+      for (unsigned x = 0; x < dst.size.x; ++x) {
+        std::size_t const i[4] = { row0 + 2 * x, row0 + std::min(2 * x + 1, src.size.x - 1),
+                                   row1 + 2 * x, row1 + std::min(2 * x + 1, src.size.x - 1) };
+        sample s[4];
+        for (int j = 0; j < 4; ++j) {
+          s[j].r = src.r[i[j]];
+          s[j].g = src.g[i[j]];
+          s[j].b = src.b[i[j]];
+          s[j].w = src.w[i[j]];
+          s[j].d = src.d[i[j]];
+        }
+
+        sample const o = reduce(s[0], s[1], s[2], s[3], thickness, foreground_weight);
+        dst.r[out + x] = o.r;
+        dst.g[out + x] = o.g;
+        dst.b[out + x] = o.b;
+        dst.w[out + x] = o.w;
+        dst.d[out + x] = o.d;
+      }
+    }
+  }, std::max<std::size_t>(1, dst.size.y / (_workers.size() * 8)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void hole_filler::pull(level const& src, level& dst)
+{
+  float const thickness = _thickness;
+  float const foreground_weight = _foreground_weight;
+
+  _workers.parallel_for(dst.size.y, [&](std::size_t begin, std::size_t end) {
+    for (unsigned y = unsigned(begin); y < unsigned(end); ++y) {
+      taps const ty = parent_taps(y, src.size.y);
+      std::size_t const out = std::size_t(y) * dst.size.x;
+
+      for (unsigned x = 0; x < dst.size.x; ++x) {
+        sample const s = upsample(src, ty, parent_taps(x, src.size.x), thickness, foreground_weight);
+
+        // what the cell saw itself stays, the rest comes from above
+        std::size_t const i = out + x;
+        float const own = dst.w[i];
+        float const up  = s.w > 0.0f ? 1.0f - own : 0.0f;
+
+        dst.r[i] += up * (s.r - dst.r[i]);
+        dst.g[i] += up * (s.g - dst.g[i]);
+        dst.b[i] += up * (s.b - dst.b[i]);
+        dst.d[i] += up * (s.d - dst.d[i]);
+        dst.w[i]  = own + up;
+      }
+    }
+  }, std::max<std::size_t>(1, dst.size.y / (_workers.size() * 8)));
+}
+
+} // namespace diw
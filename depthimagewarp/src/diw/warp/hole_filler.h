@@ -0,0 +1,64 @@
+#ifndef DIW_WARP_HOLE_FILLER_H_INCLUDED
+#define DIW_WARP_HOLE_FILLER_H_INCLUDED
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <scm/core/math.h>
+
+#include <diw/core/worker_pool.h>
+#include <diw/warp/warp_target.h>
+
+namespace diw {
+
+// fills the holes of a warp_target with push-pull:
+//   push  every level averages the 2x2 cells below it, holes carry no
+//         weight and cells much nearer than the farthest of the four
+//         count less, disocclusions show what is behind, not the occluder
+//   pull  from the coarsest level down every cell short of full weight is
+//         topped up with the bilinear upsample of the level above, again
+//         leaning towards the farther parents
+// holes get color and depth of the result, everything else is untouched.
+//
+// planes are kept per channel so the row loops vectorize, every level is
+// split in row bands over the worker pool.
+class hole_filler
+{
+public:
+  explicit hole_filler(unsigned num_threads = std::thread::hardware_concurrency());
+
+  // weight of a cell nearer than the farthest one of its block
+  void          foreground_weight(float w) { _foreground_weight = w; }
+  float         foreground_weight() const { return _foreground_weight; }
+
+  // depth difference up to which a cell counts as background, relative to
+  // eye depth like backward_warp::thickness()
+  void          thickness(float t) { _thickness = t; }
+  float         thickness() const { return _thickness; }
+
+  // number of holes filled, 0 if there were none or nothing to fill from
+  std::size_t   fill(warp_target& target);
+
+private:
+  struct level {
+    scm::math::vec2ui   size;
+    std::vector<float>  r, g, b, w, d;
+
+    void resize(scm::math::vec2ui const& s);
+  };
+
+  void          push(level const& src, level& dst);
+  void          pull(level const& src, level& dst);
+
+  worker_pool               _workers;
+  std::vector<level>        _levels;
+
+  float                     _foreground_weight;
+  float                     _thickness;
+
+}; // class hole_filler
+
+} // namespace diw
+
+#endif // DIW_WARP_HOLE_FILLER_H_INCLUDED
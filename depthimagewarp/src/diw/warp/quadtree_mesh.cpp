@@ -0,0 +1,351 @@
+#include "quadtree_mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// a fifth of a percent of eye depth
+float const default_tolerance = 0.002f;
+
+// five percent of eye depth between neighboring pixels
+float const default_discontinuity = 0.05f;
+
+// cell flags. single pixel quads split along the diagonal with the smaller
+// depth difference and keep each of the two triangles only if it does not
+// cross an edge, larger cells fan out if a neighbor is finer.
+std::uint32_t const diagonal_bd = 1u << 0;
+std::uint32_t const keep_first  = 1u << 1;
+std::uint32_t const keep_second = 1u << 2;
+std::uint32_t const fan         = 1u << 3;
+
+inline bool continuous(float a, float b, float c, float discontinuity)
+{
+  float const lo = std::min(std::min(a, b), c);
+  float const hi = std::max(std::max(a, b), c);
+  return hi < 1.0f && hi - lo <= discontinuity * (1.0f - hi);
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+quadtree_mesh::quadtree_mesh(unsigned num_threads)
+  : _workers(num_threads)
+  , _scheduler(scm::math::vec2ui(root_size, root_size))
+  , _vertex_capacity(0)
+  , _tolerance(default_tolerance)
+  , _discontinuity(default_discontinuity)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void quadtree_mesh::build(reference_frame const& ref, reference_mesh& mesh)
+{
+  mesh.size     = ref.size;
+  mesh.frame_id = ref.frame_id;
+  mesh.vertices.clear();
+  mesh.indices.clear();
+
+  if (ref.size.x < 2 || ref.size.y < 2) {
+    return;
+  }
+
+  unsigned const w = ref.size.x;
+  unsigned const h = ref.size.y;
+  std::size_t const row_grain = std::max<std::size_t>(1, h / (_workers.size() * 8));
+
+  std::size_t const count = std::size_t(w) * h;
+  if (count > _vertex_capacity) {
+    _vertex_index.reset(new std::atomic<std::uint32_t>[count]);
+    _vertex_capacity = count;
+  }
+  _workers.parallel_for(h, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin * w; i < end * w; ++i) {
+      _vertex_index[i].store(0u, std::memory_order_relaxed);
+    }
+  }, row_grain);
+
+  _scheduler.tile_image(ref.size);
+  std::size_t const tiles = _scheduler.tile_count();
+  unsigned const columns = (w + root_size - 1) / root_size;
+
+  _cells.resize(tiles);
+  _indices.resize(tiles);
+
+  auto const tile_index = [columns](tile_scheduler::tile const& t) {
+    return std::size_t(t.origin.y / root_size) * columns + t.origin.x / root_size;
+  };
+
+  // every pass needs all of the one before, a cell only knows its finer
+  // neighbors once they are all split
+  _scheduler.run(_workers, [&](tile_scheduler::tile const& t) {
+    split(ref, t, _cells[tile_index(t)]);
+  });
+  _scheduler.run(_workers, [&](tile_scheduler::tile const& t) {
+    stitch(ref, _cells[tile_index(t)]);
+  });
+
+  // vertices numbered by rows
+  _row_offsets.resize(h + 1);
+  _workers.parallel_for(h, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t y = begin; y < end; ++y) {
+      std::uint32_t n = 0;
+      for (std::size_t i = y * w; i < (y + 1) * w; ++i) {
+        n += marked(i) ? 1u : 0u;
+      }
+      _row_offsets[y + 1] = n;
+    }
+  }, row_grain);
+
+  _row_offsets[0] = 0;
+  for (unsigned y = 0; y < h; ++y) {
+    _row_offsets[y + 1] += _row_offsets[y];
+  }
+
+  mesh.vertices.resize(_row_offsets[h]);
+  _workers.parallel_for(h, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t y = begin; y < end; ++y) {
+      std::uint32_t next = _row_offsets[y];
+      for (unsigned x = 0; x < w; ++x) {
+        std::size_t const i = y * w + x;
+        if (!marked(i)) {
+          continue;
+        }
+        reference_mesh::vertex& v = mesh.vertices[next];
+        v.x = float(x) + 0.5f;
+        v.y = float(y) + 0.5f;
+        v.z = ref.depth_data()[i];
+        _vertex_index[i].store(++next, std::memory_order_relaxed);
+      }
+    }
+  }, row_grain);
+
+  _scheduler.run(_workers, [&](tile_scheduler::tile const& t) {
+    std::size_t const i = tile_index(t);
+    triangulate(ref, _cells[i], _indices[i]);
+  });
+
+  // tiles in order, so the mesh does not depend on who ran what
+  std::vector<std::size_t> offsets(tiles + 1, 0);
+  for (std::size_t i = 0; i < tiles; ++i) {
+    offsets[i + 1] = offsets[i] + _indices[i].size();
+  }
+  mesh.indices.resize(offsets[tiles]);
+  _workers.parallel_for(tiles, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      std::copy(_indices[i].begin(), _indices[i].end(), mesh.indices.begin() + offsets[i]);
+    }
+  });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void quadtree_mesh::split(reference_frame const& ref, tile_scheduler::tile const& t, std::vector<cell>& cells)
+{
+  unsigned const w = ref.size.x;
+  unsigned const h = ref.size.y;
+  float const* depth = ref.depth_data();
+
+  float const tolerance = _tolerance;
+  float const discontinuity = _discontinuity;
+
+  cells.clear();
+
+  // cells span lattice points [x, x + size], the last point of the image
+  // is w - 1, roots reaching past it split until they fit. depth first, at
+  // most three siblings wait per level.
+  cell stack[4 * 8];
+  unsigned top = 0;
+  stack[top++] = cell{ t.origin.x, t.origin.y, root_size, 0u };
+
+  while (top > 0) {
+    cell c = stack[--top];
+    if (c.x >= w - 1 || c.y >= h - 1) {
+      continue;
+    }
+
+    unsigned const s = c.size;
+    std::size_t const a = std::size_t(c.y) * w + c.x;
+    std::size_t const b = a + s;
+    std::size_t const d = a + std::size_t(s) * w;
+    std::size_t const e = d + s;
+
+    bool leaf = false;
+
+    if (s == 1) {
+      float const da = depth[a];
+      float const db = depth[b];
+      float const dc = depth[e];
+      float const dd = depth[d];
+
+      if (std::abs(da - dc) <= std::abs(db - dd)) {
+        c.flags |= continuous(da, db, dc, discontinuity) ? keep_first : 0u;
+        c.flags |= continuous(da, dc, dd, discontinuity) ? keep_second : 0u;
+        if (c.flags & keep_first)  { mark(a); mark(b); mark(e); }
+        if (c.flags & keep_second) { mark(a); mark(e); mark(d); }
+      }
+      else {
+        c.flags |= diagonal_bd;
+        c.flags |= continuous(da, db, dd, discontinuity) ? keep_first : 0u;
+        c.flags |= continuous(db, dc, dd, discontinuity) ? keep_second : 0u;
+        if (c.flags & keep_first)  { mark(a); mark(b); mark(d); }
+        if (c.flags & keep_second) { mark(b); mark(e); mark(d); }
+      }
+
+      if (c.flags & (keep_first | keep_second)) {
+        cells.push_back(c);
+      }
+      continue;
+    }
+
+    if (c.x + s <= w - 1 && c.y + s <= h - 1) {
+      float const da = depth[a];
+      float const db = depth[b];
+      float const dc = depth[e];
+      float const dd = depth[d];
+
+      // all background is no cell at all, some background is an edge
+      unsigned background = 0;
+      bool planar = true;
+      float const inv = 1.0f / float(s);
+
+      for (unsigned j = 0; j <= s && planar; ++j) {
+        float const v = float(j) * inv;
+        float const left  = da + v * (dd - da);
+        float const right = db + v * (dc - db);
+        float const* row = depth + a + std::size_t(j) * w;
+
+        for (unsigned i = 0; i <= s; ++i) {
+          float const z = row[i];
+          if (z >= 1.0f) {
+            ++background;
+            continue;
+          }
+          float const fit = left + float(i) * inv * (right - left);
+          if (std::abs(z - fit) > tolerance * (1.0f - z)) {
+            planar = false;
+            break;
+          }
+        }
+      }
+
+      if (planar && background == (s + 1) * (s + 1)) {
+        continue;
+      }
+      leaf = planar && background == 0;
+    }
+
+    if (leaf) {
+      mark(a);
+      mark(b);
+      mark(d);
+      mark(e);
+      cells.push_back(c);
+      continue;
+    }
+
+    unsigned const half = s / 2;
+    stack[top++] = cell{ c.x,        c.y + half, half, 0u };
+    stack[top++] = cell{ c.x + half, c.y + half, half, 0u };
+    stack[top++] = cell{ c.x + half, c.y,        half, 0u };
+    stack[top++] = cell{ c.x,        c.y,        half, 0u };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void quadtree_mesh::stitch(reference_frame const& ref, std::vector<cell>& cells)
+{
+  unsigned const w = ref.size.x;
+
+  // a finer neighbor leaves a vertex on the border. its depth passed the
+  // same bilinear test as the whole cell, fanning over it closes the crack
+  // without moving anything.
+  for (cell& c : cells) {
+    if (c.size == 1) {
+      continue;
+    }
+
+    std::size_t const a = std::size_t(c.y) * w + c.x;
+    std::size_t const d = a + std::size_t(c.size) * w;
+
+    bool finer = false;
+    for (unsigned i = 1; i < c.size && !finer; ++i) {
+      finer =    marked(a + i)
+              || marked(d + i)
+              || marked(a + std::size_t(i) * w)
+              || marked(a + std::size_t(i) * w + c.size);
+    }
+
+    if (finer) {
+      c.flags |= fan;
+      mark(a + std::size_t(c.size / 2) * w + c.size / 2);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void quadtree_mesh::triangulate(reference_frame const& ref, std::vector<cell> const& cells,
+                                std::vector<std::uint32_t>& indices)
+{
+  unsigned const w = ref.size.x;
+
+  auto const vertex = [this](std::size_t i) {
+    return _vertex_index[i].load(std::memory_order_relaxed) - 1;
+  };
+
+  indices.clear();
+
+  std::vector<std::uint32_t> border;
+
+  for (cell const& c : cells) {
+    std::size_t const a = std::size_t(c.y) * w + c.x;
+    std::size_t const b = a + c.size;
+    std::size_t const d = a + std::size_t(c.size) * w;
+    std::size_t const e = d + c.size;
+
+    if (c.size == 1) {
+      std::uint32_t const va = vertex(a);
+      std::uint32_t const vb = vertex(b);
+      std::uint32_t const ve = vertex(e);
+      std::uint32_t const vd = vertex(d);
+
+      if (c.flags & diagonal_bd) {
+        if (c.flags & keep_first)  { indices.insert(indices.end(), { va, vb, vd }); }
+        if (c.flags & keep_second) { indices.insert(indices.end(), { vb, ve, vd }); }
+      }
+      else {
+        if (c.flags & keep_first)  { indices.insert(indices.end(), { va, vb, ve }); }
+        if (c.flags & keep_second) { indices.insert(indices.end(), { va, ve, vd }); }
+      }
+      continue;
+    }
+
+    if (!(c.flags & fan)) {
+      indices.insert(indices.end(), { vertex(a), vertex(b), vertex(e), vertex(a), vertex(e), vertex(d) });
+      continue;
+    }
+
+    // border counterclockwise from the lower left corner
+    border.clear();
+    for (unsigned i = 0; i < c.size; ++i) {
+      if (marked(a + i)) border.push_back(vertex(a + i));
+    }
+    for (unsigned i = 0; i < c.size; ++i) {
+      if (marked(b + std::size_t(i) * w)) border.push_back(vertex(b + std::size_t(i) * w));
+    }
+    for (unsigned i = 0; i < c.size; ++i) {
+      if (marked(e - i)) border.push_back(vertex(e - i));
+    }
+    for (unsigned i = 0; i < c.size; ++i) {
+      if (marked(d - std::size_t(i) * w)) border.push_back(vertex(d - std::size_t(i) * w));
+    }
+
+    std::uint32_t const center = vertex(a + std::size_t(c.size / 2) * w + c.size / 2);
+    for (std::size_t i = 0; i < border.size(); ++i) {
+      indices.insert(indices.end(), { center, border[i], border[(i + 1) % border.size()] });
+    }
+  }
+}
+
+} // namespace diw
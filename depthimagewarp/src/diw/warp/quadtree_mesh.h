@@ -0,0 +1,104 @@
+#ifndef DIW_WARP_QUADTREE_MESH_H_INCLUDED
+#define DIW_WARP_QUADTREE_MESH_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <scm/core/math.h>
+
+#include <diw/core/reference_frame.h>
+#include <diw/core/tile_scheduler.h>
+#include <diw/core/worker_pool.h>
+
+namespace diw {
+
+// triangle mesh of a reference depth image, what the fast client
+// rasterizes instead of splatting every pixel.
+struct reference_mesh
+{
+  // reference window space, pixel centers at +0.5, depth in [0, 1]
+  struct vertex {
+    float x, y, z;
+  };
+
+  reference_mesh()
+    : size(0u, 0u)
+    , frame_id(0)
+  {}
+
+  bool empty() const { return indices.empty(); }
+
+  scm::math::vec2ui           size;       // of the reference frame
+  std::vector<vertex>         vertices;
+  std::vector<std::uint32_t>  indices;    // triangle list, ccw in window space
+
+  std::uint64_t               frame_id;
+
+}; // struct reference_mesh
+
+// adaptive quadtree meshing of a reference depth image. vertices sit on
+// pixel centers, every root cell of root_size pixels is split until its
+// depth is bilinear within tolerance or it is a single pixel quad:
+//   1. leaves per root cell, the cells are the tiles of a tile_scheduler
+//   2. cells with a finer neighbor fan out from their center over every
+//      vertex on their border, no t-junctions and so no cracks
+//   3. vertex numbering by rows, triangles per tile, then concatenated
+// window depth of a plane is linear in window x and y, planar surfaces of
+// any slant end up in a few large quads. single pixel quads drop triangles
+// across depth discontinuities and background, those stay holes.
+class quadtree_mesh
+{
+public:
+  static const unsigned root_size = 64;
+
+  explicit quadtree_mesh(unsigned num_threads = std::thread::hardware_concurrency());
+
+  // deviation from bilinear up to which a cell is one quad, relative to
+  // eye depth like backward_warp::thickness()
+  void          tolerance(float t) { _tolerance = t; }
+  float         tolerance() const { return _tolerance; }
+
+  // depth jump across a single pixel quad that tears it, relative as well
+  void          discontinuity(float d) { _discontinuity = d; }
+  float         discontinuity() const { return _discontinuity; }
+
+  void          build(reference_frame const& ref, reference_mesh& mesh);
+
+private:
+  struct cell {
+    std::uint32_t   x, y;
+    std::uint32_t   size;
+    std::uint32_t   flags;
+  };
+
+  void          split(reference_frame const& ref, tile_scheduler::tile const& t, std::vector<cell>& cells);
+  void          stitch(reference_frame const& ref, std::vector<cell>& cells);
+  void          triangulate(reference_frame const& ref, std::vector<cell> const& cells,
+                            std::vector<std::uint32_t>& indices);
+
+  void          mark(std::size_t i) { _vertex_index[i].store(1u, std::memory_order_relaxed); }
+  bool          marked(std::size_t i) const { return _vertex_index[i].load(std::memory_order_relaxed) != 0; }
+
+  worker_pool                                   _workers;
+  tile_scheduler                                _scheduler;
+
+  // per lattice point 0 for no vertex, 1 for used after splitting and the
+  // vertex index + 1 after numbering
+  std::unique_ptr<std::atomic<std::uint32_t>[]> _vertex_index;
+  std::size_t                                   _vertex_capacity;
+
+  std::vector<std::vector<cell>>                _cells;       // per tile
+  std::vector<std::vector<std::uint32_t>>       _indices;     // per tile
+  std::vector<std::uint32_t>                    _row_offsets;
+
+  float                                         _tolerance;
+  float                                         _discontinuity;
+
+}; // class quadtree_mesh
+
+} // namespace diw
+
+#endif // DIW_WARP_QUADTREE_MESH_H_INCLUDED
@@ -0,0 +1,101 @@
+#include "reference_fusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// a tenth of a meter per radian
+float const default_angle_weight = 0.1f;
+
+// eye position and view direction in world space from a view matrix, the
+// inverse of the rigid part without inverting a full matrix
+inline void eye_of(scm::math::mat4f const& view, float* eye, float* forward)
+{
+  float const* m = view.data_array;
+  for (int i = 0; i < 3; ++i) {
+    // rows of the rotation are the camera axes, the camera looks down -z
+    eye[i]     = -(m[4 * i] * m[12] + m[4 * i + 1] * m[13] + m[4 * i + 2] * m[14]);
+    forward[i] = -m[4 * i + 2];
+  }
+}
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+reference_fusion::reference_fusion(std::size_t capacity, unsigned num_threads)
+  : _ring(std::max<std::size_t>(capacity, 1))
+  , _next(0)
+  , _count(0)
+  , _warp(num_threads)
+  , _angle_weight(default_angle_weight)
+{
+  _warp.pyramid_cache(_ring.size());
+  _order.reserve(_ring.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void reference_fusion::push(reference_frame& ref)
+{
+  using std::swap;
+  swap(_ring[_next], ref);
+
+  _next  = (_next + 1) % _ring.size();
+  _count = std::min(_count + 1, _ring.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+reference_frame const& reference_fusion::newest() const
+{
+  return _ring[(_next + _ring.size() - 1) % _ring.size()];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t reference_fusion::fill(scm::math::mat4f const&  projection,
+                                   scm::math::mat4f const&  view,
+                                   warp_target&             target,
+                                   unsigned                 row_begin,
+                                   unsigned                 row_end)
+{
+  if (_count < 2) {
+    return 0;
+  }
+
+  float eye[3], forward[3];
+  eye_of(view, eye, forward);
+
+  _order.clear();
+  for (std::size_t age = 1; age < _count; ++age) {
+    std::size_t const i = (_next + _ring.size() - 1 - age) % _ring.size();
+    reference_frame const& ref = _ring[i];
+    if (ref.empty()) {
+      continue;
+    }
+
+    float ref_eye[3], ref_forward[3];
+    eye_of(ref.view_matrix, ref_eye, ref_forward);
+
+    float const dx = ref_eye[0] - eye[0];
+    float const dy = ref_eye[1] - eye[1];
+    float const dz = ref_eye[2] - eye[2];
+    float const cosine = forward[0] * ref_forward[0] + forward[1] * ref_forward[1] + forward[2] * ref_forward[2];
+    float const angle = std::acos(std::min(std::max(cosine, -1.0f), 1.0f));
+
+    _order.push_back(candidate{ i, std::sqrt(dx * dx + dy * dy + dz * dz) + _angle_weight * angle });
+  }
+
+  // stable keeps newer first among equal poses, they saw the scene last
+  std::stable_sort(_order.begin(), _order.end(), [](candidate const& a, candidate const& b) {
+    return a.distance < b.distance;
+  });
+
+  std::size_t filled = 0;
+  for (candidate const& c : _order) {
+    filled += _warp.fill_holes(_ring[c.index], projection, view, target, row_begin, row_end);
+  }
+  return filled;
+}
+
+} // namespace diw
@@ -0,0 +1,76 @@
+#ifndef DIW_WARP_REFERENCE_FUSION_H_INCLUDED
+#define DIW_WARP_REFERENCE_FUSION_H_INCLUDED
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <scm/core/math.h>
+
+#include <diw/core/reference_frame.h>
+#include <diw/warp/backward_warp.h>
+#include <diw/warp/warp_target.h>
+
+namespace diw {
+
+// the last few reference frames, each with the camera it was rendered
+// with. the newest one is warped as usual, what it leaves uncovered is
+// filled from the older ones:
+//   1. older references sorted by how close their camera is to the target
+//      camera, eye distance plus the angle between the view directions
+//   2. each one marches only the holes still left, a hole takes the
+//      nearest surface along its view ray, the first reference that hits
+//      anything wins
+// so every additional reference costs what is still missing, not a frame.
+// pyramids are cached per reference, a reference is only reduced once.
+class reference_fusion
+{
+public:
+  explicit reference_fusion(std::size_t capacity = 4,
+                            unsigned    num_threads = std::thread::hardware_concurrency());
+
+  std::size_t   capacity() const { return _ring.size(); }
+  std::size_t   size() const { return _count; }
+  bool          empty() const { return _count == 0; }
+
+  // meters of eye distance one radian between view directions is worth
+  void          angle_weight(float w) { _angle_weight = w; }
+  float         angle_weight() const { return _angle_weight; }
+
+  backward_warp&        warper() { return _warp; }
+
+  // takes the contents of ref by swapping, ref gets the storage of the
+  // oldest reference back for reuse
+  void                    push(reference_frame& ref);
+
+  reference_frame const&  newest() const;
+
+  // fills the holes of target, which holds newest() warped to (projection,
+  // view), from the older references, optionally in a range of rows only.
+  // returns the number of holes filled.
+  std::size_t             fill(scm::math::mat4f const&  projection,
+                               scm::math::mat4f const&  view,
+                               warp_target&             target,
+                               unsigned                 row_begin = 0,
+                               unsigned                 row_end = ~0u);
+
+private:
+  struct candidate {
+    std::size_t   index;
+    float         distance;
+  };
+
+  std::vector<reference_frame>  _ring;
+  std::size_t                   _next;
+  std::size_t                   _count;
+
+  backward_warp                 _warp;
+  std::vector<candidate>        _order;
+
+  float                         _angle_weight;
+
+}; // class reference_fusion
+
+} // namespace diw
+
+#endif // DIW_WARP_REFERENCE_FUSION_H_INCLUDED
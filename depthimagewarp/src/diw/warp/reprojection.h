@@ -0,0 +1,101 @@
+#ifndef DIW_WARP_REPROJECTION_H_INCLUDED
+#define DIW_WARP_REPROJECTION_H_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <scm/core/math.h>
+
+namespace diw {
+
+// maps window coordinates (pixel centers at +0.5, depth in [0, 1]) to ndc
+inline scm::math::mat4f ndc_from_window_matrix(scm::math::vec2ui const& size)
+{
+  scm::math::mat4f m = scm::math::mat4f::identity();
+  m.data_array[0]  = 2.0f / float(size.x);
+  m.data_array[5]  = 2.0f / float(size.y);
+  m.data_array[10] = 2.0f;
+  m.data_array[12] = -1.0f;
+  m.data_array[13] = -1.0f;
+  m.data_array[14] = -1.0f;
+  return m;
+}
+
+// maps ndc to window coordinates, inverse of ndc_from_window_matrix
+inline scm::math::mat4f window_from_ndc_matrix(scm::math::vec2ui const& size)
+{
+  scm::math::mat4f m = scm::math::mat4f::identity();
+  m.data_array[0]  = 0.5f * float(size.x);
+  m.data_array[5]  = 0.5f * float(size.y);
+  m.data_array[10] = 0.5f;
+  m.data_array[12] = 0.5f * float(size.x);
+  m.data_array[13] = 0.5f * float(size.y);
+  m.data_array[14] = 0.5f;
+  return m;
+}
+
+// takes homogeneous window coordinates of the source camera straight to
+// homogeneous window coordinates of the destination camera
+inline scm::math::mat4f reprojection_matrix(scm::math::mat4f const& src_projection,
+                                            scm::math::mat4f const& src_view,
+                                            scm::math::vec2ui const& src_size,
+                                            scm::math::mat4f const& dst_projection,
+                                            scm::math::mat4f const& dst_view,
+                                            scm::math::vec2ui const& dst_size)
+{
+  using namespace scm::math;
+
+  return window_from_ndc_matrix(dst_size) * dst_projection * dst_view
+       * inverse(src_projection * src_view) * ndc_from_window_matrix(src_size);
+}
+
+// projection of a view with a border of guard pixels on every side, same
+// pixel size and center as projection for a window of size. rendered at
+// size + 2 * guard it is the window with a guard band around it.
+inline scm::math::mat4f guard_band_projection(scm::math::mat4f const& projection,
+                                              scm::math::vec2ui const& size,
+                                              unsigned guard)
+{
+  scm::math::mat4f s = scm::math::mat4f::identity();
+  s.data_array[0] = float(size.x) / float(size.x + 2 * guard);
+  s.data_array[5] = float(size.y) / float(size.y + 2 * guard);
+  return s * projection;
+}
+
+// angle in radians the camera turned between two view matrices
+inline float rotation_angle(scm::math::mat4f const& a, scm::math::mat4f const& b)
+{
+  float const* m = a.data_array;
+  float const* n = b.data_array;
+
+  // trace of Ra Rb^T
+  float trace = 0.0f;
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) {
+      trace += m[c * 4 + r] * n[c * 4 + r];
+    }
+  }
+  return std::acos(std::min(std::max(0.5f * (trace - 1.0f), -1.0f), 1.0f));
+}
+
+// non-negative floats order like their bit patterns, which lets depth take
+// part in integer atomics
+inline std::uint32_t depth_to_bits(float d)
+{
+  std::uint32_t b;
+  std::memcpy(&b, &d, sizeof(b));
+  return b;
+}
+
+inline float bits_to_depth(std::uint32_t b)
+{
+  float d;
+  std::memcpy(&d, &b, sizeof(d));
+  return d;
+}
+
+} // namespace diw
+
+#endif // DIW_WARP_REPROJECTION_H_INCLUDED
@@ -0,0 +1,265 @@
+#include "splat_kernels.h"
+
+#if defined(DIW_SIMD_X86)
+#include <immintrin.h>
+#endif
+
+#include <diw/warp/reprojection.h>
+
+namespace {
+
+inline void atomic_min(std::atomic<std::uint64_t>& a, std::uint64_t v)
+{
+  std::uint64_t cur = a.load(std::memory_order_relaxed);
+  while (v < cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+// the parts of the transform that are constant along a row. every kernel
+// evaluates m * (x, y, d, 1) as (m_x * x + m_d * d) + row so that they all
+// round the same way.
+struct row_terms
+{
+  row_terms(float const* m, unsigned y) {
+    float const fy = float(y) + 0.5f;
+    for (int i = 0; i < 4; ++i) {
+      mx[i]  = m[i];
+      md[i]  = m[8 + i];
+      row[i] = m[4 + i] * fy + m[12 + i];
+    }
+  }
+
+  float mx[4];
+  float md[4];
+  float row[4];
+};
+
+inline void splat_sample(row_terms const& t, unsigned x, float d, std::uint32_t color,
+                         unsigned target_width, unsigned target_height,
+                         std::atomic<std::uint64_t>* target)
+{
+  // background, nothing to warp
+  if (!(d < 1.0f)) {
+    return;
+  }
+
+  float const fx = float(x) + 0.5f;
+
+  float const hx = (t.mx[0] * fx + t.md[0] * d) + t.row[0];
+  float const hy = (t.mx[1] * fx + t.md[1] * d) + t.row[1];
+  float const hz = (t.mx[2] * fx + t.md[2] * d) + t.row[2];
+  float const hw = (t.mx[3] * fx + t.md[3] * d) + t.row[3];
+
+  if (!(hw > 0.0f)) {
+    return;
+  }
+
+  float const inv_w = 1.0f / hw;
+  float const tx = hx * inv_w;
+  float const ty = hy * inv_w;
+  float const tz = hz * inv_w;
+
+  // written so that nan fails as well
+  if (!(   tx >= 0.0f && ty >= 0.0f && tx < float(target_width) && ty < float(target_height)
+        && tz >= 0.0f && tz < 1.0f)) {
+    return;
+  }
+
+  std::uint32_t const index = unsigned(ty) * target_width + unsigned(tx);
+  atomic_min(target[index], diw::pack_depth_color(diw::depth_to_bits(tz), color));
+}
+
+inline void splat_pixel(row_terms const& t, diw::splat_row const& r, unsigned x,
+                        std::atomic<std::uint64_t>* target)
+{
+  splat_sample(t, x, r.depth[x], r.color[x], r.target_width, r.target_height, target);
+}
+
+void splat_row_scalar(diw::splat_row const& r, std::atomic<std::uint64_t>* target)
+{
+  row_terms const t(r.m, r.y);
+
+  for (unsigned x = r.begin; x < r.end; ++x) {
+    splat_pixel(t, r, x, target);
+  }
+}
+
+#if defined(DIW_SIMD_X86)
+
+// transforms 4 pixels per iteration, the scatter stays scalar
+DIW_TARGET_SSE4
+void splat_row_sse4(diw::splat_row const& r, std::atomic<std::uint64_t>* target)
+{
+  row_terms const t(r.m, r.y);
+
+  __m128 mx[4], md[4], row[4];
+  for (int i = 0; i < 4; ++i) {
+    mx[i]  = _mm_set1_ps(t.mx[i]);
+    md[i]  = _mm_set1_ps(t.md[i]);
+    row[i] = _mm_set1_ps(t.row[i]);
+  }
+
+  __m128 const  zero = _mm_setzero_ps();
+  __m128 const  one  = _mm_set1_ps(1.0f);
+  __m128 const  tw   = _mm_set1_ps(float(r.target_width));
+  __m128 const  th   = _mm_set1_ps(float(r.target_height));
+  __m128i const twi  = _mm_set1_epi32(int(r.target_width));
+  __m128 const  step = _mm_set1_ps(4.0f);
+
+  alignas(16) std::uint32_t index[4];
+  alignas(16) std::uint32_t bits[4];
+
+  __m128 fx = _mm_add_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(float(r.begin) + 0.5f));
+
+  unsigned x = r.begin;
+  for (; x + 4 <= r.end; x += 4, fx = _mm_add_ps(fx, step)) {
+    __m128 const d = _mm_loadu_ps(r.depth + x);
+
+    __m128 valid = _mm_cmplt_ps(d, one);
+    if (!_mm_movemask_ps(valid)) {
+      continue;
+    }
+
+    __m128 const hx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mx[0], fx), _mm_mul_ps(md[0], d)), row[0]);
+    __m128 const hy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mx[1], fx), _mm_mul_ps(md[1], d)), row[1]);
+    __m128 const hz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mx[2], fx), _mm_mul_ps(md[2], d)), row[2]);
+    __m128 const hw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mx[3], fx), _mm_mul_ps(md[3], d)), row[3]);
+
+    valid = _mm_and_ps(valid, _mm_cmpgt_ps(hw, zero));
+
+    __m128 const inv_w = _mm_div_ps(one, hw);
+    __m128 const tx = _mm_mul_ps(hx, inv_w);
+    __m128 const ty = _mm_mul_ps(hy, inv_w);
+    __m128 const tz = _mm_mul_ps(hz, inv_w);
+
+    // ordered compares, nan fails
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(tx, zero), _mm_cmplt_ps(tx, tw)));
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(ty, zero), _mm_cmplt_ps(ty, th)));
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(tz, zero), _mm_cmplt_ps(tz, one)));
+
+    int mask = _mm_movemask_ps(valid);
+    if (!mask) {
+      continue;
+    }
+
+    __m128i const i = _mm_add_epi32(_mm_mullo_epi32(_mm_cvttps_epi32(ty), twi), _mm_cvttps_epi32(tx));
+    _mm_store_si128(reinterpret_cast<__m128i*>(index), i);
+    _mm_store_si128(reinterpret_cast<__m128i*>(bits), _mm_castps_si128(tz));
+
+    for (unsigned lane = 0; mask; ++lane, mask >>= 1) {
+      if (mask & 1) {
+        atomic_min(target[index[lane]], diw::pack_depth_color(bits[lane], r.color[x + lane]));
+      }
+    }
+  }
+
+  for (; x < r.end; ++x) {
+    splat_pixel(t, r, x, target);
+  }
+}
+
+// transforms 8 pixels per iteration, the scatter stays scalar
+DIW_TARGET_AVX2
+void splat_row_avx2(diw::splat_row const& r, std::atomic<std::uint64_t>* target)
+{
+  row_terms const t(r.m, r.y);
+
+  __m256 mx[4], md[4], row[4];
+  for (int i = 0; i < 4; ++i) {
+    mx[i]  = _mm256_set1_ps(t.mx[i]);
+    md[i]  = _mm256_set1_ps(t.md[i]);
+    row[i] = _mm256_set1_ps(t.row[i]);
+  }
+
+  __m256 const  zero = _mm256_setzero_ps();
+  __m256 const  one  = _mm256_set1_ps(1.0f);
+  __m256 const  tw   = _mm256_set1_ps(float(r.target_width));
+  __m256 const  th   = _mm256_set1_ps(float(r.target_height));
+  __m256i const twi  = _mm256_set1_epi32(int(r.target_width));
+  __m256 const  step = _mm256_set1_ps(8.0f);
+
+  alignas(32) std::uint32_t index[8];
+  alignas(32) std::uint32_t bits[8];
+
+  __m256 fx = _mm256_add_ps(_mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f), _mm256_set1_ps(float(r.begin) + 0.5f));
+
+  unsigned x = r.begin;
+  for (; x + 8 <= r.end; x += 8, fx = _mm256_add_ps(fx, step)) {
+    __m256 const d = _mm256_loadu_ps(r.depth + x);
+
+    __m256 valid = _mm256_cmp_ps(d, one, _CMP_LT_OQ);
+    if (!_mm256_movemask_ps(valid)) {
+      continue;
+    }
+
+    __m256 const hx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mx[0], fx), _mm256_mul_ps(md[0], d)), row[0]);
+    __m256 const hy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mx[1], fx), _mm256_mul_ps(md[1], d)), row[1]);
+    __m256 const hz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mx[2], fx), _mm256_mul_ps(md[2], d)), row[2]);
+    __m256 const hw = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mx[3], fx), _mm256_mul_ps(md[3], d)), row[3]);
+
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(hw, zero, _CMP_GT_OQ));
+
+    __m256 const inv_w = _mm256_div_ps(one, hw);
+    __m256 const tx = _mm256_mul_ps(hx, inv_w);
+    __m256 const ty = _mm256_mul_ps(hy, inv_w);
+    __m256 const tz = _mm256_mul_ps(hz, inv_w);
+
+    // ordered compares, nan fails
+    valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(tx, zero, _CMP_GE_OQ), _mm256_cmp_ps(tx, tw, _CMP_LT_OQ)));
+    valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(ty, zero, _CMP_GE_OQ), _mm256_cmp_ps(ty, th, _CMP_LT_OQ)));
+    valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(tz, zero, _CMP_GE_OQ), _mm256_cmp_ps(tz, one, _CMP_LT_OQ)));
+
+    int mask = _mm256_movemask_ps(valid);
+    if (!mask) {
+      continue;
+    }
+
+    __m256i const i = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(ty), twi), _mm256_cvttps_epi32(tx));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(index), i);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(bits), _mm256_castps_si256(tz));
+
+    for (unsigned lane = 0; mask; ++lane, mask >>= 1) {
+      if (mask & 1) {
+        atomic_min(target[index[lane]], diw::pack_depth_color(bits[lane], r.color[x + lane]));
+      }
+    }
+  }
+
+  for (; x < r.end; ++x) {
+    splat_pixel(t, r, x, target);
+  }
+}
+
+#endif // DIW_SIMD_X86
+
+} // namespace
+
+namespace diw {
+
+///////////////////////////////////////////////////////////////////////////////
+void splat_layer_row(splat_row const& row, std::uint8_t const* counts, std::atomic<std::uint64_t>* target)
+{
+  row_terms const t(row.m, row.y);
+
+  // samples are packed, only the counts say which pixel one belongs to
+  std::size_t next = 0;
+  for (unsigned x = row.begin; x < row.end; ++x) {
+    for (unsigned l = 0; l < counts[x]; ++l, ++next) {
+      splat_sample(t, x, row.depth[next], row.color[next], row.target_width, row.target_height, target);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+splat_row_function splat_row_kernel(simd_level level)
+{
+#if defined(DIW_SIMD_X86)
+  switch (level) {
+    case simd_avx2: return splat_row_avx2;
+    case simd_sse4: return splat_row_sse4;
+    default:        break;
+  }
+#endif
+  return splat_row_scalar;
+}
+
+} // namespace diw
@@ -0,0 +1,53 @@
+#ifndef DIW_WARP_SPLAT_KERNELS_H_INCLUDED
+#define DIW_WARP_SPLAT_KERNELS_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+
+#include <diw/core/cpu_features.h>
+
+namespace diw {
+
+// columns [begin, end) of one reference row to splat, depth and color
+// point at the start of the row. m is the column major reprojection from
+// reference window to target window coordinates.
+struct splat_row
+{
+  float const*          m;
+  float const*          depth;
+  std::uint32_t const*  color;
+  unsigned              y;
+  unsigned              begin;
+  unsigned              end;
+  unsigned              target_width;
+  unsigned              target_height;
+};
+
+// splats every foreground pixel of the span into target, whose words pack
+// the depth bits above the RGBA8 color. a 64 bit atomic min keeps the
+// nearest sample together with its color, equal depths keep the smaller
+// color so the result does not depend on thread timing. all kernels
+// produce bit identical results.
+typedef void (*splat_row_function)(splat_row const& row, std::atomic<std::uint64_t>* target);
+
+// kernel for level, or for the best level below it the build has
+splat_row_function  splat_row_kernel(simd_level level);
+
+// splats the packed back layer samples of columns [begin, end) of a row,
+// depth and color point at the first sample of column begin and counts at
+// the per pixel sample counts of the whole row. layers are sparse, this is
+// the scalar kernel only.
+void                splat_layer_row(splat_row const& row, std::uint8_t const* counts,
+                                    std::atomic<std::uint64_t>* target);
+
+inline std::uint64_t pack_depth_color(std::uint32_t depth_bits, std::uint32_t color)
+{
+  return (std::uint64_t(depth_bits) << 32) | color;
+}
+
+inline std::uint32_t packed_depth_bits(std::uint64_t p) { return std::uint32_t(p >> 32); }
+inline std::uint32_t packed_color(std::uint64_t p)      { return std::uint32_t(p); }
+
+} // namespace diw
+
+#endif // DIW_WARP_SPLAT_KERNELS_H_INCLUDED
@@ -0,0 +1,38 @@
+#ifndef DIW_WARP_WARP_TARGET_H_INCLUDED
+#define DIW_WARP_WARP_TARGET_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include <scm/core/math.h>
+
+namespace diw {
+
+// packed RGBA8 of the clear color the slow client uses (.2, .2, .2, 1)
+const std::uint32_t default_clear_color = 0xff333333u;
+
+// output of a warp pass, same layout as reference_frame. pixels that no
+// reference sample landed on keep depth 1.0 and the clear color.
+struct warp_target
+{
+  warp_target()
+    : size(0u, 0u)
+  {}
+
+  void resize(scm::math::vec2ui const& s) {
+    size = s;
+    color.resize(std::size_t(s.x) * s.y);
+    depth.resize(std::size_t(s.x) * s.y);
+  }
+
+  bool is_hole(std::size_t i) const { return depth[i] >= 1.0f; }
+
+  scm::math::vec2ui           size;
+  std::vector<std::uint32_t>  color;
+  std::vector<float>          depth;
+
+}; // struct warp_target
+
+} // namespace diw
+
+#endif // DIW_WARP_WARP_TARGET_H_INCLUDED
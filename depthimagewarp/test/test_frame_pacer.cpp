@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include <diw/core/clock.h>
+#include <diw/sync/frame_pacer.h>
+
+// 2 to 4 ms of work per frame on a 60 Hz virtual vsync. the pacer has to
+// start the frames in time for their deadlines, but not a period early.
+// the bounds are loose, the machine running the test is not idle.
+int main()
+{
+  unsigned const frames = 120;
+  unsigned const warm_up = 8;
+
+  diw::frame_pacer pacer(std::chrono::microseconds(16667), true);
+
+  std::mt19937                        random(1);
+  std::uniform_int_distribution<int>  work_us(2000, 4000);
+
+  double          lead_ms = 0.0;
+  diw::time_point last_deadline;
+  bool            ordered = true;
+
+  for (unsigned i = 0; i < frames; ++i) {
+    pacer.wait_for_start();
+    pacer.begin_work();
+
+    diw::time_point const begin = diw::clock::now();
+    if (i >= warm_up) {
+      lead_ms += diw::to_milliseconds(pacer.deadline() - begin);
+    }
+    ordered = ordered && pacer.deadline() > last_deadline;
+    last_deadline = pacer.deadline();
+
+    // busy, a sleep would overshoot by more than the work varies
+    diw::time_point const end = begin + std::chrono::microseconds(work_us(random));
+    while (diw::clock::now() < end) {
+    }
+
+    pacer.end_work();
+    pacer.wait_for_deadline();
+    pacer.presented(diw::clock::now());
+  }
+
+  pacer.write_report(std::cout);
+
+  double const mean_lead_ms = lead_ms / double(frames - warm_up);
+  std::cout << "mean lead " << mean_lead_ms << " ms" << std::endl;
+
+  bool ok = true;
+  if (!ordered) {
+    std::cerr << "deadlines did not increase" << std::endl;
+    ok = false;
+  }
+  if (pacer.missed() > frames / 10) {
+    std::cerr << pacer.missed() << " of " << frames << " deadlines missed" << std::endl;
+    ok = false;
+  }
+  // at least the work, well short of a period
+  if (mean_lead_ms < 2.0 || mean_lead_ms > 12.0) {
+    std::cerr << "frames start " << mean_lead_ms << " ms before their deadline" << std::endl;
+    ok = false;
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,107 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <diw/sync/pose_ring.h>
+
+namespace {
+
+// pose i carries i in every field, a torn copy mixes two of them
+void make_pose(std::uint64_t i, diw::time_point& t, scm::math::mat4f& view, diw::input_stamp& input)
+{
+  t = diw::time_point(diw::duration(std::int64_t(i)));
+  for (int k = 0; k < 16; ++k) {
+    view.data_array[k] = float(i % 1000003) + float(k);
+  }
+  input = diw::input_stamp(i, t);
+}
+
+bool consistent(diw::pose_sample const& p, std::uint64_t& i)
+{
+  i = p.input.sequence;
+  if (p.time.time_since_epoch().count() != std::int64_t(i) || p.input.time != p.time) {
+    return false;
+  }
+  for (int k = 0; k < 16; ++k) {
+    if (p.view.data_array[k] != float(i % 1000003) + float(k)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+// one writer pushes poses as fast as it can, three readers latch and read
+// the history meanwhile. no copy may be torn, latches may not go back in
+// time and read(i) has to return pose i or fail.
+int main()
+{
+  std::uint64_t const poses = 2000000;
+  unsigned const      readers = 3;
+
+  diw::pose_ring ring(64);
+
+  std::atomic<bool>           done(false);
+  std::atomic<std::uint64_t>  torn(0);
+  std::atomic<std::uint64_t>  backwards(0);
+  std::atomic<std::uint64_t>  misread(0);
+  std::atomic<std::uint64_t>  latches(0);
+
+  std::vector<std::thread> threads;
+  for (unsigned r = 0; r < readers; ++r) {
+    threads.emplace_back([&] {
+      std::uint64_t last = 0;
+      std::uint64_t count = 0;
+      diw::pose_sample p;
+
+      while (!done.load(std::memory_order_acquire)) {
+        std::uint64_t i;
+        if (ring.latch(p)) {
+          ++count;
+          if (!consistent(p, i)) {
+            torn.fetch_add(1);
+          }
+          else if (i < last) {
+            backwards.fetch_add(1);
+          }
+          else {
+            last = i;
+          }
+        }
+
+        // a pose somewhere in the history, likely overwritten during the copy
+        std::uint64_t const written = ring.written();
+        if (written > 8) {
+          std::uint64_t const wanted = written - 8;
+          if (ring.read(wanted, p) && (!consistent(p, i) || i != wanted + 1)) {
+            misread.fetch_add(1);
+          }
+        }
+      }
+      latches.fetch_add(count);
+    });
+  }
+
+  for (std::uint64_t i = 1; i <= poses; ++i) {
+    diw::time_point   t;
+    scm::math::mat4f  view;
+    diw::input_stamp  input;
+    make_pose(i, t, view, input);
+    ring.push(t, view, input);
+  }
+  done.store(true, std::memory_order_release);
+
+  for (std::thread& t : threads) {
+    t.join();
+  }
+
+  std::cout << poses << " poses, " << latches.load() << " latches, "
+            << torn.load() << " torn, " << backwards.load() << " backwards, "
+            << misread.load() << " misread" << std::endl;
+
+  return torn.load() == 0 && backwards.load() == 0 && misread.load() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <diw/capture/capture_reader.h>
+#include <diw/core/clock.h>
+#include <diw/core/options.h>
+#include <diw/core/reference_frame.h>
+#include <diw/profiling/profile_zone.h>
+#include <diw/profiling/profiler.h>
+#include <diw/warp/backward_warp.h>
+#include <diw/warp/forward_warp.h>
+#include <diw/warp/hole_filler.h>
+#include <diw/warp/warp_target.h>
+
+// replays a capture written by simple_async_copy_async --capture through the
+// cpu warp. every frame is warped to the camera of the frame after it and
+// compared against what the slow client actually rendered there.
+//
+//   example_capture_replay.out <capture> [--speed <factor>] [--threads <n>] [--trace <file>]
+//                              [--warp forward|backward] [--fill]
+//
+// speed 0 (default) replays as fast as possible, 1 at the captured rate.
+// --fill push-pull fills the holes before comparing, filled pixels count
+// towards the error, the holes reported are the ones left.
+// DIW_SIMD=scalar|sse4|avx2 caps the splat kernel.
+
+namespace {
+
+struct warp_error {
+  warp_error()
+    : pixels(0)
+    , holes(0)
+    , filled(0)
+    , abs_error(0)
+  {}
+
+  std::uint64_t pixels;
+  std::uint64_t holes;
+  std::uint64_t filled;
+  std::uint64_t abs_error;    // summed over rgb of the covered pixels
+};
+
+void compare(diw::warp_target const& warped, diw::reference_frame const& truth, warp_error& e)
+{
+  std::size_t const count = std::min(warped.color.size(), truth.color.size());
+
+  for (std::size_t i = 0; i < count; ++i) {
+    ++e.pixels;
+    if (warped.is_hole(i)) {
+      ++e.holes;
+      continue;
+    }
+    std::uint32_t a = warped.color[i];
+    std::uint32_t b = truth.color[i];
+    for (int c = 0; c < 24; c += 8) {
+      e.abs_error += std::uint64_t(std::abs(int((a >> c) & 0xff) - int((b >> c) & 0xff)));
+    }
+  }
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc < 2 || argv[1][0] == '-') {
+    std::cerr << "usage: " << argv[0] << " <capture> [--speed <factor>] [--threads <n>] [--trace <file>]"
+              << " [--warp forward|backward] [--fill]" << std::endl;
+    return (-1);
+  }
+
+  diw::capture_reader capture;
+  if (!capture.open(argv[1])) {
+    std::cerr << "Failed to open capture " << argv[1] << std::endl;
+    return (-1);
+  }
+  if (capture.frame_count() < 2) {
+    std::cerr << "Capture needs at least two frames" << std::endl;
+    return (-1);
+  }
+
+  double   speed   = std::atof(diw::option_value(argc, argv, "--speed", "0").c_str());
+  unsigned threads = unsigned(std::atoi(diw::option_value(argc, argv, "--threads", "0").c_str()));
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  bool const backward = diw::option_value(argc, argv, "--warp") == "backward";
+  bool const fill     = diw::has_option(argc, argv, "--fill");
+
+  diw::profiler       replay_profiler;
+  diw::forward_warp   warp(backward ? 1 : threads);
+  diw::backward_warp  inverse_warp(backward ? threads : 1);
+  diw::hole_filler    filler(fill ? threads : 1);
+  diw::warp_target    target;
+  warp_error          error;
+
+  replay_profiler.name_current_thread("replay");
+
+  // double buffered, frame i is the reference for frame i + 1
+  diw::reference_frame frames[2];
+
+  if (!capture.read(0, frames[0])) {
+    std::cerr << "Corrupt frame 0" << std::endl;
+    return (-1);
+  }
+
+  std::int64_t const first_ns = capture.frame_header(0)->timestamp_ns;
+  diw::time_point const start = diw::clock::now();
+
+  for (std::uint64_t i = 1; i < capture.frame_count(); ++i) {
+    diw::profile_zone frame_zone(replay_profiler, nullptr, "frame");
+
+    capture.prefetch(i + 1);
+
+    diw::reference_frame const& reference = frames[(i - 1) % 2];
+    diw::reference_frame&       next      = frames[i % 2];
+
+    {
+      diw::profile_zone zone(replay_profiler, nullptr, "read");
+      if (!capture.read(i, next)) {
+        std::cerr << "Corrupt frame " << i << std::endl;
+        return (-1);
+      }
+    }
+
+    if (speed > 0.0) {
+      std::int64_t ns = capture.frame_header(i)->timestamp_ns - first_ns;
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<diw::duration>(std::chrono::nanoseconds(std::int64_t(double(ns) / speed))));
+    }
+
+    {
+      diw::profile_zone zone(replay_profiler, nullptr, "warp");
+      if (backward) {
+        inverse_warp.warp(reference, next.projection_matrix, next.view_matrix, next.size, target);
+      }
+      else {
+        warp.warp(reference, next.projection_matrix, next.view_matrix, next.size, target);
+      }
+    }
+
+    if (fill) {
+      diw::profile_zone zone(replay_profiler, nullptr, "fill");
+      error.filled += filler.fill(target);
+    }
+
+    compare(target, next, error);
+  }
+
+  double const seconds = diw::to_milliseconds(diw::clock::now() - start) / 1000.0;
+
+  std::cout << "Replayed " << capture.frame_count() - 1 << " warps in " << seconds << " s ("
+            << double(capture.frame_count() - 1) / seconds << " fps) on " << threads << " threads, "
+            << (backward ? "backward" : diw::simd_level_name(warp.simd())) << " warp" << std::endl;
+
+  std::uint64_t covered = error.pixels - error.holes;
+  std::cout << std::fixed << std::setprecision(3)
+            << "Holes: " << 100.0 * double(error.holes) / double(std::max<std::uint64_t>(error.pixels, 1)) << " %, "
+            << "mean abs error: " << double(error.abs_error) / double(std::max<std::uint64_t>(covered, 1) * 3) << " / 255" << std::endl;
+  if (fill) {
+    std::cout << "Filled: " << 100.0 * double(error.filled) / double(std::max<std::uint64_t>(error.pixels, 1)) << " %" << std::endl;
+  }
+
+  replay_profiler.write_report(std::cout);
+
+  std::string trace_file = diw::option_value(argc, argv, "--trace");
+  if (!trace_file.empty() && !replay_profiler.write_chrome_trace(trace_file)) {
+    std::cerr << "Failed to write trace " << trace_file << std::endl;
+  }
+
+  return (0);
+}
@@ -2,6 +2,8 @@
 // Copyright (c) 2012 Christopher Lux <christopherlux@gmail.com>
 // Distributed under the Modified BSD License, see license.txt.
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -12,8 +14,8 @@
 #include <windows.h>
 #endif
 
+#include <atomic>
 #include <thread>
-#include <mutex>
 
 #include <boost/log/trivial.hpp>
 
@@ -30,17 +32,122 @@
 #include <scm/gl_util/manipulators/trackball_manipulator.h>
 #include <scm/gl_util/primitives/box.h>
 #include <scm/gl_util/primitives/quad.h>
-#include <scm/gl_util/primitives/wavefront_obj.h>
+
+#include <diw/benchmark/benchmark.h>
+#include <diw/benchmark/camera_path.h>
+#include <diw/capture/capture_writer.h>
+#include <diw/context/context_provider.h>
+#include <diw/core/clock.h>
+#include <diw/core/input_stamp.h>
+#include <diw/core/options.h>
+#include <diw/core/pose_predictor.h>
+#include <diw/core/reference_frame.h>
+#include <diw/gl/mesh_geometry.h>
+#include <diw/gl/pbo_readback_ring.h>
+#include <diw/logging/async_logger.h>
+#include <diw/profiling/gpu_timer.h>
+#include <diw/profiling/latency_tracker.h>
+#include <diw/profiling/profile_zone.h>
+#include <diw/profiling/profiler.h>
+#include <diw/sync/frame_mailbox.h>
+#include <diw/sync/frame_pacer.h>
+#include <diw/sync/pose_ring.h>
+#include <diw/warp/backward_warp.h>
+#include <diw/warp/forward_warp.h>
+#include <diw/warp/hole_filler.h>
+#include <diw/warp/quadtree_mesh.h>
+#include <diw/warp/reference_fusion.h>
+#include <diw/warp/reprojection.h>
+#include <diw/warp/warp_target.h>
 
 #include <GLFW/glfw3.h>
 
 struct window_group {
-  GLFWwindow* window = nullptr;
-  GLFWwindow* offscreen_window = nullptr;
+  std::shared_ptr<diw::context_provider> contexts;
+  // one per slow worker, created before the threads start and only ever
+  // retried by the thread of its worker
+  std::vector<diw::context_id> offscreen_contexts;
 };
 
 std::shared_ptr<window_group> windows = nullptr;
-std::mutex texture_write;
+diw::profiler frame_profiler;
+diw::latency_tracker motion_to_photon;
+
+// set by --benchmark and --record-path
+std::unique_ptr<diw::benchmark> benchmark_run;
+std::unique_ptr<diw::camera_path> recorded_path;
+
+// set by --capture, reference frames to disk
+std::unique_ptr<diw::capture_writer> frame_capture;
+
+// set by --pace and --refresh <hz>, the fast client starts every frame just
+// in time for its vsync deadline instead of right after the last one
+std::unique_ptr<diw::frame_pacer> frame_pacing;
+
+// set by --slices <n>, beam racing. the fast client warps the window in n
+// horizontal slices from the top, each with the newest pose right before
+// it scans out, and draws them straight to the front buffer.
+unsigned warp_slices = 1;
+static unsigned const max_warp_slices = 32;
+
+// set by --input-rate <hz>, how often the input thread applies the newest
+// pointer state to the trackball and pushes the pose, independent of how
+// often the fast client polls events
+double input_rate = 1000.0;
+
+// set by --predict velocity|kalman, the slow client renders at the pose
+// predicted for when the fast client warps its frame
+std::unique_ptr<diw::pose_predictor> pose_prediction;
+
+// set by --warp forward|backward|mesh. backward is the crack free inverse
+// warp, mesh has the slow client mesh its depth and the fast client
+// rasterize that mesh instead of warping on the cpu.
+enum warp_mode {
+  warp_forward,
+  warp_backward,
+  warp_mesh
+};
+warp_mode warping = warp_forward;
+
+// cleared by --no-fill, leaves disocclusions in the clear color
+bool hole_filling = true;
+
+// set by --layers <n>, surfaces per pixel the slow client depth peels. 1 is
+// the front surface only, every further layer is one more scene pass.
+unsigned peel_layers = 1;
+static unsigned const max_peel_layers = 4;
+
+// set by --references <n>, reference frames the fast client keeps to fill
+// what the newest one does not cover. 1 warps the newest one only.
+unsigned reference_count = 1;
+static unsigned const max_reference_count = 8;
+
+// set by --guard-band <px> and --guard-band-min <px>, border the slow
+// client renders around the window on every side. it follows how far the
+// camera turns while a frame waits to be warped, in steps between the
+// minimum and the maximum the reference targets are allocated for.
+unsigned guard_band_max = 0;
+unsigned guard_band_min = 0;
+static unsigned const guard_band_step = 16;
+
+// set by --slow-workers <n>, slow client threads, each with a shared
+// context and reference targets of its own. they render full frames at
+// poses staggered over their frame time, the fast client warps whichever
+// reference is newest.
+unsigned slow_worker_count = 1;
+static unsigned const max_slow_workers = 8;
+
+// set by --pipeline-depth <n>, target sets a slow worker keeps in flight.
+// 1 renders, resolves and reads back a frame in one go. 2 resolves and
+// reads back a frame after the next one is queued, 3 and more read back
+// one more frame later each. every stage is one more slow frame of latency,
+// in exchange the gpu, or the threads of a software rasterizer, never wait
+// on a resolve or readback for the targets they draw to.
+unsigned pipeline_depth = 1;
+static unsigned const max_pipeline_depth = 4;
+
+// window depth a peeled surface has to lie behind the one in front of it
+static float const peel_offset = 1e-5f;
 
 static int const initial_window_width = 1920;
 static int const initial_window_height = 1080;
@@ -50,6 +157,117 @@ const scm::math::vec3f specular(0.2f, 0.7f, 0.9f);
 const scm::math::vec3f ambient(0.1f, 0.1f, 0.1f);
 const scm::math::vec3f position(1, 1, 1);
 
+// what the slow client hands to the fast one, the mesh only in warp_mesh
+struct warp_reference {
+  diw::reference_frame  frame;
+  diw::reference_mesh   mesh;
+};
+
+// pointer state from the thread polling events to the input thread. only
+// the newest one arrives, the pointer at the last button change comes
+// along so a press and the drag right after it are still told apart.
+struct pointer_event {
+  diw::pointer_sample   pointer;
+  diw::pointer_sample   edge;
+  std::uint64_t         edge_sequence;
+  diw::time_point       time;
+  std::uint64_t         sequence;
+};
+
+// the targets of one frame in the slow pipeline and the camera it is
+// rendered with. a set belongs to one stage at a time:
+//   stage_free      render_to_texture() may draw to it
+//   stage_rendered  waits for the resolve, mipmaps and back layers
+//   stage_resolved  waits for its readback to be queued
+// the readback rings own the frame from there, gl orders their copy
+// before the next frame drawn to the set.
+struct target_set {
+  enum pipeline_stage {
+    stage_free,
+    stage_rendered,
+    stage_resolved
+  };
+
+  target_set() : stage(stage_free) {}
+
+  pipeline_stage                              stage;
+
+  scm::gl::texture_2d_ptr                     color_buffer;
+  scm::gl::texture_2d_ptr                     color_buffer_resolved;
+  scm::gl::texture_2d_ptr                     depth_buffer;
+  scm::gl::texture_2d_ptr                     depth_buffer_resolved;
+  scm::gl::frame_buffer_ptr                   framebuffer;
+  scm::gl::frame_buffer_ptr                   framebuffer_resolved;
+
+  // surfaces behind the front one, single sampled
+  std::vector<scm::gl::texture_2d_ptr>        peel_color;
+  std::vector<scm::gl::texture_2d_ptr>        peel_depth;
+  std::vector<scm::gl::frame_buffer_ptr>      peel_framebuffers;
+
+  // camera of the frame and its size, window plus guard band
+  diw::frame_camera                           camera;
+  scm::math::vec2ui                           reference_size;
+};
+
+// what a slow worker renders with on its own thread. programs keep their
+// uniforms, frame buffers and vertex arrays do not share between contexts,
+// so none of this is shared between workers.
+struct slow_worker {
+  explicit slow_worker(unsigned i)
+    : index(i), requested_size(0), window_size(0u, 0u), rendered_frames(0), reads(0), frame_time_ns(0) {}
+
+  // set of the frame rendered lag frames before the last one, if that is
+  // in stage s
+  target_set* frame_in_stage(unsigned lag, target_set::pipeline_stage s) {
+    if (lag >= rendered_frames) {
+      return nullptr;
+    }
+    target_set& set = targets[(rendered_frames - 1 - lag) % targets.size()];
+    return set.stage == s ? &set : nullptr;
+  }
+
+  unsigned                                    index;
+
+  scm::shared_ptr<scm::gl::render_device>     device;
+  scm::shared_ptr<scm::gl::render_context>    context;
+
+  scm::gl::program_ptr                        shader_program;
+  scm::shared_ptr<diw::mesh_geometry>         obj;
+
+  // window size posted by resize(), width << 32 | height. the worker
+  // reallocates its targets for it between frames, with its own context
+  // current, and renders with its own copy of size and projection.
+  std::atomic<std::uint64_t>                  requested_size;
+  scm::math::vec2ui                           window_size;
+  scm::math::mat4f                            projection_matrix;
+
+  // pipeline_depth sets, frame n goes to set n % pipeline_depth
+  std::vector<target_set>                     targets;
+  std::uint64_t                               rendered_frames;
+
+  scm::scoped_ptr<diw::gpu_timer>             render_timer;
+
+  // camera and read number of every readback in flight, indexed by
+  // readback slot
+  std::vector<diw::frame_camera>              readback_cameras;
+  std::vector<std::uint64_t>                  readback_reads;
+  scm::scoped_ptr<diw::pbo_readback_ring>     readback;
+  std::uint64_t                               reads;
+
+  // one readback ring per back layer, read right behind readback. a layer
+  // read can fail or time out on its own, so each slot keeps the read
+  // number of the front layer it belongs to and they are matched by it.
+  std::vector<std::shared_ptr<diw::pbo_readback_ring>>  peel_readbacks;
+  std::vector<std::vector<std::uint64_t>>               peel_reads;
+
+  // reference frames from this worker to the fast client
+  diw::frame_mailbox<warp_reference>          reference_frames;
+  scm::scoped_ptr<diw::quadtree_mesh>         mesher;
+
+  // render to readback, smoothed, in ns. the workers stagger by it.
+  std::int64_t                                frame_time_ns;
+};
+
 class demo_app
 {
 public:
@@ -68,33 +286,84 @@ public:
 
     _projection_matrix = scm::math::mat4f::identity();
 
-    _initialized = false;
+    // the ring holds a pose before any thread latches one
+    _trackball_manip.dolly(2.5f);
+    _poses.push(diw::clock::now(), _trackball_manip.transform_matrix(), _input);
+    _pointer_sequence = 0;
+    _pointer_edge_sequence = 0;
+    _applied_edge = 0;
+    _applied_pointer.store(0);
+    _warp_horizon.store(0);
+    _angular_velocity.store(0.0f);
+    _last_render_start.store(0);
+
+    for (unsigned i = 0; i < slow_worker_count; ++i) {
+      _slow_workers.emplace_back(new slow_worker(i));
+      _slow_workers.back()->requested_size.store(std::uint64_t(unsigned(_window_width)) << 32 | unsigned(_window_height));
+    }
+    _current_worker = 0;
+
+    _frame_count = 0;
+    _mesh_frame = 0;
+    _mesh_index_count = 0;
   }
   virtual ~demo_app();
 
   int window_width() const { return _window_width; };
   int window_height() const { return _window_height; };
 
-  bool initialize();
-  void initialize_framebuffer();
+  slow_worker& worker(unsigned i) { return *_slow_workers[i]; }
+
+  bool initialize(slow_worker& w);
+  bool initialize_shared_resources();
+  void initialize_framebuffer(slow_worker& w);
+  void apply_resize(slow_worker& w);
   void initialize_unshareable_resources();
 
-  void render_to_texture();
-  void postprocess_frame();
-  void render_from_texture();
+  void stagger(slow_worker& w);
+  void render_to_texture(slow_worker& w);
+  void postprocess_frame(slow_worker& w);
+  void resolve_frame(slow_worker& w, target_set& set);
+  void peel_back_layers(slow_worker& w, target_set& set);
+  void readback_reference_frame(slow_worker& w);
+  void queue_readback(slow_worker& w, target_set& set);
+  void publish_readbacks(slow_worker& w, std::uint64_t timeout_ns);
+  void acquire_back_layers(slow_worker& w, diw::reference_frame& frame, std::uint64_t read);
+  void warp_reference_frame();
+  void warp_slice(unsigned slice, unsigned slices, diw::time_point const& scan_out);
+  diw::pose_sample latch_pose();
+  diw::reference_frame const& acquire_reference_frame(diw::time_point const& now);
+  diw::reference_frame const& current_reference_frame();
+  void update_warp_horizon(diw::reference_frame const& frame, diw::time_point const& arrival);
+  void measure_rotation(scm::math::mat4f const& view, diw::time_point const& t);
+  unsigned guard_band(slow_worker const& w) const;
+  void upload_reference_mesh(warp_reference const& reference);
+  void render_from_texture(bool front_buffer = false);
+  void render_reference_mesh();
+  void frame_presented(diw::time_point const& present_time);
 
   void resize(int w, int h);
   void mouse_func(GLFWwindow* window, int button, int action, int mods);
   void mouse_motion_func(GLFWwindow* window, double xpos, double ypos);
+  void replay_pointer(diw::pointer_sample const& p);
+  void publish_pointer();
+  diw::pointer_sample pointer_state() const;
+
+  void sample_input();
+  void apply_pointer(pointer_event const& e);
+  void drag(diw::pointer_sample const& p, diw::time_point const& t);
+  void stop_input();
   void keyboard(unsigned char key, int x, int y);
 
-  bool is_initialized();
-  void set_initialized(bool flag);
+  void wait_for_initialization();
 
 private:
+  // the trackball and the drag state belong to the input thread, every
+  // other thread latches poses from _poses
   scm::gl::trackball_manipulator _trackball_manip;
   float _initx;
   float _inity;
+  std::uint64_t _applied_edge;
 
   int _window_width;
   int _window_height;
@@ -105,13 +374,11 @@ private:
 
   float _dolly_sens;
 
+  // device of the first slow worker, everything shared is created on it
   scm::shared_ptr<scm::gl::render_device>     _device;
   scm::shared_ptr<scm::gl::render_device>     _app_device;
 
   scm::shared_ptr<scm::gl::render_context>    _fast_context;
-  scm::shared_ptr<scm::gl::render_context>    _slow_context;
-
-  scm::gl::program_ptr        _shader_program;
 
   scm::gl::buffer_ptr         _index_buffer;
   scm::gl::vertex_array_ptr   _vertex_array;
@@ -119,7 +386,6 @@ private:
   scm::math::mat4f            _projection_matrix;
 
   scm::shared_ptr<scm::gl::box_geometry>  _box;
-  scm::shared_ptr<scm::gl::wavefront_obj_geometry>  _obj;
   scm::gl::depth_stencil_state_ptr     _dstate_less;
   scm::gl::depth_stencil_state_ptr     _dstate_disable;
 
@@ -134,18 +400,73 @@ private:
   scm::gl::sampler_state_ptr          _filter_nearest;
   scm::gl::sampler_state_ptr          _filter_linear;
 
-  scm::gl::texture_2d_ptr             _color_buffer;
-  scm::gl::texture_2d_ptr             _color_buffer_resolved;
-  scm::gl::texture_2d_ptr             _depth_buffer;
-  scm::gl::frame_buffer_ptr           _framebuffer;
-  scm::gl::frame_buffer_ptr           _framebuffer_resolved;
+  scm::gl::texture_2d_ptr             _warped_color;
   scm::shared_ptr<scm::gl::quad_geometry>  _quad;
   scm::gl::program_ptr                _pass_through_shader;
   scm::gl::depth_stencil_state_ptr    _depth_no_z;
   scm::gl::rasterizer_state_ptr       _ms_back_cull;
 
-  bool _initialized;
-
+  // gpu zones of the presenting pass, the slow ones are per worker
+  scm::scoped_ptr<diw::gpu_timer>     _present_timer;
+
+  // newest input the trackball pose reflects, and the inputs reflected by
+  // the presented frame: the pose it was warped to and the pose of the
+  // reference frame it was warped from
+  diw::input_stamp                    _input;
+  diw::input_stamp                    _warped_input;
+  diw::input_stamp                    _rendered_input;
+
+  // poses from the input thread to everyone else, the pointer the fast
+  // client last saw and the newest pointer event the input thread applied
+  diw::pose_ring                            _poses;
+  diw::frame_mailbox<pointer_event>         _pointer_events;
+  diw::pointer_sample                       _pointer;
+  std::uint64_t                             _pointer_sequence;
+  diw::pointer_sample                       _pointer_edge;
+  std::uint64_t                             _pointer_edge_sequence;
+  std::atomic<std::uint64_t>                _applied_pointer;
+
+  // how long after its rendering started a reference frame is warped on
+  // average, in ns, measured by the fast client for the pose prediction
+  // and the guard band
+  std::atomic<std::int64_t>           _warp_horizon;
+  diw::time_point                     _last_arrival;
+
+  // camera rotation in rad / s measured by the fast client
+  std::atomic<float>                  _angular_velocity;
+  scm::math::mat4f                    _last_view;
+  diw::time_point                     _last_view_time;
+
+  // the slow workers, the one whose reference the fast client warps, and
+  // the render start of the newest reference it took. frame ids count
+  // over all workers.
+  std::vector<std::unique_ptr<slow_worker>> _slow_workers;
+  unsigned                                  _current_worker;
+  diw::time_point                           _newest_reference;
+  std::atomic<std::uint64_t>                _frame_count;
+
+  // last time any worker started a frame, in ns of diw::clock
+  std::atomic<std::int64_t>                 _last_render_start;
+
+  scm::scoped_ptr<diw::forward_warp>  _forward_warp;
+  scm::scoped_ptr<diw::backward_warp> _backward_warp;
+  scm::scoped_ptr<diw::hole_filler>   _hole_filler;
+  diw::warp_target                    _warp_target;
+
+  // the last reference frames, swapped out of the mailbox as they arrive.
+  // its warper does the backward warp too, so pyramids are built once.
+  scm::scoped_ptr<diw::reference_fusion> _fusion;
+
+  // warp_mesh, the newest reference mesh and its color on the gpu
+  scm::gl::program_ptr                _mesh_warp_shader;
+  scm::gl::buffer_ptr                 _mesh_vertices;
+  scm::gl::buffer_ptr                 _mesh_indices;
+  scm::gl::vertex_array_ptr           _mesh_array;
+  scm::gl::texture_2d_ptr             _mesh_color;
+  diw::frame_camera                   _mesh_camera;
+  scm::math::vec2ui                   _mesh_size;
+  std::uint64_t                       _mesh_frame;
+  int                                 _mesh_index_count;
 
 }; // class demo_app
 
@@ -159,12 +480,10 @@ namespace {
 ///////////////////////////////////////////////////////////////////////////////
 demo_app::~demo_app()
 {
-  _shader_program.reset();
   _index_buffer.reset();
   _vertex_array.reset();
 
   _box.reset();
-  _obj.reset();
 
   _filter_lin_mip.reset();
   _filter_aniso.reset();
@@ -172,24 +491,41 @@ demo_app::~demo_app()
   _color_texture.reset();
 
   _filter_linear.reset();
-  _color_buffer.reset();
-  _depth_buffer.reset();
-  _framebuffer.reset();
   _quad.reset();
   _pass_through_shader.reset();
   _depth_no_z.reset();
   _ms_back_cull.reset();
-  _color_buffer_resolved.reset();
-  _framebuffer_resolved.reset();
+  _warped_color.reset();
+  _forward_warp.reset();
+  _backward_warp.reset();
+  _hole_filler.reset();
+  _fusion.reset();
+  _mesh_warp_shader.reset();
+  _mesh_vertices.reset();
+  _mesh_indices.reset();
+  _mesh_array.reset();
+  _mesh_color.reset();
+
+  _present_timer.reset();
+
+  // a mailbox slot may still lease from another worker's ring, all leases
+  // are dropped before the first ring goes away
+  for (auto const& w : _slow_workers) {
+    for (unsigned s = 0; s < diw::frame_mailbox<warp_reference>::slots; ++s) {
+      w->reference_frames.slot(s).frame.unborrow();
+    }
+  }
+
+  // every worker releases its targets before its own context and device
+  _slow_workers.clear();
 
   _fast_context.reset();
-  _slow_context.reset();
   _app_device.reset();
   _device.reset();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-bool demo_app::initialize()
+bool demo_app::initialize(slow_worker& w)
 {
   using namespace scm;
   using namespace scm::gl;
@@ -205,29 +541,67 @@ bool demo_app::initialize()
     return (false);
   }
 
-  _device.reset(new scm::gl::render_device());
+  w.device.reset(new scm::gl::render_device());
 
-  _slow_context = _device->main_context();
-  // _slow_context = _device->create_context();
+  w.context = w.device->main_context();
+  // w.context = w.device->create_context();
 
-  _shader_program = _device->create_program(list_of(_device->create_shader(STAGE_VERTEX_SHADER, vs_source))
-    (_device->create_shader(STAGE_FRAGMENT_SHADER, fs_source)));
+  w.shader_program = w.device->create_program(list_of(w.device->create_shader(STAGE_VERTEX_SHADER, vs_source))
+    (w.device->create_shader(STAGE_FRAGMENT_SHADER, fs_source)));
 
-  if (!_shader_program) {
+  if (!w.shader_program) {
     scm::err() << "error creating shader program" << log::end;
     return (false);
   }
 
-  _shader_program->uniform("light_ambient", ambient);
-  _shader_program->uniform("light_diffuse", diffuse);
-  _shader_program->uniform("light_specular", specular);
-  _shader_program->uniform("light_position", position);
+  w.shader_program->uniform("light_ambient", ambient);
+  w.shader_program->uniform("light_diffuse", diffuse);
+  w.shader_program->uniform("light_specular", specular);
+  w.shader_program->uniform("light_position", position);
+
+  w.shader_program->uniform("material_ambient", ambient);
+  w.shader_program->uniform("material_diffuse", diffuse);
+  w.shader_program->uniform("material_specular", specular);
+  w.shader_program->uniform("material_shininess", 128.0f);
+  w.shader_program->uniform("material_opacity", 1.0f);
+
+  // compiled to box.obj.diwmesh on the first start, mapped after that
+  w.obj.reset(new diw::mesh_geometry(w.device, "../res/geometry/box.obj"));
+  if (!w.obj->valid()) {
+    scm::err() << "error loading geometry" << log::end;
+    return false;
+  }
+
+  if (warping == warp_mesh) {
+    // meshed on the slow client, which has no cpu warp to share cores with
+    unsigned const cores = std::max(std::thread::hardware_concurrency() / slow_worker_count, 2u);
+    w.mesher.reset(new diw::quadtree_mesh(cores - 1));
+  }
+
+  // the first worker creates what the others and the fast client share,
+  // they wait for its first frame before they start
+  if (w.index == 0) {
+    _device = w.device;
+    if (!initialize_shared_resources()) {
+      return (false);
+    }
+  }
 
-  _shader_program->uniform("material_ambient", ambient);
-  _shader_program->uniform("material_diffuse", diffuse);
-  _shader_program->uniform("material_specular", specular);
-  _shader_program->uniform("material_shininess", 128.0f);
-  _shader_program->uniform("material_opacity", 1.0f);
+  apply_resize(w);
+
+  return (true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool demo_app::initialize_shared_resources()
+{
+  using namespace scm;
+  using namespace scm::gl;
+  using namespace scm::math;
+  using boost::assign::list_of;
+
+  std::string vs_source;
+  std::string fs_source;
 
   scm::out() << *_device << scm::log::end;
 
@@ -274,7 +648,6 @@ bool demo_app::initialize()
     EQ_FUNC_ADD, EQ_FUNC_ADD, COLOR_GREEN | COLOR_BLUE);
 
   _box.reset(new box_geometry(_device, vec3f(-0.5f), vec3f(0.5f)));
-  _obj.reset(new wavefront_obj_geometry(_device, "../res/geometry/box.obj"));
 
   texture_loader tex_loader;
   _color_texture = tex_loader.load_texture_2d(*_device,
@@ -298,30 +671,90 @@ bool demo_app::initialize()
   _pass_through_shader = _device->create_program(list_of(_device->create_shader(STAGE_VERTEX_SHADER, vs_source))
     (_device->create_shader(STAGE_FRAGMENT_SHADER, fs_source)));
 
+  if (warping == warp_mesh) {
+    if (!io::read_text_file("../res/shaders/mesh_warp.glslv", vs_source)
+      || !io::read_text_file("../res/shaders/mesh_warp.glslf", fs_source)) {
+      scm::err() << "error reading shader files" << log::end;
+      return (false);
+    }
 
-  _trackball_manip.dolly(2.5f);
+    _mesh_warp_shader = _device->create_program(list_of(_device->create_shader(STAGE_VERTEX_SHADER, vs_source))
+      (_device->create_shader(STAGE_FRAGMENT_SHADER, fs_source)));
 
-  initialize_framebuffer();
+    if (!_mesh_warp_shader) {
+      scm::err() << "error creating shader program" << log::end;
+      return (false);
+    }
+  }
 
   // _initialized = true;
   return (true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void demo_app::initialize_framebuffer() 
+void demo_app::initialize_framebuffer(slow_worker& w) 
 {
   using namespace scm::gl;
   using namespace scm::math;
 
-  _color_buffer = _device->create_texture_2d(vec2ui(_window_width, _window_height) * 1, FORMAT_RGBA_8, 1, 1, 8);
-  _depth_buffer = _device->create_texture_2d(vec2ui(_window_width, _window_height) * 1, FORMAT_D24, 1, 1, 8);
-  _framebuffer = _device->create_frame_buffer();
-  _framebuffer->attach_color_buffer(0, _color_buffer);
-  _framebuffer->attach_depth_stencil_buffer(_depth_buffer);
+  // room for the widest guard band, every frame renders and reads back
+  // only the part its band needs from the lower left corner
+  vec2ui const size(w.window_size.x + 2 * guard_band_max, w.window_size.y + 2 * guard_band_max);
+
+  // sized once, a resize only replaces the targets. it runs between two
+  // frames of the worker, frames still in flight in the old targets are
+  // dropped: every set goes back to stage_free below and no stage picks
+  // them up again. what was read back already lives in the readback ring.
+  if (w.targets.empty()) {
+    w.targets.resize(pipeline_depth);
+  }
 
-  _color_buffer_resolved = _device->create_texture_2d(vec2ui(_window_width, _window_height) * 1, FORMAT_RGBA_8);
-  _framebuffer_resolved = _device->create_frame_buffer();
-  _framebuffer_resolved->attach_color_buffer(0, _color_buffer_resolved);
+  for (target_set& set : w.targets) {
+    set.color_buffer = w.device->create_texture_2d(size, FORMAT_RGBA_8, 1, 1, 8);
+    set.depth_buffer = w.device->create_texture_2d(size, FORMAT_D24, 1, 1, 8);
+    set.framebuffer = w.device->create_frame_buffer();
+    set.framebuffer->attach_color_buffer(0, set.color_buffer);
+    set.framebuffer->attach_depth_stencil_buffer(set.depth_buffer);
+
+    set.color_buffer_resolved = w.device->create_texture_2d(size, FORMAT_RGBA_8);
+    set.framebuffer_resolved = w.device->create_frame_buffer();
+    set.framebuffer_resolved->attach_color_buffer(0, set.color_buffer_resolved);
+
+    // resolved depth is what the warp reads back, it cannot sample the multi sample buffer
+    set.depth_buffer_resolved = w.device->create_texture_2d(size, FORMAT_D24);
+    set.framebuffer_resolved->attach_depth_stencil_buffer(set.depth_buffer_resolved);
+
+    // peeled layers are single sampled, the front layer they peel against is
+    // the resolved one
+    set.peel_color.resize(peel_layers - 1);
+    set.peel_depth.resize(peel_layers - 1);
+    set.peel_framebuffers.resize(peel_layers - 1);
+    for (unsigned l = 0; l + 1 < peel_layers; ++l) {
+      set.peel_color[l] = w.device->create_texture_2d(size, FORMAT_RGBA_8);
+      set.peel_depth[l] = w.device->create_texture_2d(size, FORMAT_D24);
+      set.peel_framebuffers[l] = w.device->create_frame_buffer();
+      set.peel_framebuffers[l]->attach_color_buffer(0, set.peel_color[l]);
+      set.peel_framebuffers[l]->attach_depth_stencil_buffer(set.peel_depth[l]);
+    }
+
+    set.stage = target_set::stage_free;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::apply_resize(slow_worker& w)
+{
+  std::uint64_t const requested = w.requested_size.load(std::memory_order_acquire);
+  scm::math::vec2ui const size(unsigned(requested >> 32), unsigned(requested & 0xffffffffu));
+
+  if (size.x == 0 || size.y == 0 || (size == w.window_size && !w.targets.empty())) {
+    return;
+  }
+
+  w.window_size = size;
+  scm::math::perspective_matrix(w.projection_matrix, 60.f, float(size.x) / float(size.y), 0.1f, 1000.0f);
+
+  initialize_framebuffer(w);
 }
 
 unsigned plah = 0;
@@ -339,76 +772,655 @@ void demo_app::initialize_unshareable_resources()
   _fast_context = _app_device->create_context();
 
   _quad.reset(new quad_geometry(_app_device, vec2f(0.0f, 0.0f), vec2f(1.0f, 1.0f)));
+
+  // leave one core to every slow worker
+  unsigned warp_threads = std::max(std::thread::hardware_concurrency(), slow_worker_count + 1) - slow_worker_count;
+  if (reference_count > 1 && warping != warp_mesh) {
+    _fusion.reset(new diw::reference_fusion(reference_count, warp_threads));
+  }
+  if (warping == warp_backward && !_fusion) {
+    _backward_warp.reset(new diw::backward_warp(warp_threads));
+  }
+  else if (warping == warp_forward) {
+    _forward_warp.reset(new diw::forward_warp(warp_threads));
+  }
+  if (hole_filling && warping != warp_mesh && warp_slices == 1) {
+    _hole_filler.reset(new diw::hole_filler(warp_threads));
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void demo_app::render_to_texture()
+void demo_app::stagger(slow_worker& w)
+{
+  if (_slow_workers.size() < 2 || w.frame_time_ns == 0) {
+    return;
+  }
+
+  // a frame starts no sooner than a frame time / n after the last start of
+  // any worker, the references arrive spread evenly instead of n at once
+  std::int64_t const interval = w.frame_time_ns / std::int64_t(_slow_workers.size());
+  std::int64_t       last = _last_render_start.load();
+
+  for (;;) {
+    std::int64_t const now = std::chrono::duration_cast<std::chrono::nanoseconds>(diw::clock::now().time_since_epoch()).count();
+    if (now - last < interval) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(interval - (now - last)));
+      last = _last_render_start.load();
+    }
+    else if (_last_render_start.compare_exchange_weak(last, now)) {
+      return;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::render_to_texture(slow_worker& w)
 {
   using namespace scm::gl;
   using namespace scm::math;
 
+  if (!w.render_timer) {
+    w.render_timer.reset(new diw::gpu_timer(frame_profiler, w.context));
+  }
+  w.render_timer->collect();
+
+  diw::profile_zone zone(frame_profiler, w.render_timer.get(), "render_to_texture");
+
+  // frames in flight keep their sets until read back. the set holds the
+  // oldest frame in flight, which would be read back next anyway.
+  target_set& set = w.targets[w.rendered_frames % w.targets.size()];
+  if (set.stage != target_set::stage_free) {
+    DIW_LOG_EVERY(warning, 1000, "Slow pipeline target set still in flight, reading its frame back first.");
+    if (set.stage == target_set::stage_rendered) {
+      resolve_frame(w, set);
+    }
+    queue_readback(w, set);
+  }
+
   // clear the color and depth buffer
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-  mat4f    view_matrix = _trackball_manip.transform_matrix();
+  diw::pose_sample pose;
+  _poses.latch(pose);
+
+  diw::input_stamp input = pose.input;
+  diw::time_point  render_start = diw::clock::now();
+  mat4f    view_matrix = pose.view;
+  if (pose_prediction && pose_prediction->has_samples()) {
+    view_matrix = pose_prediction->predict(render_start + std::chrono::nanoseconds(_warp_horizon.load()));
+  }
   mat4f    model_matrix = mat4f::identity();
   mat4f    model_view_matrix = view_matrix * model_matrix;
   mat4f    mv_inv_transpose = transpose(inverse(model_view_matrix));
 
-  _shader_program->uniform("projection_matrix", _projection_matrix);
-  _shader_program->uniform("model_view_matrix", model_view_matrix);
-  _shader_program->uniform("model_view_matrix_inverse_transpose", mv_inv_transpose);
-  _shader_program->uniform_sampler("color_texture_aniso", 0);
-  _shader_program->uniform_sampler("color_texture_nearest", 1);
+  // the warp sees a larger frame with a wider projection, nothing else
+  unsigned const guard = guard_band(w);
+  mat4f    projection_matrix = diw::guard_band_projection(w.projection_matrix, w.window_size, guard);
+  set.reference_size = w.window_size + vec2ui(2 * guard, 2 * guard);
 
-  _slow_context->clear_default_color_buffer(FRAMEBUFFER_BACK, vec4f(.2f, .2f, .2f, 1.0f));
-  _slow_context->clear_default_depth_stencil_buffer();
+  // remember the camera this frame is rendered with for the warp
+  set.camera.projection_matrix = projection_matrix;
+  set.camera.view_matrix = view_matrix;
+  set.camera.timestamp = render_start;
+  set.camera.input = input;
 
-  _slow_context->reset();
+  w.shader_program->uniform("projection_matrix", projection_matrix);
+  w.shader_program->uniform("model_view_matrix", model_view_matrix);
+  w.shader_program->uniform("model_view_matrix_inverse_transpose", mv_inv_transpose);
+  w.shader_program->uniform_sampler("color_texture_aniso", 0);
+  w.shader_program->uniform_sampler("color_texture_nearest", 1);
+  w.shader_program->uniform_sampler("peel_depth", 2);
+  w.shader_program->uniform("peel", 0);
+
+  w.context->clear_default_color_buffer(FRAMEBUFFER_BACK, vec4f(.2f, .2f, .2f, 1.0f));
+  w.context->clear_default_depth_stencil_buffer();
+
+  w.context->reset();
 
   // multi sample pass
   { 
-    context_state_objects_guard csg(_slow_context);
-    context_texture_units_guard tug(_slow_context);
-    context_framebuffer_guard   fbg(_slow_context);
+    context_state_objects_guard csg(w.context);
+    context_texture_units_guard tug(w.context);
+    context_framebuffer_guard   fbg(w.context);
 
-    _slow_context->clear_default_color_buffer(FRAMEBUFFER_BACK, vec4f(.2f, .2f, .2f, 1.0f));
+    w.context->clear_default_color_buffer(FRAMEBUFFER_BACK, vec4f(.2f, .2f, .2f, 1.0f));
 
-    _slow_context->clear_color_buffer(_framebuffer, 0, vec4f(.2f, .2f, .2f, 1.0f));
-    _slow_context->clear_depth_stencil_buffer(_framebuffer, 1.0);
-    _slow_context->set_frame_buffer(_framebuffer);
+    w.context->clear_color_buffer(set.framebuffer, 0, vec4f(.2f, .2f, .2f, 1.0f));
+    w.context->clear_depth_stencil_buffer(set.framebuffer, 1.0);
+    w.context->set_frame_buffer(set.framebuffer);
 
-    _slow_context->set_viewport(viewport(vec2ui(0, 0), 1 * vec2ui(_window_width, _window_height)));
+    w.context->set_viewport(viewport(vec2ui(0, 0), set.reference_size));
 
-    _slow_context->set_depth_stencil_state(_dstate_less);
-    _slow_context->set_blend_state(_no_blend);
-    _slow_context->set_rasterizer_state(_ms_back_cull);
+    w.context->set_depth_stencil_state(_dstate_less);
+    w.context->set_blend_state(_no_blend);
+    w.context->set_rasterizer_state(_ms_back_cull);
 
-    _slow_context->bind_program(_shader_program);
+    w.context->bind_program(w.shader_program);
 
-    _slow_context->bind_texture(_color_texture, _filter_aniso, 0);
-    _slow_context->bind_texture(_color_texture, _filter_nearest, 1);
+    w.context->bind_texture(_color_texture, _filter_aniso, 0);
+    w.context->bind_texture(_color_texture, _filter_nearest, 1);
 
-    _obj->draw(_slow_context);
+    w.obj->draw(w.context);
   }
 
+  set.stage = target_set::stage_rendered;
+  ++w.rendered_frames;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::postprocess_frame(slow_worker& w)
+{
+  // in a pipeline the frame before the one just rendered, its resolve is queued
+  // behind the next frame instead of in front of it
+  if (target_set* set = w.frame_in_stage(pipeline_depth > 1 ? 1 : 0, target_set::stage_rendered)) {
+    resolve_frame(w, *set);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void demo_app::postprocess_frame()
+void demo_app::resolve_frame(slow_worker& w, target_set& set)
 {
   // blit multisample texture to texture and generate mipmap pyramid
-  _slow_context->resolve_multi_sample_buffer(_framebuffer, _framebuffer_resolved);
-  _slow_context->generate_mipmaps(_color_buffer_resolved);
-  _slow_context->reset();
+  {
+    diw::profile_zone zone(frame_profiler, w.render_timer.get(), "resolve_multi_sample_buffer");
+    w.context->resolve_multi_sample_buffer(set.framebuffer, set.framebuffer_resolved);
+  }
+  {
+    diw::profile_zone zone(frame_profiler, w.render_timer.get(), "generate_mipmaps");
+    w.context->generate_mipmaps(set.color_buffer_resolved);
+  }
+  w.context->reset();
+
+  peel_back_layers(w, set);
+
+  set.stage = target_set::stage_resolved;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::peel_back_layers(slow_worker& w, target_set& set)
+{
+  using namespace scm::gl;
+  using namespace scm::math;
+
+  if (set.peel_framebuffers.empty()) {
+    return;
+  }
+
+  diw::profile_zone zone(frame_profiler, w.render_timer.get(), "peel_back_layers");
+
+  // in a pipeline a later front pass has set its camera since
+  mat4f const model_view_matrix = set.camera.view_matrix;
+  w.shader_program->uniform("projection_matrix", set.camera.projection_matrix);
+  w.shader_program->uniform("model_view_matrix", model_view_matrix);
+  w.shader_program->uniform("model_view_matrix_inverse_transpose", transpose(inverse(model_view_matrix)));
+
+  {
+    context_state_objects_guard csg(w.context);
+    context_texture_units_guard tug(w.context);
+    context_framebuffer_guard   fbg(w.context);
+
+    w.context->set_viewport(viewport(vec2ui(0, 0), set.reference_size));
+
+    w.context->set_depth_stencil_state(_dstate_less);
+    w.context->set_blend_state(_no_blend);
+    w.context->set_rasterizer_state(_ms_back_cull);
+
+    w.shader_program->uniform("peel", 1);
+    w.shader_program->uniform("peel_offset", peel_offset);
+    w.context->bind_program(w.shader_program);
+
+    w.context->bind_texture(_color_texture, _filter_aniso, 0);
+    w.context->bind_texture(_color_texture, _filter_nearest, 1);
+
+    for (std::size_t l = 0; l < set.peel_framebuffers.size(); ++l) {
+      texture_2d_ptr const& front = l == 0 ? set.depth_buffer_resolved : set.peel_depth[l - 1];
+
+      w.context->clear_color_buffer(set.peel_framebuffers[l], 0, vec4f(.2f, .2f, .2f, 1.0f));
+      w.context->clear_depth_stencil_buffer(set.peel_framebuffers[l], 1.0);
+      w.context->set_frame_buffer(set.peel_framebuffers[l]);
+      w.context->bind_texture(front, _filter_nearest, 2);
+
+      w.obj->draw(w.context);
+    }
+
+    w.shader_program->uniform("peel", 0);
+  }
+
+  w.context->reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::readback_reference_frame(slow_worker& w)
+{
+  diw::profile_zone zone(frame_profiler, w.render_timer.get(), "readback_reference_frame");
+
+  // the oldest set in flight, the ring owns the frame from here on
+  if (target_set* set = w.frame_in_stage(pipeline_depth - 1, target_set::stage_resolved)) {
+    queue_readback(w, *set);
+  }
+
+  publish_readbacks(w, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::queue_readback(slow_worker& w, target_set& set)
+{
+  if (!w.readback) {
+    // a slot stays taken while a frame borrows it: the reads in flight, the
+    // frames in this worker's mailbox and the references the fusion keeps.
+    // a frame leaving the fusion is released, it never parks in the mailbox
+    // of another worker.
+    std::size_t const slots = 2 + diw::frame_mailbox<warp_reference>::slots + (reference_count > 1 ? reference_count : 0);
+    w.readback.reset(new diw::pbo_readback_ring(w.context, slots));
+    w.readback_cameras.resize(w.readback->slots());
+    w.readback_reads.resize(w.readback->slots(), 0);
+
+    // back layers are packed and released right away, they only need the
+    // reads in flight
+    for (unsigned l = 0; l + 1 < peel_layers; ++l) {
+      w.peel_readbacks.push_back(std::make_shared<diw::pbo_readback_ring>(w.context));
+      w.peel_reads.push_back(std::vector<std::uint64_t>(w.peel_readbacks.back()->slots(), 0));
+    }
+  }
+
+  // with every slot in flight wait for the oldest, that bounds the latency
+  // to slots - 1 frames instead of skipping the newest
+  if (!w.readback->can_read()) {
+    publish_readbacks(w, std::uint64_t(100) * 1000 * 1000);
+  }
+
+  std::size_t slot = w.readback->read(set.framebuffer_resolved, set.reference_size);
+  if (slot == diw::pbo_readback_ring::npos) {
+    DIW_LOG_EVERY(warning, 1000, "Readback slots all borrowed by reference frames, dropping a frame.");
+  }
+  else {
+    w.readback_cameras[slot] = set.camera;
+    w.readback_reads[slot] = ++w.reads;
+
+    for (std::size_t l = 0; l < w.peel_readbacks.size(); ++l) {
+      std::size_t const layer_slot = w.peel_readbacks[l]->read(set.peel_framebuffers[l], set.reference_size);
+      if (layer_slot != diw::pbo_readback_ring::npos) {
+        w.peel_reads[l][layer_slot] = w.reads;
+      }
+    }
+  }
+  set.stage = target_set::stage_free;
+
+  w.context->reset();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void demo_app::render_from_texture()
+void demo_app::publish_readbacks(slow_worker& w, std::uint64_t timeout_ns)
+{
+  diw::pbo_readback_ring::frame readback;
+
+  while (w.readback->acquire(readback, timeout_ns)) {
+    diw::reference_frame& frame = w.reference_frames.back().frame;
+
+    // the frame borrows the mapped slot instead of copying it, the slot goes
+    // back to the ring once the last holder of the frame let go of it: the
+    // mailbox, the fusion or the fast client
+    diw::pbo_readback_ring* ring = w.readback.get();
+    std::shared_ptr<void const> lease(readback.color, [ring, readback](void const*) { ring->release(readback); });
+    frame.borrow(readback.size, readback.color, readback.depth, lease);
+    static_cast<diw::frame_camera&>(frame) = w.readback_cameras[readback.slot];
+
+    frame.frame_id = ++_frame_count;
+
+    if (!w.peel_readbacks.empty()) {
+      acquire_back_layers(w, frame, w.readback_reads[readback.slot]);
+    }
+
+    if (frame_capture) {
+      frame_capture->submit(frame);
+    }
+
+    if (w.mesher) {
+      diw::profile_zone zone(frame_profiler, nullptr, "extract_mesh");
+      w.mesher->build(frame, w.reference_frames.back().mesh);
+    }
+
+    w.reference_frames.publish();
+
+    // the mailbox slot handed back holds a frame the fast client skipped or
+    // is done with, its readback slot can go back to the ring
+    w.reference_frames.back().frame.unborrow();
+
+    // one blocking wait per call is enough
+    timeout_ns = 0;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::acquire_back_layers(slow_worker& w, diw::reference_frame& frame, std::uint64_t read)
+{
+  diw::profile_zone zone(frame_profiler, nullptr, "pack_back_layers");
+
+  // read right behind the front layer, their fences follow within the frame
+  std::uint64_t const timeout_ns = std::uint64_t(1000) * 1000 * 1000;
+
+  diw::pbo_readback_ring::frame layers[max_peel_layers];
+  std::uint32_t const*          colors[max_peel_layers];
+  float const*                  depths[max_peel_layers];
+  bool                          acquired[max_peel_layers] = {};
+
+  // every ring is synced to the front read on its own: layers of older
+  // reads, left queued by a timeout, are drained, a layer of a later read
+  // stays queued for its own frame
+  std::size_t count = 0;
+  for (std::size_t l = 0; l < w.peel_readbacks.size(); ++l) {
+    diw::pbo_readback_ring& ring = *w.peel_readbacks[l];
+
+    for (;;) {
+      std::size_t const next = ring.next_queued();
+      if (next == diw::pbo_readback_ring::npos || w.peel_reads[l][next] > read) {
+        break;
+      }
+      if (!ring.acquire(layers[l], timeout_ns)) {
+        break;
+      }
+      if (w.peel_reads[l][layers[l].slot] == read) {
+        acquired[l] = true;
+        break;
+      }
+      ring.release(layers[l]);
+    }
+
+    if (acquired[l]) {
+      colors[count] = layers[l].color;
+      depths[count] = layers[l].depth;
+      ++count;
+    }
+  }
+
+  if (count == w.peel_readbacks.size() && layers[0].size == frame.size) {
+    frame.back_layers.pack(colors, depths, unsigned(count), frame.size);
+  }
+  else {
+    DIW_LOG_EVERY(warning, 1000, "Back layers of frame %llu missing, warping the front layer only.",
+                  static_cast<unsigned long long>(frame.frame_id));
+    frame.back_layers.clear();
+  }
+
+  for (std::size_t l = 0; l < w.peel_readbacks.size(); ++l) {
+    if (acquired[l]) {
+      w.peel_readbacks[l]->release(layers[l]);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::warp_reference_frame()
 {
   using namespace scm::gl;
   using namespace scm::math;
 
+  diw::time_point const now = diw::clock::now();
+  diw::reference_frame const& frame = acquire_reference_frame(now);
+
+  // the newest pose right before it is used
+  diw::pose_sample const pose = latch_pose();
+  mat4f const view_matrix = pose.view;
+
+  if (frame.empty()) {
+    return;
+  }
+
+  vec2ui size(_window_width, _window_height);
+
+  diw::profile_zone zone(frame_profiler, nullptr, "warp_reference_frame");
+
+  _warped_input = pose.input;
+  _rendered_input = frame.input;
+
+  if (warping == warp_mesh) {
+    upload_reference_mesh(_slow_workers[_current_worker]->reference_frames.front());
+    return;
+  }
+
+  diw::backward_warp* backward = _fusion && warping == warp_backward ? &_fusion->warper() : _backward_warp.get();
+  if (backward) {
+    backward->warp(frame, _projection_matrix, view_matrix, size, _warp_target);
+  }
+  else {
+    _forward_warp->warp(frame, _projection_matrix, view_matrix, size, _warp_target);
+  }
+
+  if (_fusion) {
+    diw::profile_zone fuse_zone(frame_profiler, nullptr, "fuse_references");
+    _fusion->fill(_projection_matrix, view_matrix, _warp_target);
+  }
+
+  if (_hole_filler) {
+    diw::profile_zone fill_zone(frame_profiler, nullptr, "fill_holes");
+    _hole_filler->fill(_warp_target);
+  }
+
+  if (!_warped_color || _warped_color->descriptor()._size != size) {
+    _warped_color = _app_device->create_texture_2d(size, FORMAT_RGBA_8);
+  }
+
+  _fast_context->update_sub_texture(_warped_color, texture_region(vec3ui(0u), vec3ui(size, 1u)), 0, FORMAT_RGBA_8, _warp_target.color.data());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::warp_slice(unsigned slice, unsigned slices, diw::time_point const& scan_out)
+{
+  using namespace scm::gl;
+  using namespace scm::math;
+
+  diw::time_point const now = diw::clock::now();
+
+  // a new reference only at the top, the slices of a frame share it
+  diw::reference_frame const& frame = slice == 0 ? acquire_reference_frame(now) : current_reference_frame();
+
+  diw::pose_sample const pose = latch_pose();
+  mat4f const view_matrix = pose.view;
+  diw::input_stamp const input = pose.input;
+  if (frame.empty()) {
+    return;
+  }
+
+  vec2ui size(_window_width, _window_height);
+
+  diw::profile_zone zone(frame_profiler, nullptr, "warp_slice");
+
+  // slices count from the top of the screen, rows from the bottom
+  unsigned const row_end = size.y - slice * size.y / slices;
+  unsigned const row_begin = size.y - (slice + 1) * size.y / slices;
+
+  diw::backward_warp& backward = _fusion ? _fusion->warper() : *_backward_warp;
+  backward.warp_rows(frame, _projection_matrix, view_matrix, size, row_begin, row_end, _warp_target);
+  if (_fusion) {
+    _fusion->fill(_projection_matrix, view_matrix, _warp_target, row_begin, row_end);
+  }
+
+  if (!_warped_color || _warped_color->descriptor()._size != size) {
+    _warped_color = _app_device->create_texture_2d(size, FORMAT_RGBA_8);
+  }
+
+  _fast_context->update_sub_texture(_warped_color, texture_region(vec3ui(0u, row_begin, 0u), vec3ui(size.x, row_end - row_begin, 1u)),
+                                    0, FORMAT_RGBA_8, _warp_target.color.data() + std::size_t(row_begin) * size.x);
+
+  // what the slice shows is on screen once its first row scans out
+  motion_to_photon.presented("slice " + std::to_string(slice), input, scan_out);
+  if (slice == 0) {
+    motion_to_photon.presented("rendered", frame.input, scan_out);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+diw::pose_sample demo_app::latch_pose()
+{
+  // timed when the input thread sampled it, the prediction and the
+  // rotation measure skip a pose latched twice
+  diw::pose_sample pose;
+  _poses.latch(pose);
+
+  if (pose_prediction) {
+    pose_prediction->sample(pose.time, pose.view);
+  }
+  if (guard_band_max > 0) {
+    measure_rotation(pose.view, pose.time);
+  }
+  return pose;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+diw::reference_frame const& demo_app::acquire_reference_frame(diw::time_point const& now)
+{
+  // newest complete frame of every worker, keeps the previous one if
+  // nothing new arrived. with fusion the frame moves on into its ring, the
+  // mailbox gets the storage of the oldest reference back.
+  slow_worker* arrived[max_slow_workers];
+  std::size_t  count = 0;
+  for (auto const& w : _slow_workers) {
+    if (w->reference_frames.acquire()) {
+      arrived[count++] = w.get();
+    }
+  }
+
+  // oldest first, the last one taken is the newest. a worker finishing
+  // after one that started later delivers a pose already behind, it is
+  // dropped.
+  std::sort(arrived, arrived + count, [](slow_worker const* a, slow_worker const* b) {
+    return a->reference_frames.front().frame.timestamp < b->reference_frames.front().frame.timestamp;
+  });
+
+  for (std::size_t i = 0; i < count; ++i) {
+    diw::reference_frame& frame = arrived[i]->reference_frames.front().frame;
+    if (frame.timestamp <= _newest_reference) {
+      continue;
+    }
+    _newest_reference = frame.timestamp;
+    _current_worker = arrived[i]->index;
+
+    update_warp_horizon(frame, now);
+    if (_fusion) {
+      _fusion->push(frame);
+      // the oldest reference swapped back may come from another worker's
+      // readback ring. it is done with, its slot goes back right here
+      // instead of sitting in this worker's mailbox.
+      frame.unborrow();
+    }
+  }
+
+  return current_reference_frame();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+diw::reference_frame const& demo_app::current_reference_frame()
+{
+  return _fusion ? _fusion->newest() : _slow_workers[_current_worker]->reference_frames.front().frame;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::update_warp_horizon(diw::reference_frame const& frame, diw::time_point const& arrival)
+{
+  // a frame is warped from its arrival until the next one arrives, the
+  // middle of that is where it is on average closest to the camera
+  diw::duration horizon = arrival - frame.timestamp;
+  if (_last_arrival != diw::time_point()) {
+    horizon += (arrival - _last_arrival) / 2;
+  }
+  _last_arrival = arrival;
+
+  std::int64_t const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(horizon).count();
+  std::int64_t const smoothed = _warp_horizon.load();
+  _warp_horizon.store(smoothed == 0 ? ns : smoothed + (ns - smoothed) / 8);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::measure_rotation(scm::math::mat4f const& view, diw::time_point const& t)
+{
+  if (_last_view_time != diw::time_point() && t > _last_view_time) {
+    float const dt = std::chrono::duration<float>(t - _last_view_time).count();
+    float const rate = diw::rotation_angle(_last_view, view) / dt;
+
+    // up at once and down slowly, a band that shrinks too early is a
+    // border of holes the next time the camera turns
+    float const smoothed = _angular_velocity.load();
+    _angular_velocity.store(rate > smoothed ? rate : smoothed + (rate - smoothed) / 16.0f);
+  }
+
+  _last_view = view;
+  _last_view_time = t;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned demo_app::guard_band(slow_worker const& w) const
+{
+  if (guard_band_max == 0) {
+    return 0;
+  }
+
+  // pixels per radian at the window center, times what the camera turns
+  // until the frame is warped. in steps, the band does not jitter with
+  // every mouse event.
+  float const focal = 0.5f * float(w.window_size.y) * w.projection_matrix.data_array[5];
+  float const horizon = float(_warp_horizon.load()) * 1e-9f;
+  float const band = _angular_velocity.load() * horizon * focal;
+
+  unsigned const guard = unsigned(std::ceil(band / float(guard_band_step))) * guard_band_step;
+  return std::min(std::max(guard, guard_band_min), guard_band_max);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::upload_reference_mesh(warp_reference const& reference)
+{
+  using namespace scm::gl;
+  using namespace scm::math;
+  using boost::assign::list_of;
+
+  diw::reference_mesh const& mesh = reference.mesh;
+  if (mesh.frame_id == _mesh_frame) {
+    return;
+  }
+  _mesh_frame = mesh.frame_id;
+
+  if (mesh.empty()) {
+    _mesh_array.reset();
+    _mesh_index_count = 0;
+    return;
+  }
+
+  diw::reference_frame const& frame = reference.frame;
+  if (!_mesh_color || _mesh_color->descriptor()._size != frame.size) {
+    _mesh_color = _app_device->create_texture_2d(frame.size, FORMAT_RGBA_8);
+  }
+  _fast_context->update_sub_texture(_mesh_color, texture_region(vec3ui(0u), vec3ui(frame.size, 1u)), 0, FORMAT_RGBA_8, frame.color_data());
+
+  // a new mesh every reference frame, the slow rate keeps this cheap
+  _mesh_vertices = _app_device->create_buffer(BIND_VERTEX_BUFFER, USAGE_STATIC_DRAW,
+                                              mesh.vertices.size() * sizeof(diw::reference_mesh::vertex), mesh.vertices.data());
+  _mesh_indices = _app_device->create_buffer(BIND_INDEX_BUFFER, USAGE_STATIC_DRAW,
+                                             mesh.indices.size() * sizeof(std::uint32_t), mesh.indices.data());
+  _mesh_array = _app_device->create_vertex_array(vertex_format(0, 0, TYPE_VEC3F, sizeof(diw::reference_mesh::vertex)),
+                                                 list_of(_mesh_vertices));
+
+  _mesh_camera = frame;
+  _mesh_size = frame.size;
+  _mesh_index_count = int(mesh.indices.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::render_from_texture(bool front_buffer)
+{
+  using namespace scm::gl;
+  using namespace scm::math;
+
+  if (!_present_timer) {
+    _present_timer.reset(new diw::gpu_timer(frame_profiler, _fast_context));
+  }
+  _present_timer->collect();
+
+  diw::profile_zone zone(frame_profiler, _present_timer.get(), "render_from_texture");
+
+  if (warping == warp_mesh) {
+    render_reference_mesh();
+    return;
+  }
+
   mat4f   pass_mvp = mat4f::identity();
   ortho_matrix(pass_mvp, 0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
 
@@ -417,18 +1429,76 @@ void demo_app::render_from_texture()
   _pass_through_shader->uniform_sampler("in_texture", 0);
   _pass_through_shader->uniform("mvp", pass_mvp);
 
-  _fast_context->set_default_frame_buffer();
+  // beam racing draws where the display scans out, rows below the slice
+  // just warped are the ones already there
+  _fast_context->set_default_frame_buffer(front_buffer ? FRAMEBUFFER_FRONT : FRAMEBUFFER_BACK);
 
   _fast_context->set_depth_stencil_state(_depth_no_z);
   _fast_context->set_blend_state(_no_blend);
 
   _fast_context->bind_program(_pass_through_shader);
 
-  _fast_context->bind_texture(_color_buffer_resolved, _filter_nearest, 0);
+  _fast_context->bind_texture(_warped_color, _filter_nearest, 0);
 
   // _fast_context->bind_vertex_array(_vertex_array);
   _fast_context->apply();
   _quad->draw(_fast_context);
+
+  if (front_buffer) {
+    glapi.glFlush();
+    _fast_context->set_default_frame_buffer();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::render_reference_mesh()
+{
+  using namespace scm::gl;
+  using namespace scm::math;
+
+  vec2ui const size(_window_width, _window_height);
+
+  // latched again right before the draw, the warp itself costs nothing here
+  diw::pose_sample pose;
+  _poses.latch(pose);
+  _warped_input = pose.input;
+
+  _fast_context->set_default_frame_buffer();
+  _fast_context->clear_default_color_buffer(FRAMEBUFFER_BACK, vec4f(.2f, .2f, .2f, 1.0f));
+  _fast_context->clear_default_depth_stencil_buffer();
+
+  if (!_mesh_array) {
+    return;
+  }
+
+  // reprojected with the pose of this very frame, the mesh itself is in
+  // reference window space and never touched on the cpu again
+  mat4f const clip_from_reference = diw::ndc_from_window_matrix(size)
+                                  * diw::reprojection_matrix(_mesh_camera.projection_matrix, _mesh_camera.view_matrix, _mesh_size,
+                                                             _projection_matrix, pose.view, size);
+
+  _mesh_warp_shader->uniform("clip_from_reference", clip_from_reference);
+  _mesh_warp_shader->uniform("reference_size", vec2f(float(_mesh_size.x), float(_mesh_size.y)));
+  _mesh_warp_shader->uniform_sampler("reference_color", 0);
+
+  _fast_context->set_depth_stencil_state(_dstate_less);
+  _fast_context->set_blend_state(_no_blend);
+  _fast_context->set_rasterizer_state(_ms_back_cull);
+
+  _fast_context->bind_program(_mesh_warp_shader);
+  _fast_context->bind_texture(_mesh_color, _filter_linear, 0);
+
+  _fast_context->bind_vertex_array(_mesh_array);
+  _fast_context->bind_index_buffer(_mesh_indices, PRIMITIVE_TRIANGLE_LIST, TYPE_UINT);
+  _fast_context->apply();
+  _fast_context->draw_elements(_mesh_index_count);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::frame_presented(diw::time_point const& present_time)
+{
+  motion_to_photon.presented("warped", _warped_input, present_time);
+  motion_to_photon.presented("rendered", _rendered_input, present_time);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -446,39 +1516,132 @@ void demo_app::resize(int w, int h)
 
   scm::math::perspective_matrix(_projection_matrix, 60.f, float(w) / float(h), 0.1f, 1000.0f);
 
-  initialize_framebuffer();
+  // the targets belong to the slow workers and their contexts, each one
+  // reallocates its own before its next frame
+  std::uint64_t const size = std::uint64_t(unsigned(w)) << 32 | unsigned(h);
+  for (auto const& worker : _slow_workers) {
+    worker->requested_size.store(size, std::memory_order_release);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void demo_app::mouse_func(GLFWwindow* window, int button, int action, int mods)
 {
+  unsigned bit = 0;
   switch (button) {
   case GLFW_MOUSE_BUTTON_LEFT:
   {
-    _lb_down = (action == GLFW_PRESS) ? true : false;
+    bit = diw::pointer_sample::left;
   }break;
   case GLFW_MOUSE_BUTTON_MIDDLE:
   {
-    _mb_down = (action == GLFW_PRESS) ? true : false;
+    bit = diw::pointer_sample::middle;
   }break;
   case GLFW_MOUSE_BUTTON_RIGHT:
   {
-    _rb_down = (action == GLFW_PRESS) ? true : false;
+    bit = diw::pointer_sample::right;
   }break;
   }
 
+  _pointer.buttons = (action == GLFW_PRESS) ? (_pointer.buttons | bit) : (_pointer.buttons & ~bit);
+
   double xpos, ypos;
   glfwGetCursorPos(window, &xpos, &ypos);
 
-  _initx = 2.f * float(xpos - (_window_width / 2)) / float(_window_width);
-  _inity = 2.f * float(_window_height - ypos - (_window_height / 2)) / float(_window_height);
+  _pointer.x = float(xpos / _window_width);
+  _pointer.y = float(ypos / _window_height);
+
+  publish_pointer();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void demo_app::mouse_motion_func(GLFWwindow* window, double xpos, double ypos)
 {
-  float nx = 2.f * float(xpos - (_window_width / 2)) / float(_window_width);
-  float ny = 2.f * float(_window_height - ypos - (_window_height / 2)) / float(_window_height);
+  _pointer.x = float(xpos / _window_width);
+  _pointer.y = float(ypos / _window_height);
+
+  publish_pointer();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::replay_pointer(diw::pointer_sample const& p)
+{
+  _pointer = p;
+  publish_pointer();
+
+  // in step with the input thread, a replayed frame always sees its input
+  while (_applied_pointer.load() < _pointer_sequence) {
+    std::this_thread::yield();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::publish_pointer()
+{
+  // only the newest state matters, the input thread picks it up with its
+  // next sample
+  pointer_event& e = _pointer_events.back();
+  e.pointer = _pointer;
+  e.time = diw::clock::now();
+  e.sequence = ++_pointer_sequence;
+
+  // the newest state alone loses where a drag started or ended
+  if (_pointer.buttons != _pointer_edge.buttons) {
+    _pointer_edge = _pointer;
+    _pointer_edge_sequence = e.sequence;
+  }
+  e.edge = _pointer_edge;
+  e.edge_sequence = _pointer_edge_sequence;
+
+  _pointer_events.publish();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+diw::pointer_sample demo_app::pointer_state() const
+{
+  return _pointer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::sample_input()
+{
+  std::uint64_t applied = 0;
+  if (_pointer_events.acquire()) {
+    apply_pointer(_pointer_events.front());
+    applied = _pointer_events.front().sequence;
+  }
+
+  _poses.push(diw::clock::now(), _trackball_manip.transform_matrix(), _input);
+
+  // after the push, a replay waiting for its event latches the pose of it
+  if (applied != 0) {
+    _applied_pointer.store(applied);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::apply_pointer(pointer_event const& e)
+{
+  // a button change since the last event: the drag goes on with the old
+  // buttons up to where it happened and starts there with the new ones,
+  // the motion around it in the same event is kept
+  if (e.edge_sequence > _applied_edge) {
+    drag(e.edge, e.time);
+
+    _lb_down = (e.edge.buttons & diw::pointer_sample::left) != 0;
+    _mb_down = (e.edge.buttons & diw::pointer_sample::middle) != 0;
+    _rb_down = (e.edge.buttons & diw::pointer_sample::right) != 0;
+    _applied_edge = e.edge_sequence;
+  }
+
+  drag(e.pointer, e.time);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::drag(diw::pointer_sample const& p, diw::time_point const& t)
+{
+  float nx = 2.f * p.x - 1.f;
+  float ny = 1.f - 2.f * p.y;
 
   if (_lb_down) {
     _trackball_manip.rotation(_initx, _inity, nx, ny);
@@ -490,24 +1653,31 @@ void demo_app::mouse_motion_func(GLFWwindow* window, double xpos, double ypos)
     _trackball_manip.translation(nx - _initx, ny - _inity);
   }
 
+  if (_lb_down || _rb_down || _mb_down) {
+    _input = diw::input_stamp(_input.sequence + 1, t);
+  }
+
   _inity = ny;
   _initx = nx;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void demo_app::keyboard(unsigned char key, int x, int y)
-{}
-
-///////////////////////////////////////////////////////////////////////////////
-bool demo_app::is_initialized()
+void demo_app::stop_input()
 {
-  return _initialized;
+  // nothing applies pointer events anymore, replays must not wait for it
+  _applied_pointer.store(~std::uint64_t(0));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void demo_app::set_initialized(bool flag)
+void demo_app::keyboard(unsigned char key, int x, int y)
+{}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::wait_for_initialization()
 {
-  _initialized = flag;
+  // the first slow worker owns the device, it is up once its first frame
+  // is out
+  _slow_workers.front()->reference_frames.wait_for_first();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -534,109 +1704,191 @@ static void cursor_position_callback(GLFWwindow* window, double xpos, double ypo
 ///////////////////////////////////////////////////////////////////////////////
 void init_window(std::shared_ptr<window_group> const& wgroup)
 {
-  /* Configure OpenGL context */
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
   /* Create a windowed mode window and its OpenGL context */
-  auto win = glfwCreateWindow(_application->window_width(), _application->window_height(), "Async Rendering Window", NULL, NULL);
+  scm::math::vec2ui size(_application->window_width(), _application->window_height());
 
-  if (win) {
+  if (wgroup->contexts->create_main_context(size, "Async Rendering Window")) {
     BOOST_LOG_TRIVIAL(info) << "Initialize fast client window succeed." << std::endl;
   }
   else {
     BOOST_LOG_TRIVIAL(error) << "Initialize fast client window failed." << std::endl;
+    return;
   }
-  wgroup->window = win;
 
   // Make the window's context current */
-  // glfwMakeContextCurrent(wgroup->window);
+  // wgroup->contexts->make_current(diw::main_context);
 
-  // set callbacks
-  glfwSetMouseButtonCallback(wgroup->window, mouse_button_callback);
-  glfwSetCursorPosCallback(wgroup->window, cursor_position_callback);
-  glfwSetWindowSizeCallback(wgroup->window, resize_callback);
+  // set callbacks, headless contexts have no window to take input from
+  if (auto win = static_cast<GLFWwindow*>(wgroup->contexts->native_handle(diw::main_context))) {
+    glfwSetMouseButtonCallback(win, mouse_button_callback);
+    glfwSetCursorPosCallback(win, cursor_position_callback);
+    glfwSetWindowSizeCallback(win, resize_callback);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void init_offscreen_window(std::shared_ptr<window_group> const& wgroup)
+void init_offscreen_window(std::shared_ptr<window_group> const& wgroup, unsigned worker)
 {
   int  a = 0;
-  if (!wgroup->window) {
+  if (!wgroup->contexts->has_context(diw::main_context)) {
     return;
   }
 
-  // context creation configuration
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  glfwWindowHint(GLFW_VISIBLE, false);
+  // create context sharing with the main one
+  // wgroup->contexts->make_current(diw::main_context);
+  auto ctx = wgroup->contexts->create_shared_context("Async Rendering Offscreen");
 
-  // create window
-  // glfwMakeContextCurrent(wgroup->window);
-  auto win = glfwCreateWindow(_application->window_width(), _application->window_height(), "Async Rendering Offscreen", NULL, wgroup->window);
-
-  if (win) {
+  if (ctx != diw::invalid_context) {
     BOOST_LOG_TRIVIAL(info) << "Initialize slow client window succeed." << std::endl;
-    wgroup->offscreen_window = win;
+    wgroup->offscreen_contexts[worker] = ctx;
   }
   else {
     BOOST_LOG_TRIVIAL(error) << "Initialize slow client window failed." << std::endl;
   }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void race_the_beam(std::shared_ptr<window_group> const& wgroup)
+{
+  // the pacer keeps a virtual scan out clock, a front buffer draw does not
+  // block on anything that would tell where the beam is
+  bool const front_buffer = !wgroup->contexts->headless();
+
+  for (unsigned s = 0; s < warp_slices; ++s) {
+    frame_pacing->wait_for_slice(s);
+    wgroup->contexts->poll_events();
+    frame_pacing->begin_work();
+
+    if (benchmark_run && s == 0) {
+      _application->replay_pointer(benchmark_run->input(wgroup->contexts->presented_frames()));
+    }
+
+    _application->warp_slice(s, warp_slices, frame_pacing->slice_deadline(s));
+    _application->render_from_texture(front_buffer);
+
+    frame_pacing->end_work();
+  }
+
+  if (front_buffer) {
+    wgroup->contexts->front_buffer_presented();
+  }
+  else {
+    frame_pacing->wait_for_deadline();
+    wgroup->contexts->swap_buffers();
+  }
+
+  if (benchmark_run) {
+    benchmark_run->frame_presented(wgroup->contexts->last_present());
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void fast_client(std::shared_ptr<window_group> const& wgroup)
 {
-  if (!wgroup->window) {
+  frame_profiler.name_current_thread("fast client");
+  diw::async_logger::instance().name_current_thread("fast client");
+
+  if (!wgroup->contexts->has_context(diw::main_context)) {
     init_window(wgroup);
   }
   // BOOST_LOG_TRIVIAL(info) << "[FAST] old Current window: " << glfwGetCurrentContext() << std::endl;
   // init the GL context
-  glfwMakeContextCurrent(wgroup->window);
+  wgroup->contexts->make_current(diw::main_context);
   // BOOST_LOG_TRIVIAL(info) << "[FAST] Current window: " << glfwGetCurrentContext() << std::endl;
   /* if (!_application->initialize()) {
     BOOST_LOG_TRIVIAL(error) << "error initializing gl context" << std::endl;
   }
   BOOST_LOG_TRIVIAL(info) << "[FAST] gl context initialized" << std::endl; */
-  while (!_application->is_initialized()) {
-    BOOST_LOG_TRIVIAL(info) << "[FAST] Waiting for fast client to initialize GL core ..." << std::endl;
-  }
+  BOOST_LOG_TRIVIAL(info) << "[FAST] Waiting for slow client to initialize GL core ..." << std::endl;
+  _application->wait_for_initialization();
   _application->initialize_unshareable_resources();
   // force resize
   _application->resize(initial_window_width, initial_window_height);
 
 
   // render loop
-  while (!glfwWindowShouldClose(wgroup->window))
+  while (!wgroup->contexts->should_close())
   {
+    if (warp_slices > 1) {
+      diw::profile_zone frame_zone(frame_profiler, nullptr, "frame");
+      wgroup->contexts->make_current(diw::main_context);
+      race_the_beam(wgroup);
+
+      if (recorded_path) {
+        recorded_path->append(_application->pointer_state());
+      }
+      continue;
+    }
+
+    // paced the idle time comes first, events are polled right before the
+    // warp samples the pose
+    if (frame_pacing) {
+      frame_pacing->wait_for_start();
+      wgroup->contexts->poll_events();
+      frame_pacing->begin_work();
+    }
+
+    diw::profile_zone frame_zone(frame_profiler, nullptr, "frame");
+
+    if (benchmark_run) {
+      _application->replay_pointer(benchmark_run->input(wgroup->contexts->presented_frames()));
+    }
+
     // Make the window's context current */
-    glfwMakeContextCurrent(wgroup->window);
+    wgroup->contexts->make_current(diw::main_context);
 
     {
-      BOOST_LOG_TRIVIAL(info) << "Fast Client : Render from texture." << std::endl;
+      DIW_LOG(debug, "Fast Client : Render from texture.");
       /* _application->render_to_texture();
       _application->postprocess_frame(); */
+      _application->warp_reference_frame();
       _application->render_from_texture();
     }
 
-    glfwSwapBuffers(wgroup->window);
-    glfwPollEvents();
+    if (frame_pacing) {
+      frame_pacing->end_work();
+      frame_pacing->wait_for_deadline();
+    }
+
+    wgroup->contexts->swap_buffers();
+    _application->frame_presented(wgroup->contexts->last_present());
+    if (benchmark_run) {
+      benchmark_run->frame_presented(wgroup->contexts->last_present());
+    }
+
+    if (frame_pacing) {
+      frame_pacing->presented(wgroup->contexts->last_present());
+    }
+    else {
+      wgroup->contexts->poll_events();
+    }
+
+    if (recorded_path) {
+      recorded_path->append(_application->pointer_state());
+    }
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void slow_client(std::shared_ptr<window_group> const& wgroup)
+void slow_client(std::shared_ptr<window_group> const& wgroup, unsigned index)
 {
-  while (!wgroup->offscreen_window) {
-    init_offscreen_window(wgroup);
+  std::string const name = slow_worker_count > 1 ? "slow client " + std::to_string(index) : std::string("slow client");
+  frame_profiler.name_current_thread(name);
+  diw::async_logger::instance().name_current_thread(name);
+
+  while (wgroup->offscreen_contexts[index] == diw::invalid_context) {
+    init_offscreen_window(wgroup, index);
   }
 
-  glfwMakeContextCurrent(wgroup->offscreen_window);
+  wgroup->contexts->make_current(wgroup->offscreen_contexts[index]);
 
-  if (!_application->initialize()) {
+  slow_worker& w = _application->worker(index);
+  if (index > 0) {
+    // the shared resources come from the first worker
+    _application->worker(0).reference_frames.wait_for_first();
+  }
+
+  if (!_application->initialize(w)) {
     BOOST_LOG_TRIVIAL(error) << "error initializing gl context" << std::endl;
   }
   BOOST_LOG_TRIVIAL(info) << "[SLOW] gl context initialized" << std::endl;
@@ -645,15 +1897,44 @@ void slow_client(std::shared_ptr<window_group> const& wgroup)
     BOOST_LOG_TRIVIAL(info) << "[SLOW] Waiting for fast client to initialize GL core ..." << std::endl;
   } */
 
-  while (true) {
-    std::lock_guard<std::mutex> lock(texture_write);
-    BOOST_LOG_TRIVIAL(info) << "Slow Client : Render to texture." << std::endl;
-    _application->render_to_texture();
-    _application->postprocess_frame();
-    if (!_application->is_initialized()) _application->set_initialized(true);
+  while (!wgroup->contexts->should_close()) {
+    diw::profile_zone frame_zone(frame_profiler, nullptr, "frame");
+
+    _application->apply_resize(w);
+    _application->stagger(w);
+    diw::time_point const start = diw::clock::now();
+
+    DIW_LOG(debug, "Slow Client : Render to texture.");
+    _application->render_to_texture(w);
+    _application->postprocess_frame(w);
+    _application->readback_reference_frame(w);
+
+    std::int64_t const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diw::clock::now() - start).count();
+    w.frame_time_ns = w.frame_time_ns == 0 ? ns : w.frame_time_ns + (ns - w.frame_time_ns) / 8;
   }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void input_client(std::shared_ptr<window_group> const& wgroup)
+{
+  frame_profiler.name_current_thread("input");
+  diw::async_logger::instance().name_current_thread("input");
+
+  diw::duration const period = std::chrono::duration_cast<diw::duration>(std::chrono::duration<double>(1.0 / input_rate));
+  diw::time_point     next = diw::clock::now();
+
+  // events arrive whenever the fast client polls, the poses go out at a
+  // fixed rate. a late sample does not make the next ones early.
+  while (!wgroup->contexts->should_close()) {
+    _application->sample_input();
+
+    next = std::max(next + period, diw::clock::now());
+    std::this_thread::sleep_until(next);
+  }
+
+  _application->stop_input();
+}
+
 void error_callback(int error, const char* description)
 {
   BOOST_LOG_TRIVIAL(error) << " error code : " << int(error) << " description:" << description << std::endl;
@@ -666,8 +1947,73 @@ int main(int argc, char **argv)
   /* Initialize the library */
   scm::shared_ptr<scm::core>      scm_core(new scm::core(argc, argv));
 
-  if (!glfwInit()) {
-    BOOST_LOG_TRIVIAL(error) << "Failed to init GLFW" << std::endl;
+  benchmark_run = diw::benchmark_requested(argc, argv, "simple_async_copy_async");
+
+  // benchmarks run headless where the build allows
+  bool headless = diw::headless_requested(argc, argv) || (benchmark_run && diw::headless_supported());
+
+  auto contexts = diw::create_context_provider(headless);
+
+  if (!contexts || !contexts->initialize()) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to init GL context provider" << std::endl;
+    return (-1);
+  }
+
+  if (benchmark_run) {
+    contexts->frame_limit(benchmark_run->frames());
+  }
+
+  warp_slices = std::min(std::max(unsigned(std::atoi(diw::option_value(argc, argv, "--slices", "1").c_str())), 1u), max_warp_slices);
+
+  // headless has no vsync to block on, the pacer makes one up. so does
+  // beam racing, which paces every slice.
+  if (diw::has_option(argc, argv, "--pace") || warp_slices > 1) {
+    double const refresh = std::max(std::atof(diw::option_value(argc, argv, "--refresh", "60").c_str()), 1.0);
+    frame_pacing.reset(new diw::frame_pacer(std::chrono::duration_cast<diw::duration>(std::chrono::duration<double>(1.0 / refresh)),
+                                            contexts->headless() || warp_slices > 1));
+    frame_pacing->slices(warp_slices);
+  }
+
+  std::string capture_file = diw::option_value(argc, argv, "--capture");
+  if (!capture_file.empty()) {
+    frame_capture.reset(new diw::capture_writer());
+    if (!frame_capture->open(capture_file, diw::has_option(argc, argv, "--capture-compress"))) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to open capture " << capture_file << std::endl;
+      frame_capture.reset();
+    }
+  }
+
+  std::string warp_option = diw::option_value(argc, argv, "--warp", "forward");
+  if (warp_option == "backward") {
+    warping = warp_backward;
+  }
+  else if (warp_option == "mesh") {
+    warping = warp_mesh;
+  }
+  if (warp_slices > 1 && warping != warp_backward) {
+    BOOST_LOG_TRIVIAL(warning) << "Beam racing warps slices of rows, only the backward warp can. Using --warp backward." << std::endl;
+    warping = warp_backward;
+  }
+  hole_filling = !diw::has_option(argc, argv, "--no-fill");
+  pipeline_depth = std::min(std::max(unsigned(std::atoi(diw::option_value(argc, argv, "--pipeline-depth", "1").c_str())), 1u), max_pipeline_depth);
+  peel_layers = std::min(std::max(unsigned(std::atoi(diw::option_value(argc, argv, "--layers", "1").c_str())), 1u), max_peel_layers);
+  guard_band_max = unsigned(std::max(std::atoi(diw::option_value(argc, argv, "--guard-band", "0").c_str()), 0));
+  guard_band_min = std::min(unsigned(std::max(std::atoi(diw::option_value(argc, argv, "--guard-band-min", "0").c_str()), 0)), guard_band_max);
+
+  std::string predict_option = diw::option_value(argc, argv, "--predict");
+  if (predict_option == "velocity") {
+    pose_prediction.reset(new diw::pose_predictor(diw::pose_predictor::constant_velocity));
+  }
+  else if (predict_option == "kalman") {
+    pose_prediction.reset(new diw::pose_predictor(diw::pose_predictor::kalman));
+  }
+  input_rate = std::max(std::atof(diw::option_value(argc, argv, "--input-rate", "1000").c_str()), 1.0);
+  reference_count = std::min(std::max(unsigned(std::atoi(diw::option_value(argc, argv, "--references", "1").c_str())), 1u), max_reference_count);
+  slow_worker_count = std::min(std::max(unsigned(std::atoi(diw::option_value(argc, argv, "--slow-workers", "1").c_str())), 1u), max_slow_workers);
+
+  std::string record_file = diw::option_value(argc, argv, "--record-path");
+  if (!record_file.empty()) {
+    recorded_path.reset(new diw::camera_path());
   }
 
   glfwSetErrorCallback(error_callback);
@@ -675,21 +2021,79 @@ int main(int argc, char **argv)
   _application.reset(new demo_app());
 
   windows = std::make_shared<window_group>();
+  windows->contexts = contexts;
 
   init_window(windows);
-  BOOST_LOG_TRIVIAL(info) << "Main Window: " << windows->window << std::endl;
-  init_offscreen_window(windows);
-  BOOST_LOG_TRIVIAL(info) << "Offscreen Window: " << windows->offscreen_window << std::endl;
+  BOOST_LOG_TRIVIAL(info) << "Main Window: " << windows->contexts->native_handle(diw::main_context) << std::endl;
+  windows->offscreen_contexts.assign(slow_worker_count, diw::invalid_context);
+  for (unsigned i = 0; i < slow_worker_count; ++i) {
+    init_offscreen_window(windows, i);
+    BOOST_LOG_TRIVIAL(info) << "Offscreen Window: " << windows->contexts->native_handle(windows->offscreen_contexts[i]) << std::endl;
+  }
 
   //glfwMakeContextCurrent(windows->window);
 
+  std::thread input_thread(std::bind(input_client, std::ref(windows)));
   std::thread fast_thread(std::bind(fast_client, std::ref(windows)));
-  std::thread slow_thread(std::bind(slow_client, std::ref(windows)));
+  std::vector<std::thread> slow_threads;
+  for (unsigned i = 0; i < slow_worker_count; ++i) {
+    slow_threads.emplace_back(std::bind(slow_client, std::ref(windows), i));
+  }
 
   fast_thread.join();
-  slow_thread.join();
+  for (auto& t : slow_threads) {
+    t.join();
+  }
+  input_thread.join();
+
+  std::ostringstream report;
+  frame_profiler.write_report(report);
+  BOOST_LOG_TRIVIAL(info) << "Frame profile:" << std::endl << report.str();
+
+  std::ostringstream latency_report;
+  motion_to_photon.write_report(latency_report);
+  BOOST_LOG_TRIVIAL(info) << "Motion-to-photon latency:" << std::endl << latency_report.str();
+
+  if (frame_pacing) {
+    std::ostringstream pacing_report;
+    frame_pacing->write_report(pacing_report);
+    BOOST_LOG_TRIVIAL(info) << "Frame pacing:" << std::endl << pacing_report.str();
+  }
+
+  if (pose_prediction) {
+    std::ostringstream prediction_report;
+    pose_prediction->write_report(prediction_report);
+    BOOST_LOG_TRIVIAL(info) << "Pose prediction error:" << std::endl << prediction_report.str();
+  }
+
+  std::string trace_file = diw::option_value(argc, argv, "--trace");
+  if (!trace_file.empty() && !frame_profiler.write_chrome_trace(trace_file)) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to write trace " << trace_file << std::endl;
+  }
+
+  if (benchmark_run) {
+    std::string benchmark_file = diw::option_value(argc, argv, "--benchmark-output");
+    if (benchmark_file.empty()) {
+      benchmark_run->write_json(std::cout, frame_profiler, motion_to_photon);
+    }
+    else if (!benchmark_run->write_json(benchmark_file, frame_profiler, motion_to_photon)) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to write benchmark results " << benchmark_file << std::endl;
+    }
+  }
+
+  if (frame_capture) {
+    if (!frame_capture->close()) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to write capture " << capture_file << std::endl;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Captured " << frame_capture->written_frames() << " frames, "
+                            << frame_capture->dropped_frames() << " dropped" << std::endl;
+  }
+
+  if (recorded_path && !recorded_path->save(record_file)) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to write camera path " << record_file << std::endl;
+  }
 
-  glfwTerminate();
+  contexts->terminate();
 
   return (0);
 }
\ No newline at end of file
@@ -12,8 +12,11 @@
 #include <windows.h>
 #endif
 
-#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 #include <boost/log/trivial.hpp>
 
@@ -30,17 +33,36 @@
 #include <scm/gl_util/manipulators/trackball_manipulator.h>
 #include <scm/gl_util/primitives/box.h>
 #include <scm/gl_util/primitives/quad.h>
-#include <scm/gl_util/primitives/wavefront_obj.h>
+
+#include <diw/benchmark/benchmark.h>
+#include <diw/benchmark/camera_path.h>
+#include <diw/context/context_provider.h>
+#include <diw/core/clock.h>
+#include <diw/core/input_stamp.h>
+#include <diw/core/options.h>
+#include <diw/gl/frame_handoff.h>
+#include <diw/gl/mesh_geometry.h>
+#include <diw/logging/async_logger.h>
+#include <diw/profiling/gpu_timer.h>
+#include <diw/profiling/latency_tracker.h>
+#include <diw/profiling/profile_zone.h>
+#include <diw/profiling/profiler.h>
+#include <diw/sync/pose_ring.h>
 
 #include <GLFW/glfw3.h>
 
 struct window_group {
-  GLFWwindow* window = nullptr;
-  GLFWwindow* offscreen_window = nullptr;
+  std::shared_ptr<diw::context_provider> contexts;
+  std::atomic<diw::context_id> offscreen_context{diw::invalid_context};
 };
 
 std::shared_ptr<window_group> windows = nullptr;
-std::mutex texture_write;
+diw::profiler frame_profiler;
+diw::latency_tracker motion_to_photon;
+
+// set by --benchmark and --record-path
+std::unique_ptr<diw::benchmark> benchmark_run;
+std::unique_ptr<diw::camera_path> recorded_path;
 
 static int const initial_window_width = 1920;
 static int const initial_window_height = 1080;
@@ -50,6 +72,23 @@ const scm::math::vec3f specular(0.2f, 0.7f, 0.9f);
 const scm::math::vec3f ambient(0.1f, 0.1f, 0.1f);
 const scm::math::vec3f position(1, 1, 1);
 
+// render targets of one handoff slot. frame buffers do not cross contexts,
+// the slow client creates and owns them, the fast client only samples the
+// resolved color.
+struct reference_targets
+{
+  reference_targets() : size(0u, 0u) {}
+
+  scm::math::vec2ui                   size;
+  scm::gl::texture_2d_ptr             color_buffer;
+  scm::gl::texture_2d_ptr             depth_buffer;
+  scm::gl::frame_buffer_ptr           framebuffer;
+  scm::gl::texture_2d_ptr             color_buffer_resolved;
+  scm::gl::frame_buffer_ptr           framebuffer_resolved;
+
+  diw::input_stamp                    input;
+};
+
 class demo_app
 {
 public:
@@ -68,7 +107,11 @@ public:
 
     _projection_matrix = scm::math::mat4f::identity();
 
-    _initialized = false;
+    _input = diw::input_stamp();
+
+    _write_slot = 0;
+
+    _initialized.store(false);
   }
   virtual ~demo_app();
 
@@ -76,20 +119,27 @@ public:
   int window_height() const { return _window_height; };
 
   bool initialize();
-  void initialize_framebuffer();
+  bool initialize_slow_client();
+  void initialize_framebuffer(reference_targets& targets);
 
   void render_to_texture();
   void postprocess_frame();
   void render_from_texture();
+  void frame_presented(diw::time_point const& present_time);
 
   void resize(int w, int h);
   void mouse_func(GLFWwindow* window, int button, int action, int mods);
   void mouse_motion_func(GLFWwindow* window, double xpos, double ypos);
+  void replay_pointer(diw::pointer_sample const& p);
+  diw::pointer_sample pointer_state() const;
   void keyboard(unsigned char key, int x, int y);
 
-  bool is_initialized();
+  // false if the fast client did not finish initializing within timeout
+  bool wait_for_initialization(std::chrono::milliseconds const& timeout);
 
 private:
+  // the trackball and the drag state belong to the fast client, whose
+  // callbacks move it. the slow client latches poses from _poses.
   scm::gl::trackball_manipulator _trackball_manip;
   float _initx;
   float _inity;
@@ -116,7 +166,7 @@ private:
   scm::math::mat4f            _projection_matrix;
 
   scm::shared_ptr<scm::gl::box_geometry>  _box;
-  scm::shared_ptr<scm::gl::wavefront_obj_geometry>  _obj;
+  scm::shared_ptr<diw::mesh_geometry>     _obj;
   scm::gl::depth_stencil_state_ptr     _dstate_less;
   scm::gl::depth_stencil_state_ptr     _dstate_disable;
 
@@ -131,18 +181,34 @@ private:
   scm::gl::sampler_state_ptr          _filter_nearest;
   scm::gl::sampler_state_ptr          _filter_linear;
 
-  scm::gl::texture_2d_ptr             _color_buffer;
-  scm::gl::texture_2d_ptr             _color_buffer_resolved;
-  scm::gl::texture_2d_ptr             _depth_buffer;
-  scm::gl::frame_buffer_ptr           _framebuffer;
-  scm::gl::frame_buffer_ptr           _framebuffer_resolved;
   scm::shared_ptr<scm::gl::quad_geometry>  _quad;
   scm::gl::program_ptr                _pass_through_shader;
   scm::gl::depth_stencil_state_ptr    _depth_no_z;
   scm::gl::rasterizer_state_ptr       _ms_back_cull;
 
-  bool _initialized;
+  // gpu zones of the slow pass and of the presenting pass
+  scm::scoped_ptr<diw::gpu_timer>     _render_timer;
+  scm::scoped_ptr<diw::gpu_timer>     _present_timer;
+
+  // newest input the trackball pose reflects and the input reflected by
+  // the last presented frame
+  diw::input_stamp                    _input;
+  diw::input_stamp                    _rendered_input;
+
+  // every trackball pose from the fast client to the slow one
+  diw::pose_ring                      _poses;
+
+  // slow client renders to _targets[_write_slot], the fast client samples
+  // whatever slot the handoff gives it
+  reference_targets                   _targets[diw::frame_handoff::slots];
+  std::size_t                         _write_slot;
+  diw::frame_handoff                  _handoff;
 
+  // set once by the fast client after initialize(), the slow client
+  // sleeps on it instead of polling
+  std::atomic<bool>                   _initialized;
+  std::mutex                          _initialized_mutex;
+  std::condition_variable             _initialized_cond;
 
 }; // class demo_app
 
@@ -169,15 +235,16 @@ demo_app::~demo_app()
   _color_texture.reset();
 
   _filter_linear.reset();
-  _color_buffer.reset();
-  _depth_buffer.reset();
-  _framebuffer.reset();
+  for (auto& t : _targets) {
+    t = reference_targets();
+  }
   _quad.reset();
   _pass_through_shader.reset();
   _depth_no_z.reset();
   _ms_back_cull.reset();
-  _color_buffer_resolved.reset();
-  _framebuffer_resolved.reset();
+
+  _render_timer.reset();
+  _present_timer.reset();
 
   _fast_context.reset();
   _slow_context.reset();
@@ -269,9 +336,6 @@ bool demo_app::initialize()
   _color_mask_green = _device->create_blend_state(true, FUNC_SRC_ALPHA, FUNC_ONE_MINUS_SRC_ALPHA, FUNC_ONE, FUNC_ZERO,
     EQ_FUNC_ADD, EQ_FUNC_ADD, COLOR_GREEN | COLOR_BLUE);
 
-  _box.reset(new box_geometry(_device, vec3f(-0.5f), vec3f(0.5f)));
-  _obj.reset(new wavefront_obj_geometry(_device, "../res/geometry/box.obj"));
-
   texture_loader tex_loader;
   _color_texture = tex_loader.load_texture_2d(*_device,
     "../res/textures/0001MM_diff.jpg", true, false);
@@ -296,28 +360,55 @@ bool demo_app::initialize()
 
 
   _trackball_manip.dolly(2.5f);
+  // the ring holds a pose before the slow client latches one
+  _poses.push(diw::clock::now(), _trackball_manip.transform_matrix(), _input);
+
+  {
+    std::lock_guard<std::mutex> lock(_initialized_mutex);
+    _initialized.store(true);
+  }
+  _initialized_cond.notify_all();
+  return (true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool demo_app::initialize_slow_client()
+{
+  using namespace scm::gl;
+  using namespace scm::math;
 
-  initialize_framebuffer();
+  // vertex arrays are per context as well, the geometry the slow client
+  // draws has to be created with its context current
+  _box.reset(new box_geometry(_device, vec3f(-0.5f), vec3f(0.5f)));
+  // compiled to box.obj.diwmesh on the first start, mapped after that
+  _obj.reset(new diw::mesh_geometry(_device, "../res/geometry/box.obj"));
+  if (!_obj->valid()) {
+    scm::err() << "error loading geometry" << scm::log::end;
+    return (false);
+  }
 
-  _initialized = true;
   return (true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void demo_app::initialize_framebuffer() 
+void demo_app::initialize_framebuffer(reference_targets& targets)
 {
   using namespace scm::gl;
   using namespace scm::math;
 
-  _color_buffer = _device->create_texture_2d(vec2ui(_window_width, _window_height) * 1, FORMAT_RGBA_8, 1, 1, 8);
-  _depth_buffer = _device->create_texture_2d(vec2ui(_window_width, _window_height) * 1, FORMAT_D24, 1, 1, 8);
-  _framebuffer = _device->create_frame_buffer();
-  _framebuffer->attach_color_buffer(0, _color_buffer);
-  _framebuffer->attach_depth_stencil_buffer(_depth_buffer);
+  vec2ui size(_window_width, _window_height);
+
+  targets.size = size;
 
-  _color_buffer_resolved = _device->create_texture_2d(vec2ui(_window_width, _window_height) * 1, FORMAT_RGBA_8);
-  _framebuffer_resolved = _device->create_frame_buffer();
-  _framebuffer_resolved->attach_color_buffer(0, _color_buffer_resolved);
+  targets.color_buffer = _device->create_texture_2d(size, FORMAT_RGBA_8, 1, 1, 8);
+  targets.depth_buffer = _device->create_texture_2d(size, FORMAT_D24, 1, 1, 8);
+  targets.framebuffer = _device->create_frame_buffer();
+  targets.framebuffer->attach_color_buffer(0, targets.color_buffer);
+  targets.framebuffer->attach_depth_stencil_buffer(targets.depth_buffer);
+
+  targets.color_buffer_resolved = _device->create_texture_2d(size, FORMAT_RGBA_8);
+  targets.framebuffer_resolved = _device->create_frame_buffer();
+  targets.framebuffer_resolved->attach_color_buffer(0, targets.color_buffer_resolved);
 }
 
 unsigned plah = 0;
@@ -328,10 +419,30 @@ void demo_app::render_to_texture()
   using namespace scm::gl;
   using namespace scm::math;
 
+  if (!_render_timer) {
+    _render_timer.reset(new diw::gpu_timer(frame_profiler, _slow_context));
+  }
+  _render_timer->collect();
+
+  diw::profile_zone zone(frame_profiler, _render_timer.get(), "render_to_texture");
+
+  // the context waits for the fast client to be done with this slot, the
+  // thread does not
+  _write_slot = _handoff.begin_write(_slow_context);
+
+  reference_targets& targets = _targets[_write_slot];
+  if (targets.size != vec2ui(_window_width, _window_height)) {
+    initialize_framebuffer(targets);
+  }
+
   // clear the color and depth buffer
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-  mat4f    view_matrix = _trackball_manip.transform_matrix();
+  diw::pose_sample pose;
+  _poses.latch(pose);
+
+  targets.input = pose.input;
+  mat4f    view_matrix = pose.view;
   mat4f    model_matrix = mat4f::identity();
   mat4f    model_view_matrix = view_matrix * model_matrix;
   mat4f    mv_inv_transpose = transpose(inverse(model_view_matrix));
@@ -355,11 +466,11 @@ void demo_app::render_to_texture()
 
     _slow_context->clear_default_color_buffer(FRAMEBUFFER_BACK, vec4f(.2f, .2f, .2f, 1.0f));
 
-    _slow_context->clear_color_buffer(_framebuffer, 0, vec4f(.2f, .2f, .2f, 1.0f));
-    _slow_context->clear_depth_stencil_buffer(_framebuffer, 1.0);
-    _slow_context->set_frame_buffer(_framebuffer);
+    _slow_context->clear_color_buffer(targets.framebuffer, 0, vec4f(.2f, .2f, .2f, 1.0f));
+    _slow_context->clear_depth_stencil_buffer(targets.framebuffer, 1.0);
+    _slow_context->set_frame_buffer(targets.framebuffer);
 
-    _slow_context->set_viewport(viewport(vec2ui(0, 0), 1 * vec2ui(_window_width, _window_height)));
+    _slow_context->set_viewport(viewport(vec2ui(0, 0), targets.size));
 
     _slow_context->set_depth_stencil_state(_dstate_less);
     _slow_context->set_blend_state(_no_blend);
@@ -378,10 +489,21 @@ void demo_app::render_to_texture()
 ///////////////////////////////////////////////////////////////////////////////
 void demo_app::postprocess_frame()
 {
+  reference_targets& targets = _targets[_write_slot];
+
   // blit multisample texture to texture and generate mipmap pyramid
-  _fast_context->resolve_multi_sample_buffer(_framebuffer, _framebuffer_resolved);
-  _fast_context->generate_mipmaps(_color_buffer_resolved);
-  _fast_context->reset();
+  {
+    diw::profile_zone zone(frame_profiler, _render_timer.get(), "resolve_multi_sample_buffer");
+    _slow_context->resolve_multi_sample_buffer(targets.framebuffer, targets.framebuffer_resolved);
+  }
+  {
+    diw::profile_zone zone(frame_profiler, _render_timer.get(), "generate_mipmaps");
+    _slow_context->generate_mipmaps(targets.color_buffer_resolved);
+  }
+  _slow_context->reset();
+
+  // fenced, the fast client samples the slot once the gpu is done with it
+  _handoff.publish(_slow_context);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -390,6 +512,20 @@ void demo_app::render_from_texture()
   using namespace scm::gl;
   using namespace scm::math;
 
+  if (!_present_timer) {
+    _present_timer.reset(new diw::gpu_timer(frame_profiler, _fast_context));
+  }
+  _present_timer->collect();
+
+  diw::profile_zone zone(frame_profiler, _present_timer.get(), "render_from_texture");
+
+  std::size_t slot = _handoff.acquire(_fast_context);
+  if (slot == diw::frame_handoff::npos) {
+    return;
+  }
+
+  _rendered_input = _targets[slot].input;
+
   mat4f   pass_mvp = mat4f::identity();
   ortho_matrix(pass_mvp, 0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
 
@@ -405,11 +541,17 @@ void demo_app::render_from_texture()
 
   _fast_context->bind_program(_pass_through_shader);
 
-  _fast_context->bind_texture(_color_buffer_resolved, _filter_nearest, 0);
+  _fast_context->bind_texture(_targets[slot].color_buffer_resolved, _filter_nearest, 0);
   _fast_context->apply();
   _quad->draw(_fast_context);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::frame_presented(diw::time_point const& present_time)
+{
+  motion_to_photon.presented("rendered", _rendered_input, present_time);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void demo_app::resize(int w, int h)
 {
@@ -425,7 +567,7 @@ void demo_app::resize(int w, int h)
 
   scm::math::perspective_matrix(_projection_matrix, 60.f, float(w) / float(h), 0.1f, 1000.0f);
 
-  initialize_framebuffer();
+  // the slow client reallocates each slot's targets when it gets to it
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -456,6 +598,8 @@ void demo_app::mouse_func(GLFWwindow* window, int button, int action, int mods)
 ///////////////////////////////////////////////////////////////////////////////
 void demo_app::mouse_motion_func(GLFWwindow* window, double xpos, double ypos)
 {
+  diw::time_point input_time = diw::clock::now();
+
   float nx = 2.f * float(xpos - (_window_width / 2)) / float(_window_width);
   float ny = 2.f * float(_window_height - ypos - (_window_height / 2)) / float(_window_height);
 
@@ -471,6 +615,45 @@ void demo_app::mouse_motion_func(GLFWwindow* window, double xpos, double ypos)
 
   _inity = ny;
   _initx = nx;
+
+  if (_lb_down || _rb_down || _mb_down) {
+    _input = diw::input_stamp(_input.sequence + 1, input_time);
+    _poses.push(input_time, _trackball_manip.transform_matrix(), _input);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::replay_pointer(diw::pointer_sample const& p)
+{
+  double xpos = double(p.x) * _window_width;
+  double ypos = double(p.y) * _window_height;
+
+  bool lb = (p.buttons & diw::pointer_sample::left) != 0;
+  bool mb = (p.buttons & diw::pointer_sample::middle) != 0;
+  bool rb = (p.buttons & diw::pointer_sample::right) != 0;
+
+  // press or release, like mouse_func without asking glfw for the cursor
+  if (lb != _lb_down || mb != _mb_down || rb != _rb_down) {
+    _lb_down = lb;
+    _mb_down = mb;
+    _rb_down = rb;
+
+    _initx = 2.f * float(xpos - (_window_width / 2)) / float(_window_width);
+    _inity = 2.f * float(_window_height - ypos - (_window_height / 2)) / float(_window_height);
+    return;
+  }
+
+  mouse_motion_func(nullptr, xpos, ypos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+diw::pointer_sample demo_app::pointer_state() const
+{
+  unsigned buttons = (_lb_down ? unsigned(diw::pointer_sample::left) : 0u)
+                   | (_mb_down ? unsigned(diw::pointer_sample::middle) : 0u)
+                   | (_rb_down ? unsigned(diw::pointer_sample::right) : 0u);
+
+  return diw::pointer_sample(0.5f * (_initx + 1.f), 0.5f * (1.f - _inity), buttons);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -478,9 +661,10 @@ void demo_app::keyboard(unsigned char key, int x, int y)
 {}
 
 ///////////////////////////////////////////////////////////////////////////////
-bool demo_app::is_initialized()
+bool demo_app::wait_for_initialization(std::chrono::milliseconds const& timeout)
 {
-  return _initialized;
+  std::unique_lock<std::mutex> lock(_initialized_mutex);
+  return _initialized_cond.wait_for(lock, timeout, [this] { return _initialized.load(); });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -507,53 +691,43 @@ static void cursor_position_callback(GLFWwindow* window, double xpos, double ypo
 ///////////////////////////////////////////////////////////////////////////////
 void init_window(std::shared_ptr<window_group> const& wgroup)
 {
-  /* Configure OpenGL context */
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
   /* Create a windowed mode window and its OpenGL context */
-  auto win = glfwCreateWindow(_application->window_width(), _application->window_height(), "Async Rendering Window", NULL, NULL);
+  scm::math::vec2ui size(_application->window_width(), _application->window_height());
 
-  if (win) {
+  if (wgroup->contexts->create_main_context(size, "Async Rendering Window")) {
     BOOST_LOG_TRIVIAL(info) << "Initialize fast client window succeed." << std::endl;
   }
   else {
     BOOST_LOG_TRIVIAL(error) << "Initialize fast client window failed." << std::endl;
+    return;
   }
-  wgroup->window = win;
 
   // Make the window's context current */
-  // glfwMakeContextCurrent(wgroup->window);
+  // wgroup->contexts->make_current(diw::main_context);
 
-  // set callbacks
-  glfwSetMouseButtonCallback(wgroup->window, mouse_button_callback);
-  glfwSetCursorPosCallback(wgroup->window, cursor_position_callback);
-  glfwSetWindowSizeCallback(wgroup->window, resize_callback);
+  // set callbacks, headless contexts have no window to take input from
+  if (auto win = static_cast<GLFWwindow*>(wgroup->contexts->native_handle(diw::main_context))) {
+    glfwSetMouseButtonCallback(win, mouse_button_callback);
+    glfwSetCursorPosCallback(win, cursor_position_callback);
+    glfwSetWindowSizeCallback(win, resize_callback);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void init_offscreen_window(std::shared_ptr<window_group> const& wgroup)
 {
   int  a = 0;
-  if (!wgroup->window) {
+  if (!wgroup->contexts->has_context(diw::main_context)) {
     return;
   }
 
-  // context creation configuration
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  glfwWindowHint(GLFW_VISIBLE, false);
-
-  // create window
-  // glfwMakeContextCurrent(wgroup->window);
-  auto win = glfwCreateWindow(_application->window_width(), _application->window_height(), "Async Rendering Offscreen", NULL, wgroup->window);
+  // create context sharing with the main one
+  // wgroup->contexts->make_current(diw::main_context);
+  auto ctx = wgroup->contexts->create_shared_context("Async Rendering Offscreen");
 
-  if (win) {
+  if (ctx != diw::invalid_context) {
     BOOST_LOG_TRIVIAL(info) << "Initialize slow client window succeed." << std::endl;
-    wgroup->offscreen_window = win;
+    wgroup->offscreen_context = ctx;
   }
   else {
     BOOST_LOG_TRIVIAL(error) << "Initialize slow client window failed." << std::endl;
@@ -563,12 +737,15 @@ void init_offscreen_window(std::shared_ptr<window_group> const& wgroup)
 ///////////////////////////////////////////////////////////////////////////////
 void fast_client(std::shared_ptr<window_group> const& wgroup)
 {
-  if (!wgroup->window) {
+  frame_profiler.name_current_thread("fast client");
+  diw::async_logger::instance().name_current_thread("fast client");
+
+  if (!wgroup->contexts->has_context(diw::main_context)) {
     init_window(wgroup);
   }
   BOOST_LOG_TRIVIAL(info) << "[FAST] old Current window: " << glfwGetCurrentContext() << std::endl;
   // init the GL context
-  glfwMakeContextCurrent(wgroup->window);
+  wgroup->contexts->make_current(diw::main_context);
   BOOST_LOG_TRIVIAL(info) << "[FAST] Current window: " << glfwGetCurrentContext() << std::endl;
   if (!_application->initialize()) {
     BOOST_LOG_TRIVIAL(error) << "error initializing gl context" << std::endl;
@@ -580,10 +757,16 @@ void fast_client(std::shared_ptr<window_group> const& wgroup)
 
 
   // render loop
-  while (!glfwWindowShouldClose(wgroup->window))
+  while (!wgroup->contexts->should_close())
   {
+    diw::profile_zone frame_zone(frame_profiler, nullptr, "frame");
+
+    if (benchmark_run) {
+      _application->replay_pointer(benchmark_run->input(wgroup->contexts->presented_frames()));
+    }
+
     // Make the window's context current */
-    glfwMakeContextCurrent(wgroup->window);
+    wgroup->contexts->make_current(diw::main_context);
 
     {
       //BOOST_LOG_TRIVIAL(info) << "Fast Client : Render to texture." << std::endl;
@@ -592,25 +775,48 @@ void fast_client(std::shared_ptr<window_group> const& wgroup)
       _application->render_from_texture();
     }
 
-    glfwSwapBuffers(wgroup->window);
-    glfwPollEvents();
+    wgroup->contexts->swap_buffers();
+    _application->frame_presented(wgroup->contexts->last_present());
+    if (benchmark_run) {
+      benchmark_run->frame_presented(wgroup->contexts->last_present());
+    }
+    wgroup->contexts->poll_events();
+
+    if (recorded_path) {
+      recorded_path->append(_application->pointer_state());
+    }
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void slow_client(std::shared_ptr<window_group> const& wgroup)
 {
-  while (!wgroup->offscreen_window) {
+  frame_profiler.name_current_thread("slow client");
+  diw::async_logger::instance().name_current_thread("slow client");
+
+  while (wgroup->offscreen_context == diw::invalid_context) {
     init_offscreen_window(wgroup);
   }
 
-  while(!_application->is_initialized()) {
-    BOOST_LOG_TRIVIAL(info) << "[SLOW] Waiting for fast client to initialize GL core ..." << std::endl;
+  // blocks, waking up only to notice a window closed before the fast
+  // client got anywhere
+  DIW_LOG(info, "[SLOW] Waiting for fast client to initialize GL core ...");
+  while (!_application->wait_for_initialization(std::chrono::milliseconds(100))) {
+    if (wgroup->contexts->should_close()) {
+      return;
+    }
+  }
+
+  wgroup->contexts->make_current(wgroup->offscreen_context);
+
+  if (!_application->initialize_slow_client()) {
+    BOOST_LOG_TRIVIAL(error) << "error initializing slow client resources" << std::endl;
   }
 
-  while (true) {
-    std::lock_guard<std::mutex> lock(texture_write);
-    BOOST_LOG_TRIVIAL(info) << "Slow Client : Render to texture." << std::endl;
+  while (!wgroup->contexts->should_close()) {
+    diw::profile_zone frame_zone(frame_profiler, nullptr, "frame");
+
+    DIW_LOG(debug, "Slow Client : Render to texture.");
     _application->render_to_texture();
     _application->postprocess_frame();
   }
@@ -628,8 +834,25 @@ int main(int argc, char **argv)
   /* Initialize the library */
   scm::shared_ptr<scm::core>      scm_core(new scm::core(argc, argv));
 
-  if (!glfwInit()) {
-    BOOST_LOG_TRIVIAL(error) << "Failed to init GLFW" << std::endl;
+  benchmark_run = diw::benchmark_requested(argc, argv, "simple_async_copy_async_failing");
+
+  // benchmarks run headless where the build allows
+  bool headless = diw::headless_requested(argc, argv) || (benchmark_run && diw::headless_supported());
+
+  auto contexts = diw::create_context_provider(headless);
+
+  if (!contexts || !contexts->initialize()) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to init GL context provider" << std::endl;
+    return (-1);
+  }
+
+  if (benchmark_run) {
+    contexts->frame_limit(benchmark_run->frames());
+  }
+
+  std::string record_file = diw::option_value(argc, argv, "--record-path");
+  if (!record_file.empty()) {
+    recorded_path.reset(new diw::camera_path());
   }
 
   glfwSetErrorCallback(error_callback);
@@ -637,11 +860,12 @@ int main(int argc, char **argv)
   _application.reset(new demo_app());
 
   windows = std::make_shared<window_group>();
+  windows->contexts = contexts;
 
   init_window(windows);
-  BOOST_LOG_TRIVIAL(info) << "Main Window: " << windows->window << std::endl;
+  BOOST_LOG_TRIVIAL(info) << "Main Window: " << windows->contexts->native_handle(diw::main_context) << std::endl;
   init_offscreen_window(windows);
-  BOOST_LOG_TRIVIAL(info) << "Offscreen Window: " << windows->offscreen_window << std::endl;
+  BOOST_LOG_TRIVIAL(info) << "Offscreen Window: " << windows->contexts->native_handle(windows->offscreen_context) << std::endl;
 
   //glfwMakeContextCurrent(windows->window);
 
@@ -651,7 +875,34 @@ int main(int argc, char **argv)
   fast_thread.join();
   slow_thread.join();
 
-  glfwTerminate();
+  std::ostringstream report;
+  frame_profiler.write_report(report);
+  BOOST_LOG_TRIVIAL(info) << "Frame profile:" << std::endl << report.str();
+
+  std::ostringstream latency_report;
+  motion_to_photon.write_report(latency_report);
+  BOOST_LOG_TRIVIAL(info) << "Motion-to-photon latency:" << std::endl << latency_report.str();
+
+  std::string trace_file = diw::option_value(argc, argv, "--trace");
+  if (!trace_file.empty() && !frame_profiler.write_chrome_trace(trace_file)) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to write trace " << trace_file << std::endl;
+  }
+
+  if (benchmark_run) {
+    std::string benchmark_file = diw::option_value(argc, argv, "--benchmark-output");
+    if (benchmark_file.empty()) {
+      benchmark_run->write_json(std::cout, frame_profiler, motion_to_photon);
+    }
+    else if (!benchmark_run->write_json(benchmark_file, frame_profiler, motion_to_photon)) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to write benchmark results " << benchmark_file << std::endl;
+    }
+  }
+
+  if (recorded_path && !recorded_path->save(record_file)) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to write camera path " << record_file << std::endl;
+  }
+
+  contexts->terminate();
 
   return (0);
 }
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include <windows.h>
 #endif
 
+#include <atomic>
 #include <thread>
 #include <mutex>
 
@@ -30,16 +31,33 @@
 #include <scm/gl_util/manipulators/trackball_manipulator.h>
 #include <scm/gl_util/primitives/box.h>
 #include <scm/gl_util/primitives/quad.h>
-#include <scm/gl_util/primitives/wavefront_obj.h>
+
+#include <diw/benchmark/benchmark.h>
+#include <diw/benchmark/camera_path.h>
+#include <diw/context/context_provider.h>
+#include <diw/core/clock.h>
+#include <diw/core/input_stamp.h>
+#include <diw/core/options.h>
+#include <diw/gl/mesh_geometry.h>
+#include <diw/profiling/gpu_timer.h>
+#include <diw/profiling/latency_tracker.h>
+#include <diw/profiling/profile_zone.h>
+#include <diw/profiling/profiler.h>
 
 #include <GLFW/glfw3.h>
 
 struct window_group {
-  GLFWwindow* window = nullptr;
-  GLFWwindow* offscreen_window = nullptr;
+  std::shared_ptr<diw::context_provider> contexts;
+  std::atomic<diw::context_id> offscreen_context{diw::invalid_context};
 };
 
 std::shared_ptr<window_group> windows = nullptr;
+diw::profiler frame_profiler;
+diw::latency_tracker motion_to_photon;
+
+// set by --benchmark and --record-path
+std::unique_ptr<diw::benchmark> benchmark_run;
+std::unique_ptr<diw::camera_path> recorded_path;
 std::mutex texture_write;
 
 static int const initial_window_width = 1920;
@@ -67,6 +85,9 @@ public:
     _dolly_sens = 10.0f;
 
     _projection_matrix = scm::math::mat4f::identity();
+
+    _input.store(diw::input_stamp());
+    _rendered_input.store(diw::input_stamp());
   }
   virtual ~demo_app();
 
@@ -79,10 +100,13 @@ public:
   void render_to_texture();
   void postprocess_frame();
   void render_from_texture();
+  void frame_presented(diw::time_point const& present_time);
 
   void resize(int w, int h);
   void mouse_func(GLFWwindow* window, int button, int action, int mods);
   void mouse_motion_func(GLFWwindow* window, double xpos, double ypos);
+  void replay_pointer(diw::pointer_sample const& p);
+  diw::pointer_sample pointer_state() const;
   void keyboard(unsigned char key, int x, int y);
 
 private:
@@ -112,7 +136,7 @@ private:
   scm::math::mat4f            _projection_matrix;
 
   scm::shared_ptr<scm::gl::box_geometry>  _box;
-  scm::shared_ptr<scm::gl::wavefront_obj_geometry>  _obj;
+  scm::shared_ptr<diw::mesh_geometry>     _obj;
   scm::gl::depth_stencil_state_ptr     _dstate_less;
   scm::gl::depth_stencil_state_ptr     _dstate_disable;
 
@@ -137,6 +161,15 @@ private:
   scm::gl::depth_stencil_state_ptr    _depth_no_z;
   scm::gl::rasterizer_state_ptr       _ms_back_cull;
 
+  // gpu zones of the slow pass and of the presenting pass
+  scm::scoped_ptr<diw::gpu_timer>     _render_timer;
+  scm::scoped_ptr<diw::gpu_timer>     _present_timer;
+
+  // newest input the trackball pose reflects and the input reflected by
+  // the last rendered frame
+  diw::atomic_input_stamp             _input;
+  diw::atomic_input_stamp             _rendered_input;
+
 
 }; // class demo_app
 
@@ -173,6 +206,9 @@ demo_app::~demo_app()
   _color_buffer_resolved.reset();
   _framebuffer_resolved.reset();
 
+  _render_timer.reset();
+  _present_timer.reset();
+
   _fast_context.reset();
   _slow_context.reset();
   _device.reset();
@@ -264,7 +300,12 @@ bool demo_app::initialize()
     EQ_FUNC_ADD, EQ_FUNC_ADD, COLOR_GREEN | COLOR_BLUE);
 
   _box.reset(new box_geometry(_device, vec3f(-0.5f), vec3f(0.5f)));
-  _obj.reset(new wavefront_obj_geometry(_device, "../res/geometry/box.obj"));
+  // compiled to box.obj.diwmesh on the first start, mapped after that
+  _obj.reset(new diw::mesh_geometry(_device, "../res/geometry/box.obj"));
+  if (!_obj->valid()) {
+    scm::err() << "error loading geometry" << scm::log::end;
+    return (false);
+  }
 
   texture_loader tex_loader;
   _color_texture = tex_loader.load_texture_2d(*_device,
@@ -321,9 +362,17 @@ void demo_app::render_to_texture()
   using namespace scm::gl;
   using namespace scm::math;
 
+  if (!_render_timer) {
+    _render_timer.reset(new diw::gpu_timer(frame_profiler, _slow_context));
+  }
+  _render_timer->collect();
+
+  diw::profile_zone zone(frame_profiler, _render_timer.get(), "render_to_texture");
+
   // clear the color and depth buffer
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
+  _rendered_input.store(_input.load());
   mat4f    view_matrix = _trackball_manip.transform_matrix();
   mat4f    model_matrix = mat4f::identity();
   mat4f    model_view_matrix = view_matrix * model_matrix;
@@ -372,8 +421,14 @@ void demo_app::render_to_texture()
 void demo_app::postprocess_frame()
 {
   // blit multisample texture to texture and generate mipmap pyramid
-  _slow_context->resolve_multi_sample_buffer(_framebuffer, _framebuffer_resolved);
-  _slow_context->generate_mipmaps(_color_buffer_resolved);
+  {
+    diw::profile_zone zone(frame_profiler, _render_timer.get(), "resolve_multi_sample_buffer");
+    _slow_context->resolve_multi_sample_buffer(_framebuffer, _framebuffer_resolved);
+  }
+  {
+    diw::profile_zone zone(frame_profiler, _render_timer.get(), "generate_mipmaps");
+    _slow_context->generate_mipmaps(_color_buffer_resolved);
+  }
   _slow_context->reset();
 }
 
@@ -383,6 +438,13 @@ void demo_app::render_from_texture()
   using namespace scm::gl;
   using namespace scm::math;
 
+  if (!_present_timer) {
+    _present_timer.reset(new diw::gpu_timer(frame_profiler, _fast_context));
+  }
+  _present_timer->collect();
+
+  diw::profile_zone zone(frame_profiler, _present_timer.get(), "render_from_texture");
+
   mat4f   pass_mvp = mat4f::identity();
   ortho_matrix(pass_mvp, 0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
 
@@ -403,6 +465,12 @@ void demo_app::render_from_texture()
   _quad->draw(_fast_context);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::frame_presented(diw::time_point const& present_time)
+{
+  motion_to_photon.presented("rendered", _rendered_input.load(), present_time);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void demo_app::resize(int w, int h)
 {
@@ -449,6 +517,8 @@ void demo_app::mouse_func(GLFWwindow* window, int button, int action, int mods)
 ///////////////////////////////////////////////////////////////////////////////
 void demo_app::mouse_motion_func(GLFWwindow* window, double xpos, double ypos)
 {
+  diw::time_point input_time = diw::clock::now();
+
   float nx = 2.f * float(xpos - (_window_width / 2)) / float(_window_width);
   float ny = 2.f * float(_window_height - ypos - (_window_height / 2)) / float(_window_height);
 
@@ -464,6 +534,44 @@ void demo_app::mouse_motion_func(GLFWwindow* window, double xpos, double ypos)
 
   _inity = ny;
   _initx = nx;
+
+  if (_lb_down || _rb_down || _mb_down) {
+    _input.store(diw::input_stamp(_input.load().sequence + 1, input_time));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void demo_app::replay_pointer(diw::pointer_sample const& p)
+{
+  double xpos = double(p.x) * _window_width;
+  double ypos = double(p.y) * _window_height;
+
+  bool lb = (p.buttons & diw::pointer_sample::left) != 0;
+  bool mb = (p.buttons & diw::pointer_sample::middle) != 0;
+  bool rb = (p.buttons & diw::pointer_sample::right) != 0;
+
+  // press or release, like mouse_func without asking glfw for the cursor
+  if (lb != _lb_down || mb != _mb_down || rb != _rb_down) {
+    _lb_down = lb;
+    _mb_down = mb;
+    _rb_down = rb;
+
+    _initx = 2.f * float(xpos - (_window_width / 2)) / float(_window_width);
+    _inity = 2.f * float(_window_height - ypos - (_window_height / 2)) / float(_window_height);
+    return;
+  }
+
+  mouse_motion_func(nullptr, xpos, ypos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+diw::pointer_sample demo_app::pointer_state() const
+{
+  unsigned buttons = (_lb_down ? unsigned(diw::pointer_sample::left) : 0u)
+                   | (_mb_down ? unsigned(diw::pointer_sample::middle) : 0u)
+                   | (_rb_down ? unsigned(diw::pointer_sample::right) : 0u);
+
+  return diw::pointer_sample(0.5f * (_initx + 1.f), 0.5f * (1.f - _inity), buttons);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -494,53 +602,43 @@ static void cursor_position_callback(GLFWwindow* window, double xpos, double ypo
 ///////////////////////////////////////////////////////////////////////////////
 void init_window(std::shared_ptr<window_group> const& wgroup)
 {
-  /* Configure OpenGL context */
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
   /* Create a windowed mode window and its OpenGL context */
-  auto win = glfwCreateWindow(_application->window_width(), _application->window_height(), "Async Rendering Window", NULL, NULL);
+  scm::math::vec2ui size(_application->window_width(), _application->window_height());
 
-  if (win) {
+  if (wgroup->contexts->create_main_context(size, "Async Rendering Window")) {
     BOOST_LOG_TRIVIAL(info) << "Initialize fast client window succeed." << std::endl;
   }
   else {
     BOOST_LOG_TRIVIAL(error) << "Initialize fast client window failed." << std::endl;
+    return;
   }
-  wgroup->window = win;
 
   // Make the window's context current */
-  // glfwMakeContextCurrent(wgroup->window);
+  // wgroup->contexts->make_current(diw::main_context);
 
-  // set callbacks
-  glfwSetMouseButtonCallback(wgroup->window, mouse_button_callback);
-  glfwSetCursorPosCallback(wgroup->window, cursor_position_callback);
-  glfwSetWindowSizeCallback(wgroup->window, resize_callback);
+  // set callbacks, headless contexts have no window to take input from
+  if (auto win = static_cast<GLFWwindow*>(wgroup->contexts->native_handle(diw::main_context))) {
+    glfwSetMouseButtonCallback(win, mouse_button_callback);
+    glfwSetCursorPosCallback(win, cursor_position_callback);
+    glfwSetWindowSizeCallback(win, resize_callback);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void init_offscreen_window(std::shared_ptr<window_group> const& wgroup)
 {
   int  a = 0;
-  if (!wgroup->window) {
+  if (!wgroup->contexts->has_context(diw::main_context)) {
     return;
   }
 
-  // context creation configuration
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  glfwWindowHint(GLFW_VISIBLE, false);
+  // create context sharing with the main one
+  // wgroup->contexts->make_current(diw::main_context);
+  auto ctx = wgroup->contexts->create_shared_context("Async Rendering Offscreen");
 
-  // create window
-  // glfwMakeContextCurrent(wgroup->window);
-  auto win = glfwCreateWindow(_application->window_width(), _application->window_height(), "Async Rendering Offscreen", NULL, wgroup->window);
-
-  if (win) {
+  if (ctx != diw::invalid_context) {
     BOOST_LOG_TRIVIAL(info) << "Initialize slow client window succeed." << std::endl;
-    wgroup->offscreen_window = win;
+    wgroup->offscreen_context = ctx;
   }
   else {
     BOOST_LOG_TRIVIAL(error) << "Initialize slow client window failed." << std::endl;
@@ -550,13 +648,15 @@ void init_offscreen_window(std::shared_ptr<window_group> const& wgroup)
 ///////////////////////////////////////////////////////////////////////////////
 void fast_client(std::shared_ptr<window_group> const& wgroup)
 {
-  if (!wgroup->window) {
+  frame_profiler.name_current_thread("fast client");
+
+  if (!wgroup->contexts->has_context(diw::main_context)) {
     init_window(wgroup);
   }
 
 
   // init the GL context
-  glfwMakeContextCurrent(wgroup->window);
+  wgroup->contexts->make_current(diw::main_context);
   if (!_application->initialize()) {
     BOOST_LOG_TRIVIAL(error) << "error initializing gl context" << std::endl;
   }
@@ -567,10 +667,16 @@ void fast_client(std::shared_ptr<window_group> const& wgroup)
 
 
   // render loop
-  while (!glfwWindowShouldClose(wgroup->window))
+  while (!wgroup->contexts->should_close())
   {
+    diw::profile_zone frame_zone(frame_profiler, nullptr, "frame");
+
+    if (benchmark_run) {
+      _application->replay_pointer(benchmark_run->input(wgroup->contexts->presented_frames()));
+    }
+
     // Make the window's context current */
-    glfwMakeContextCurrent(wgroup->window);
+    wgroup->contexts->make_current(diw::main_context);
 
     {
       //BOOST_LOG_TRIVIAL(info) << "Fast Client : Render to texture." << std::endl;
@@ -579,19 +685,29 @@ void fast_client(std::shared_ptr<window_group> const& wgroup)
       _application->render_from_texture();
     }
 
-    glfwSwapBuffers(wgroup->window);
-    glfwPollEvents();
+    wgroup->contexts->swap_buffers();
+    _application->frame_presented(wgroup->contexts->last_present());
+    if (benchmark_run) {
+      benchmark_run->frame_presented(wgroup->contexts->last_present());
+    }
+    wgroup->contexts->poll_events();
+
+    if (recorded_path) {
+      recorded_path->append(_application->pointer_state());
+    }
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void slow_client(std::shared_ptr<window_group> const& wgroup)
 {
-  while (!wgroup->offscreen_window) {
+  frame_profiler.name_current_thread("slow client");
+
+  while (wgroup->offscreen_context == diw::invalid_context) {
     init_offscreen_window(wgroup);
   }
 
-  while (true) {
+  while (!wgroup->contexts->should_close()) {
     // std::lock_guard<std::mutex> lock(texture_write);
     //BOOST_LOG_TRIVIAL(info) << "Slow Client : Render to texture." << std::endl;
   }
@@ -609,8 +725,25 @@ int main(int argc, char **argv)
   /* Initialize the library */
   scm::shared_ptr<scm::core>      scm_core(new scm::core(argc, argv));
 
-  if (!glfwInit()) {
-    BOOST_LOG_TRIVIAL(error) << "Failed to init GLFW" << std::endl;
+  benchmark_run = diw::benchmark_requested(argc, argv, "simple_async_copy_init_main_single_thread_two_contexts");
+
+  // benchmarks run headless where the build allows
+  bool headless = diw::headless_requested(argc, argv) || (benchmark_run && diw::headless_supported());
+
+  auto contexts = diw::create_context_provider(headless);
+
+  if (!contexts || !contexts->initialize()) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to init GL context provider" << std::endl;
+    return (-1);
+  }
+
+  if (benchmark_run) {
+    contexts->frame_limit(benchmark_run->frames());
+  }
+
+  std::string record_file = diw::option_value(argc, argv, "--record-path");
+  if (!record_file.empty()) {
+    recorded_path.reset(new diw::camera_path());
   }
 
   glfwSetErrorCallback(error_callback);
@@ -618,6 +751,7 @@ int main(int argc, char **argv)
   _application.reset(new demo_app());
 
   windows = std::make_shared<window_group>();
+  windows->contexts = contexts;
 
   init_window(windows);
   init_offscreen_window(windows);
@@ -630,7 +764,34 @@ int main(int argc, char **argv)
   fast_thread.join();
   slow_thread.join();
 
-  glfwTerminate();
+  std::ostringstream report;
+  frame_profiler.write_report(report);
+  BOOST_LOG_TRIVIAL(info) << "Frame profile:" << std::endl << report.str();
+
+  std::ostringstream latency_report;
+  motion_to_photon.write_report(latency_report);
+  BOOST_LOG_TRIVIAL(info) << "Motion-to-photon latency:" << std::endl << latency_report.str();
+
+  std::string trace_file = diw::option_value(argc, argv, "--trace");
+  if (!trace_file.empty() && !frame_profiler.write_chrome_trace(trace_file)) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to write trace " << trace_file << std::endl;
+  }
+
+  if (benchmark_run) {
+    std::string benchmark_file = diw::option_value(argc, argv, "--benchmark-output");
+    if (benchmark_file.empty()) {
+      benchmark_run->write_json(std::cout, frame_profiler, motion_to_photon);
+    }
+    else if (!benchmark_run->write_json(benchmark_file, frame_profiler, motion_to_photon)) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to write benchmark results " << benchmark_file << std::endl;
+    }
+  }
+
+  if (recorded_path && !recorded_path->save(record_file)) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to write camera path " << record_file << std::endl;
+  }
+
+  contexts->terminate();
 
   return (0);
 }
\ No newline at end of file